@@ -0,0 +1,90 @@
+// Times sol_dobj against the sf map it replaced, keyed the same way the old sol_dobj was.
+// Prints seconds per phase for each table size; every phase does about OPS operations
+#include "sol/bytecode.h"
+#include <stdio.h>
+#include <time.h>
+
+#define MAP_NAME bench_map
+#define MAP_K sf_str
+#define MAP_V sol_val
+#define EQUAL_FN(s1, s2) (sf_str_eq(s1, s2))
+#define HASH_FN(s) (sf_str_hash(s))
+#define KCLEANUP sf_str_free
+#include <sf/containers/map.h>
+
+#define OPS 4000000u
+#define KEY_MAX 16
+
+static const uint32_t SIZES[] = {8, 64, 1024, 20000};
+static char hits[20000][KEY_MAX], misses[20000][KEY_MAX];
+static volatile uint64_t sink; // Keeps lookups from being optimized out
+
+static double bench_now(void) { return (double)clock() / CLOCKS_PER_SEC; }
+static sf_str bench_key(char *k) { return sf_ref(k); }
+
+static void bench_dobj(uint32_t n, double *ins, double *hit, double *miss) {
+    uint32_t rounds = OPS / n;
+    double t = bench_now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        sol_dobj obj = sol_dobj_new();
+        for (uint32_t i = 0; i < n; ++i)
+            sol_dobj_set(&obj, bench_key(hits[i]), (sol_val){SOL_TI64, .i64 = i});
+        if (r + 1 < rounds) sol_dobj_free(&obj);
+        else {
+            *ins = bench_now() - t;
+            t = bench_now();
+            for (uint32_t q = 0; q < rounds; ++q)
+                for (uint32_t i = 0; i < n; ++i)
+                    sink += (uint64_t)sol_dobj_get(&obj, bench_key(hits[i])).ok.i64;
+            *hit = bench_now() - t;
+            t = bench_now();
+            for (uint32_t q = 0; q < rounds; ++q)
+                for (uint32_t i = 0; i < n; ++i)
+                    sink += sol_dobj_get(&obj, bench_key(misses[i])).is_ok;
+            *miss = bench_now() - t;
+            sol_dobj_free(&obj);
+        }
+    }
+}
+
+static void bench_sfmap(uint32_t n, double *ins, double *hit, double *miss) {
+    uint32_t rounds = OPS / n;
+    double t = bench_now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        bench_map map = bench_map_new();
+        for (uint32_t i = 0; i < n; ++i)
+            bench_map_set(&map, bench_key(hits[i]), (sol_val){SOL_TI64, .i64 = i});
+        if (r + 1 < rounds) bench_map_free(&map);
+        else {
+            *ins = bench_now() - t;
+            t = bench_now();
+            for (uint32_t q = 0; q < rounds; ++q)
+                for (uint32_t i = 0; i < n; ++i)
+                    sink += (uint64_t)bench_map_get(&map, bench_key(hits[i])).ok.i64;
+            *hit = bench_now() - t;
+            t = bench_now();
+            for (uint32_t q = 0; q < rounds; ++q)
+                for (uint32_t i = 0; i < n; ++i)
+                    sink += bench_map_get(&map, bench_key(misses[i])).is_ok;
+            *miss = bench_now() - t;
+            bench_map_free(&map);
+        }
+    }
+}
+
+int main(void) {
+    for (uint32_t i = 0; i < 20000; ++i) {
+        snprintf(hits[i], KEY_MAX, "member%u", i);
+        snprintf(misses[i], KEY_MAX, "absent%u", i);
+    }
+
+    printf("%-8s %-6s %8s %8s %8s\n", "members", "table", "insert", "hit", "miss");
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(*SIZES); ++s) {
+        double ins = 0, hit = 0, miss = 0;
+        bench_dobj(SIZES[s], &ins, &hit, &miss);
+        printf("%-8u %-6s %8.3f %8.3f %8.3f\n", SIZES[s], "dobj", ins, hit, miss);
+        bench_sfmap(SIZES[s], &ins, &hit, &miss);
+        printf("%-8u %-6s %8.3f %8.3f %8.3f\n", SIZES[s], "sfmap", ins, hit, miss);
+    }
+    return 0;
+}
@@ -43,6 +43,14 @@ typedef enum {
 
     SOL_OP_SUPO,
     SOL_OP_GUPO,
+    SOL_OP_GSET,
+    SOL_OP_GGET,
+
+    SOL_OP_ARR,
+    SOL_OP_PUSH,
+    SOL_OP_IGET,
+    SOL_OP_ISET,
+    SOL_OP_NEXT,
 
     SOL_OP_UNKNOWN,
     SOL_OP_COUNT,
@@ -83,20 +91,10 @@ extern const char *SOL_ERR_STRINGS[SOL_ERR_COUNT];
 #define sol_iabc_c(i) ((i) & MASKI(9U))
 
 
-#define SOL_DBG_LINE_BITS 16
-#define SOL_DBG_COL_BITS  16
-
-#define SOL_DBG_COL_MASK  ((1u << SOL_DBG_COL_BITS) - 1u)
-#define SOL_DBG_LINE_MASK ((1u << SOL_DBG_LINE_BITS) - 1u)
-
-#define SOL_DBG_ENCODE(line, col) \
-    (((uint32_t)(line) & SOL_DBG_LINE_MASK) << SOL_DBG_COL_BITS | \
-     ((uint32_t)(col)  & SOL_DBG_COL_MASK) )
-
-#define SOL_DBG_LINE(loc) (((loc) >> SOL_DBG_COL_BITS) & SOL_DBG_LINE_MASK)
-#define SOL_DBG_COL(loc)  ((loc) & SOL_DBG_COL_MASK)
-
-typedef uint32_t sol_dbg;
+/// Source position of an instruction
+typedef struct {
+    uint32_t line, column;
+} sol_dbgpos;
 
 typedef struct {
     sol_opcode opcode;
@@ -127,6 +125,7 @@ typedef enum {
     SOL_DARRAY,
     SOL_DFUN,
     SOL_DREF,
+    SOL_DWEAK,
 
     SOL_DUSR,
 
@@ -134,18 +133,30 @@ typedef enum {
 } sol_dtype;
 extern const char *SOL_TYPE_NAMES[(size_t)SOL_TCOUNT + (size_t)SOL_DCOUNT];
 
+/// Size classes of the slab heap (see heap.h), named after their payload size
+typedef enum {
+    SOL_SC_16, SOL_SC_32, SOL_SC_48, SOL_SC_64,
+    SOL_SC_96, SOL_SC_128, SOL_SC_192, SOL_SC_256,
+    SOL_SC_COUNT,
+
+    SOL_SC_BIG = SOL_SC_COUNT, // Too big for a slab, or a usertype
+    SOL_SC_STATIC, // Not owned by the collector (constants, the global table)
+} sol_dsize;
+/// Flags for dynamic values that change how the collector treats them
 typedef enum {
-    SOL_DYN_WHITE,
-    SOL_DYN_BLACK,
-    SOL_DYN_GREEN, // Reference held by C
-} sol_dstate;
-/// Dynamic allocation header including size, type, and gc info
+    SOL_DFLAG_WEAKV = 1 << 0, // obj: members don't keep their values alive
+    SOL_DFLAG_FROZEN = 1 << 1, // Part of a frozen graph, see sol_dfreeze
+    SOL_DFLAG_FROOT = 1 << 2, // Root of a frozen graph, allocated behind its sol_fgraph
+} sol_dflag;
+/// Dynamic allocation header including type and size class.
+/// Mark bits live in the owning slab, so this stays at 8 bytes
 typedef struct sol_dalloc {
-    struct sol_dalloc *next;
-    size_t size;
-    sol_dtype tt;
-    sol_dstate mark;
+    uint8_t tt; // sol_dtype
+    uint8_t sc; // sol_dsize
+    uint16_t flags; // sol_dflag
+    uint32_t slot; // Index into the slab's bitmaps. Frozen values keep their graph's, see sol_dsfreeze
 } sol_dalloc;
+_Static_assert(sizeof(sol_dalloc) == 8, "sol_dalloc should be 8 bytes");
 
 typedef struct {
     sol_ptype tt;
@@ -190,11 +201,16 @@ typedef struct {
     } tt;
     union {
         struct {
-            uint16_t line_c;
+            uint32_t line_c;
             uint32_t code_c, dbg_res, dbg_ll;
             sf_str file_name;
             sol_instruction *code;
-            sol_dbg *dbg;
+            /// Line table, see sol_dbgencode. dbg_lines is the expanded line of every
+            /// instruction, it's only made for the debugger
+            uint8_t *dbg;
+            uint32_t dbg_len;
+            uint32_t *dbg_lines;
+            bool borrowed; // code and dbg point into an image instead of being owned, see sol_imview
         };
         sol_cfunction c_fun;
     };
@@ -206,18 +222,101 @@ EXPORT sol_fproto sol_fproto_new(void);
 EXPORT sol_fproto sol_fproto_c(sol_cfunction c_fun, uint32_t arg_c, uint32_t temp_c);
 EXPORT void sol_fproto_free(sol_fproto *proto);
 
-typedef sf_str sol_dstr;
-
-struct sol_dobj;
-void _sol_dobj_cleanup(struct sol_dobj *obj);
-#define MAP_NAME sol_dobj
-#define MAP_K sf_str
-#define MAP_V sol_val
-#define EQUAL_FN(s1, s2) (sf_str_eq(s1, s2))
-#define HASH_FN(s) (sf_str_hash(s))
-#define CLEANUP_FN _sol_dobj_cleanup
-#define KCLEANUP sf_str_free
-#include <sf/containers/map.h>
+/// Encodes a line table. Instructions that share a position are stored as one run of
+/// varints: the run length, the line delta from the previous run (zigzagged) and the column.
+/// Returns a malloc'd table and outputs its length
+EXPORT uint8_t *sol_dbgencode(const sol_dbgpos *pos, uint32_t count, uint32_t *len);
+/// Whether a line table decodes cleanly, with runs covering exactly code_c instructions and
+/// no line past line_c. Tables from outside the compiler (images) go through this first
+EXPORT bool sol_dbgcheck(const uint8_t *dbg, uint32_t len, uint32_t code_c, uint32_t line_c);
+/// Decodes the position of an instruction. This walks the table, so it's meant for errors
+EXPORT sol_dbgpos sol_dbgat(const sol_fproto *proto, uint32_t pc);
+/// Decodes the positions of every instruction into out, which holds code_c entries
+EXPORT void sol_dbgexpand(const sol_fproto *proto, sol_dbgpos *out);
+/// Returns the line of every instruction, expanded once and kept with the proto
+EXPORT const uint32_t *sol_dbglines(sol_fproto *proto);
+/// Threads jumps through jumps and drops unreachable instructions and jumps to the next
+/// instruction, in place. dbg holds the position of every instruction and is compacted
+/// along with the code, so this runs before the line table is encoded
+EXPORT void sol_peephole(sol_fproto *proto, sol_dbgpos *dbg);
+
+/// Payload of a str. A view borrows its characters from a parent str instead of owning
+/// them, and the collector keeps the parent alive for it. Views that don't reach the end
+/// of their parent aren't null terminated, see sol_dcstr
+typedef struct {
+    sf_str str;
+    void *parent; // Payload of the parent str, NULL if the str owns its characters
+} sol_dstr;
+
+/// A member of an obj, with its key's hash cached for rehashing and quick rejects
+typedef struct {
+    uint64_t hash;
+    sf_str key; // Borrows its characters from keystr once there is one
+    sol_val val;
+    void *keystr; // Payload of a collected str that owns the key's characters, see SOL_OP_NEXT
+} sol_dobj_slot;
+/// Object storage, an open addressing table probed a group of control bytes at a time.
+/// Each control byte is empty, deleted, or holds 7 bits of its slot's key hash,
+/// so a probe compares 16 candidates at once and only touches slots whose bits match.
+/// Members keyed 0..arr_c-1 live in a dense array part instead, so objects used as
+/// lists are indexed without building key strings. Keys are owned by the table
+typedef struct sol_dobj {
+    uint8_t *ctrl; // cap bytes, padded with empty ones to a whole group
+    sol_dobj_slot *slots; // Shares an allocation with ctrl
+    uint32_t cap, pair_count; // pair_count only counts the hash part
+    uint32_t growth_left; // Empty slots that can be filled before the next rehash
+    uint32_t arr_c, arr_cap;
+    uint32_t idx_c; // Hash members whose key is an index past the array part
+    uint32_t shape; // Changes whenever hash members are added, removed or moved, see sol_dobj_ref
+    sol_val *arr;
+} sol_dobj;
+#define SOL_DOBJ_GROUP 16
+
+#define EXPECTED_NAME sol_dobj_ex
+#define EXPECTED_O sol_val
+#define EXPECTED_E sol_error
+#include <sf/containers/expected.h>
+
+static inline sol_dobj sol_dobj_new(void) { return (sol_dobj){0}; }
+/// Number of members in both parts
+static inline uint32_t sol_dobj_count(const sol_dobj *obj) { return obj->pair_count + obj->arr_c; }
+/// Sets a member, taking ownership of the key. The key is freed if the member exists.
+/// Keys that spell an index ("0", "12", but not "012") go to the array part when they can
+EXPORT void sol_dobj_set(sol_dobj *obj, sf_str key, sol_val val);
+EXPORT sol_dobj_ex sol_dobj_get(sol_dobj *obj, sf_str key);
+/// Integer keyed access, the same member as the key's decimal string
+EXPORT void sol_dobj_seti(sol_dobj *obj, sol_i64 key, sol_val val);
+EXPORT sol_dobj_ex sol_dobj_geti(sol_dobj *obj, sol_i64 key);
+/// Removes a member, returning whether it existed. Removing from the array part moves
+/// the members after it to the hash part
+EXPORT bool sol_dobj_remove(sol_dobj *obj, sf_str key);
+/// Where a hash member's value is stored, NULL if there's no such member (or the key spells
+/// an index). The pointer stays valid for as long as the obj's shape doesn't change
+EXPORT sol_val *sol_dobj_ref(sol_dobj *obj, sf_str key);
+EXPORT bool sol_dobj_removei(sol_dobj *obj, sol_i64 key);
+/// Visits the array part in order, then the hash part. Keys are only valid during the call
+EXPORT void sol_dobj_foreach(sol_dobj *obj, void (*fn)(void *, sf_str, sol_val), void *user);
+/// Visits every value without building keys for the array part
+EXPORT void sol_dobj_foreachv(sol_dobj *obj, void (*fn)(void *, sol_val), void *user);
+/// Visits the strs that own hash keys, so the collector keeps them alive with the obj
+EXPORT void sol_dobj_foreachks(sol_dobj *obj, void (*fn)(void *, sol_val), void *user);
+/// A position in an obj and the member found there. Start from SOL_DOBJ_IT_START.
+/// Members of the array part have an empty key and their index instead, hash members
+/// have an index of -1 and borrow their key from the table
+typedef struct {
+    uint32_t cursor;
+    sol_i64 index;
+    sf_str key;
+    sol_val val;
+    sol_dobj_slot *slot; // NULL in the array part
+} sol_dobj_it;
+#define SOL_DOBJ_IT_START ((sol_dobj_it){0, -1, SF_STR_EMPTY, SOL_NIL, NULL})
+/// Steps to the next member, returns false once every member was visited. The cursor is
+/// a plain position, so updating members while iterating is fine. Members added or
+/// removed meanwhile may be skipped or visited twice
+EXPORT bool sol_dobj_next(sol_dobj *obj, sol_dobj_it *it);
+/// Frees every key and the table itself
+EXPORT void sol_dobj_free(sol_dobj *obj);
 typedef sol_fproto *sol_dfun;
 
 typedef void (*sol_usrdel)(void *);
@@ -226,10 +325,36 @@ typedef struct {
     sf_str name;
     sol_usrdel del;
     sol_usrtostring tostring;
+    size_t extra; // Bytes held outside the heap, see sol_dusrsize
 } sol_usrwrap;
 
-/// Cleanup functions for dynamic types
+/// Payload size of a dynamic type. Usertypes carry their own
+static inline size_t sol_dtsize(sol_dtype tt) {
+    switch (tt) {
+        case SOL_DSTR: return sizeof(sol_dstr);
+        case SOL_DERR: return sizeof(sf_str);
+        case SOL_DOBJ: return sizeof(sol_dobj);
+        case SOL_DARRAY: return sizeof(sol_valvec);
+        case SOL_DFUN: return sizeof(sol_fproto);
+        case SOL_DREF:
+        case SOL_DWEAK: return sizeof(sol_val);
+        default: return 0;
+    }
+}
+
+/// Allocates a static dynamic value that the collector doesn't own, with a zeroed payload.
+/// Free it with sol_dclean
+EXPORT sol_val sol_dnstatic(sol_dtype tt);
+/// Releases whatever a dynamic value owns, without freeing the value itself
+void sol_dclear(sol_val val);
+/// Cleanup functions for dynamic types. Static values are freed as well,
+/// values owned by the collector are only cleared
 void sol_dclean(sol_val val);
+/// Makes a str view own a copy of its characters, detaching it from its parent
+EXPORT void sol_dunview(sol_val str);
+/// Returns the characters of a str as a null terminated string, copying a view out of
+/// its parent first if it has to. The str keeps ownership
+EXPORT sf_str sol_dcstr(sol_val str);
 /// Convenience function to get the sol_dalloc of a dyn value
 static inline sol_dalloc *sol_dheader(sol_val val) {
     if (val.tt != SOL_TDYN)
@@ -256,20 +381,51 @@ static inline sol_val sol_dval(sol_val val) {
     return val;
 }
 
-/// Allocates a dynamic usertype object, a dynamic type with extra user info
-EXPORT sol_val sol_dnewusr(size_t size, sf_str name, void *value, sol_usrdel del, sol_usrtostring tostring);
-
 /// Gets the usrwrap header of a usrtype object
 static inline sol_usrwrap *sol_uheader(sol_val val) { return val.dyn; }
 /// Gets the true pointer of a usrtype object
 static inline void *sol_uptr(sol_val val) { return (char *)val.dyn + sizeof(sol_usrwrap); }
 
-/// Returns a (static) string denoting the type of a value
+/// Returns a borrowed str denoting the type of a value, copy it to keep it
 static inline sf_str sol_typename(sol_val val) {
     if (sol_isdtype(val, SOL_DUSR))
         return sol_uheader(val)->name;
-    return sf_lit(val.tt == SOL_TDYN ? SOL_TYPE_NAMES[(int)SOL_TDYN + 1 + sol_dheader(val)->tt] : SOL_TYPE_NAMES[val.tt]);
+    return sf_ref(val.tt == SOL_TDYN ? SOL_TYPE_NAMES[(int)SOL_TDYN + 1 + sol_dheader(val)->tt] : SOL_TYPE_NAMES[val.tt]);
+}
+/// Returns whether a value belongs to a frozen graph and mustn't be modified
+static inline bool sol_dfrozen(sol_val val) {
+    return val.tt == SOL_TDYN && (sol_dheader(val)->flags & SOL_DFLAG_FROZEN);
 }
+
+#define EXPECTED_NAME sol_freeze_ex
+#define EXPECTED_O sol_val
+#define EXPECTED_E sol_error
+#include <sf/containers/expected.h>
+/// Everything one sol_dfreeze made. The root value is allocated right behind it
+typedef struct {
+    sol_valvec made; // Every value the graph owns, root first
+    sol_valvec shared; // Values of other frozen graphs this one points at
+    bool mark; // Reached by the owning state's last collection
+    size_t bytes; // Rough size, counted toward the owning state's collections
+    sol_dalloc head; // The root's header
+} sol_fgraph;
+_Static_assert(offsetof(sol_fgraph, head) + sizeof(sol_dalloc) == sizeof(sol_fgraph), "The root's payload must follow its header");
+/// Deep copies strs, errs, objs and arrays into static values that no state owns, and
+/// marks them frozen. The VM refuses to modify frozen values, so one graph can be read by
+/// any number of states (and threads) at once. Shared members and cycles are kept.
+/// Frozen values are returned as is, and frozen values inside val are shared rather than
+/// copied, so their graphs must outlive this one. Anything else that isn't plain data is
+/// a type mismatch. The graph lives until sol_dunfreeze
+EXPORT sol_freeze_ex sol_dfreeze(sol_val val);
+/// The graph a value is the root of, NULL if it isn't the root of a frozen graph
+static inline sol_fgraph *sol_dgraph(sol_val root) {
+    if (root.tt != SOL_TDYN || !(sol_dheader(root)->flags & SOL_DFLAG_FROOT)) return NULL;
+    return (sol_fgraph *)((char *)sol_dheader(root) - offsetof(sol_fgraph, head));
+}
+/// Frees a graph made by sol_dfreeze, but not the graphs it shares values with.
+/// No state may still be using it. Does nothing if root isn't the root of a graph
+EXPORT void sol_dunfreeze(sol_val root);
+
 /// Returns whether a usrtype object is of the specified type
 static inline bool sol_isutype(sol_val val, sf_str name) { return sf_str_eq(name, sol_typename(val)); }
 
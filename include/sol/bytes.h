@@ -0,0 +1,57 @@
+#ifndef BYTES_H
+#define BYTES_H
+
+#include "bytecode.h"
+#include <stdint.h>
+
+struct sol_state;
+
+/// Scalar encodings for sol_byget and sol_byset. Multi byte kinds are little endian
+/// unless SOL_BK_BE is or'd in
+typedef enum {
+    SOL_BK_U8,
+    SOL_BK_I8,
+    SOL_BK_U16,
+    SOL_BK_I16,
+    SOL_BK_U32,
+    SOL_BK_I32,
+    SOL_BK_I64,
+    SOL_BK_F32,
+    SOL_BK_F64,
+
+    SOL_BK_COUNT,
+    SOL_BK_BE = 0x10,
+} sol_bytekind;
+
+/// A binary buffer with an explicit length, usually stored inline after its header.
+/// Slices point into the bytes of their owner instead, and the collector keeps the
+/// owner alive for them
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    sol_val owner; // nil if data is inline
+    uint8_t buf[];
+} sol_bytes;
+
+/// Allocates bytes holding a copy of data, or zeroes if data is NULL
+EXPORT sol_val sol_bynew(struct sol_state *state, const void *data, size_t len);
+/// Returns the bytes of a value, or NULL if it isn't bytes
+EXPORT sol_bytes *sol_byof(sol_val val);
+/// Makes bytes that share len bytes of another from start, the range must fit
+EXPORT sol_val sol_byslice(struct sol_state *state, sol_val bytes, size_t start, size_t len);
+
+/// Parses a kind name like "u8", "i32" or "f64be". Names without "be" are little endian
+EXPORT bool sol_bykind(sf_str name, sol_bytekind *out);
+EXPORT size_t sol_bysize(sol_bytekind kind);
+/// Reads a scalar at off. Returns false if it doesn't fit
+EXPORT bool sol_byget(sol_bytes *b, size_t off, sol_bytekind kind, sol_val *out);
+/// Writes a number at off, converted to the kind. Integer kinds keep the low bits.
+/// Returns false if it doesn't fit or val isn't a number
+EXPORT bool sol_byset(sol_bytes *b, size_t off, sol_bytekind kind, sol_val val);
+
+/// Reads a whole file in binary mode. Returns nil if it can't be read
+EXPORT sol_val sol_byread(struct sol_state *state, const char *path);
+/// Writes bytes to a file in binary mode, replacing it
+EXPORT bool sol_bywrite(sol_bytes *b, const char *path);
+
+#endif // BYTES_H
@@ -16,6 +16,6 @@
 #endif
 
 int sol_cli_cbg(char *path, sf_str src);
-void cli_highlight_line(sf_str src, sf_str err, uint16_t line, uint16_t column);
+void cli_highlight_line(sf_str src, sf_str err, uint32_t line, uint16_t column);
 
 #endif // CLI_H
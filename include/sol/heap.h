@@ -0,0 +1,78 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "bytecode.h"
+#include <stdint.h>
+
+/// Slabs are aligned to their size, so the slab of a value is found by masking its address
+#define SOL_SLAB_SIZE (64 * 1024)
+/// Enough bits for the smallest stride (an 8 byte header and a 16 byte payload)
+#define SOL_SLAB_BITS 4096
+#define SOL_SLAB_WORDS (SOL_SLAB_BITS / 64)
+
+/// A block of same sized slots. Each slot is a sol_dalloc header followed by its payload.
+/// Mark and live bits are kept here so the sweep scans two small bitmaps per slab
+typedef struct sol_slab {
+    struct sol_slab *next;
+    sol_dalloc *free; // Released slots, linked through their payloads
+    uint32_t stride, cap, used; // used only counts bump allocated slots
+    uint64_t mark[SOL_SLAB_WORDS];
+    uint64_t live[SOL_SLAB_WORDS];
+} sol_slab;
+#define SOL_SLAB_HDR ((sizeof(sol_slab) + 15) & ~(size_t)15)
+
+/// Prefix of a value that's too big for a slab, or a usertype
+typedef struct sol_dbig {
+    struct sol_dbig *next;
+    size_t size;
+    bool mark;
+} sol_dbig;
+
+/// A queue of dead usertypes waiting for their destructors, linked through their sol_dbig.
+/// Usertypes are finalized in the order the sweep found them
+typedef struct {
+    sol_dbig *head, *tail;
+    uint32_t count;
+    size_t bytes; // Memory the destructors will give back, including usertype extra
+} sol_finq;
+
+/// Every allocation the collector owns
+typedef struct {
+    sol_slab *slabs[SOL_SC_COUNT]; // Slabs with free slots, allocation uses the first
+    sol_slab *full[SOL_SC_COUNT];
+    sol_dbig *big, *bigtail; // In allocation order
+    sol_finq fin; // Dead usertypes, see sol_runfinalizers
+} sol_heap;
+
+static inline sol_slab *sol_slabof(sol_dalloc *dh) {
+    return (sol_slab *)((uintptr_t)dh & ~(uintptr_t)(SOL_SLAB_SIZE - 1));
+}
+static inline sol_dbig *sol_bigof(sol_dalloc *dh) { return (sol_dbig *)dh - 1; }
+
+/// Returns whether a value was marked by the current collection. Static values always are
+static inline bool sol_hmarked(sol_dalloc *dh) {
+    if (dh->sc < SOL_SC_COUNT)
+        return (sol_slabof(dh)->mark[dh->slot >> 6] >> (dh->slot & 63)) & 1;
+    if (dh->sc == SOL_SC_BIG)
+        return sol_bigof(dh)->mark;
+    return true;
+}
+static inline void sol_hmark(sol_dalloc *dh) {
+    if (dh->sc < SOL_SC_COUNT)
+        sol_slabof(dh)->mark[dh->slot >> 6] |= 1ull << (dh->slot & 63);
+    else if (dh->sc == SOL_SC_BIG)
+        sol_bigof(dh)->mark = true;
+}
+
+/// Allocates a value with a zeroed payload of the given size. Returns its header
+EXPORT sol_dalloc *sol_halloc(sol_heap *heap, sol_dtype tt, size_t size);
+/// Frees every unmarked value and clears the marks of the rest. Dead usertypes with a
+/// destructor are queued on heap->fin instead. Returns the bytes still alive
+EXPORT size_t sol_hsweep(sol_heap *heap);
+/// Frees every value in the heap, running usertype destructors immediately
+EXPORT void sol_hfree(sol_heap *heap);
+/// Runs up to max destructors from a detached batch, or all of them if max is 0.
+/// Doesn't touch any state, so it's safe to call from another thread
+EXPORT uint32_t sol_finq_run(sol_finq *queue, uint32_t max);
+
+#endif // HEAP_H
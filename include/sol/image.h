@@ -0,0 +1,72 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "bytecode.h"
+#include "solc.h"
+#include "strbuf.h"
+#include <stdint.h>
+
+/// Bumped whenever the layout below changes. Images of any other version are stale, and so
+/// are images written by any other build, see sol_imbuild
+#define SOL_IMAGE_VERSION 2
+#define SOL_IMAGE_MAGIC "SOLI"
+#define SOL_IMAGE_EXT ".solc" // Files sol_cfile loads as images instead of compiling
+
+/// A compiled proto tree, laid out so it can be used from wherever it's loaded. Every
+/// position in it is an offset from the start of the image, and it's written in the host's
+/// byte order, which makes an image from a machine of the other order read as another version.
+/// The header is followed by the proto table (the root first), then every proto's constants,
+/// then every proto's upvals, then code, line tables and names
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t build; // sol_imbuild of the library that wrote it
+    uint64_t src_hash; // sol_imhash of the source it was compiled from
+    uint64_t sum; // sol_imhash of everything after the header
+    uint32_t size; // Of the whole image
+    uint32_t proto_c;
+} sol_imheader;
+typedef struct {
+    uint32_t code, code_c; // Instructions, 4 byte aligned
+    uint32_t dbg, dbg_len; // Line table, see sol_dbgencode
+    uint32_t consts, const_c;
+    uint32_t upvals, up_c;
+    uint32_t reg_c, arg_c, entry, line_c;
+} sol_improto;
+/// A constant. Strs are kept with a terminator after their len bytes, funs are protos
+typedef struct {
+    uint32_t tt; // sol_ptype, or SOL_TCOUNT + sol_dtype for strs and funs
+    uint32_t len; // Of a str
+    uint64_t bits; // Of the number or bool, offset of a str, index of a fun's proto
+} sol_imconst;
+/// An upval. The globals obj is the only value one can hold, it's bound again on load
+typedef struct {
+    uint32_t name, name_len;
+    uint32_t tt; // SOL_UP_VAL for the globals obj, or SOL_UP_REF
+    uint32_t ref, frame;
+} sol_imupval;
+_Static_assert(sizeof(sol_imheader) == 40, "sol_imheader should be 40 bytes");
+_Static_assert(sizeof(sol_improto) == 48, "sol_improto should be 48 bytes");
+_Static_assert(sizeof(sol_imconst) == 16, "sol_imconst should be 16 bytes");
+_Static_assert(sizeof(sol_imupval) == 20, "sol_imupval should be 20 bytes");
+
+/// 64 bit FNV-1a, what images are keyed and checked by
+EXPORT uint64_t sol_imhash(const void *data, size_t len);
+/// Identifies this build of the library: the solus version, the compiler that built it and
+/// the library's sources (SOL_BUILD_ID), so what the compiler makes of a source can change
+/// without bumping anything by hand. Builds without SOL_BUILD_ID use when image.c was compiled
+EXPORT uint64_t sol_imbuild(void);
+/// Writes a proto tree as an image. It has to be unlinked (see sol_link), and global is the
+/// globals obj its upvals hold. Returns false for trees an image can't hold, ones with
+/// constants other than numbers, bools, strs and funs, or upvals holding other values
+EXPORT bool sol_imdump(const sol_fproto *proto, sol_val global, uint64_t src_hash, sol_strbuf *out);
+/// Rebuilds a proto tree from an image, with its upvals holding global. The image is checked
+/// against its version, build, size and sum, and everything in it has to be in bounds, down to
+/// every instruction's registers, constants, upvals and jumps, the registers ref upvals point
+/// into and the line tables. Linked instructions are refused
+EXPORT sol_compile_ex sol_imload(const void *data, size_t len, sol_val global);
+/// sol_imload without the copies: code, line tables, strs and names are used where they are
+/// in data, which has to be aligned, stay writable for sol_link and outlive the tree
+EXPORT sol_compile_ex sol_imview(void *data, size_t len, sol_val global);
+
+#endif // IMAGE_H
@@ -0,0 +1,105 @@
+#ifndef IR_H
+#define IR_H
+
+#include "bytecode.h"
+#include <stdint.h>
+
+/// Marks an operand, successor or value that isn't there
+#define SOL_IR_NONE UINT32_MAX
+
+/// An instruction in the IR. Registers keep the numbers the compiler gave them until
+/// sol_iralloc renumbers them, so every SSA value lives in the register it was written to
+/// until that register is written again, and leaving SSA needs no copies
+typedef struct {
+    sol_opcode op;
+    uint32_t opa[3]; // Operands at full width, they're only encoded by sol_iremit
+    uint32_t arg_c; // Args a CALL passes, in the registers from its third operand on
+    sol_dbgpos pos;
+    uint32_t target; // Block a JMP goes to
+    uint32_t def; // Value written, NEXT writes three in a row
+    uint32_t use[3]; // Value read through each operand, SOL_IR_NONE for operands that aren't reads
+    bool dead; // Removed by a pass, not emitted
+    bool fixed; // Skipped by the compare before it, so it has to stay one instruction
+} sol_irins;
+
+/// A basic block, a run of instructions that's only entered at the top
+typedef struct {
+    uint32_t start, end;
+    uint32_t succ[2];
+    uint32_t *preds;
+    uint32_t pred_c;
+    bool reached;
+} sol_irblock;
+
+/// An SSA value. Values are made by instructions, by merging different values at the top
+/// of a block (phis), or are whatever a register held on entry
+typedef struct {
+    uint32_t reg;
+    uint32_t vn; // Value number, values that share one are known to be equal
+    uint32_t ins; // Instruction that made it, SOL_IR_NONE for phis and entry values
+} sol_irval;
+
+#define VEC_NAME sol_irvals
+#define VEC_T sol_irval
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
+/// Control flow graph in SSA form, built from a compiled fun's bytecode
+typedef struct {
+    sol_fproto *proto;
+    sol_dbgpos *dbg;
+    uint32_t reg_c;
+    bool *pinned; // Registers that closures can see, nothing about them is assumed
+
+    sol_irins *ins;
+    uint32_t ins_c;
+    sol_irblock *blocks;
+    uint32_t block_c;
+    uint32_t *order; // Reachable blocks in reverse postorder
+    uint32_t order_c;
+
+    sol_irvals vals;
+    uint32_t *in; // Value of every register on entry to every block, block_c * reg_c
+    uint32_t *phis; // Phi made for a block and register, block_c * reg_c
+    uint32_t *leaders; // First value given each value number
+    uint32_t vn_c;
+} sol_ir;
+
+/// A pass over the IR, returns whether it changed anything
+typedef bool (*sol_irpassfn)(sol_ir *ir);
+typedef struct {
+    const char *name;
+    sol_irpassfn run;
+} sol_irpass;
+
+/// Passes run on every compiled fun, in order
+#define SOL_IR_PASS_C 3
+extern const sol_irpass SOL_IR_PASSES[SOL_IR_PASS_C];
+
+/// Builds the IR of a proto. dbg holds the position of every instruction and opa its operands
+/// at full width (or NULL to read them from the code), frame is how deep the fun is nested,
+/// which is how closures made inside it name its registers.
+/// A CALL with no args must name its fun register as the first arg, so the args are always
+/// the registers between the two
+EXPORT sol_ir sol_irnew(sol_fproto *proto, sol_dbgpos *dbg, const uint32_t (*opa)[3], uint32_t frame);
+EXPORT void sol_irfree(sol_ir *ir);
+/// Rebuilds the SSA form and value numbers, passes that remove instructions need this after
+EXPORT void sol_irssa(sol_ir *ir);
+/// Runs passes in order, until none of them change anything. Returns whether any did
+EXPORT bool sol_irrun(sol_ir *ir, const sol_irpass *passes, uint32_t pass_c);
+/// Gives every value a register, reusing registers once what they hold is dead, and sets
+/// the proto's reg_c. Registers closures can see and the args keep their numbers.
+/// This is the last thing done to the IR before it's emitted
+EXPORT void sol_iralloc(sol_ir *ir);
+/// Writes the instructions back to the proto and the positions back to dbg, in place.
+/// Returns false if an operand doesn't fit in its instruction's encoding
+EXPORT bool sol_iremit(sol_ir *ir);
+
+/// Replaces computations of a value that's already in a register with a move from it
+EXPORT bool sol_irgvn(sol_ir *ir);
+/// Makes instructions read values from where they were first made instead of from copies
+EXPORT bool sol_ircopies(sol_ir *ir);
+/// Removes instructions whose results are never read and that have no other effect
+EXPORT bool sol_irdead(sol_ir *ir);
+
+#endif // IR_H
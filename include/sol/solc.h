@@ -4,9 +4,13 @@
 #include <stddef.h>
 #include "bytecode.h"
 
+#define SOL_INLINE_BUDGET 24 // Most AST nodes a fun's body can have for calls to it to be inlined
+#define SOL_HOIST_MAX 16 // Most lookups moved out of one loop, each holds a register until the loop ends
+
 typedef struct {
     sol_error tt;
-    uint16_t line, column;
+    uint32_t line;
+    uint16_t column;
 } sol_compile_err;
 
 #define EXPECTED_NAME sol_compile_ex
@@ -0,0 +1,25 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include "bytecode.h"
+#include <sf/str.h>
+
+/// A growable string for building text piece by piece. Appends are amortized O(1),
+/// and sol_sbfinish hands the buffer over as an owned sf_str without copying it
+typedef struct {
+    char *data; // Always null terminated once allocated
+    size_t len, cap;
+} sol_strbuf;
+#define SOL_STRBUF_EMPTY ((sol_strbuf){NULL, 0, 0})
+
+/// Makes room for at least extra more bytes. Returns false if allocation fails
+EXPORT bool sol_sbreserve(sol_strbuf *sb, size_t extra);
+EXPORT bool sol_sbappend(sol_strbuf *sb, sf_str str);
+EXPORT bool sol_sbappendc(sol_strbuf *sb, char c, size_t n);
+/// Appends a value as sol_tostring would write it
+EXPORT bool sol_sbappendv(sol_strbuf *sb, sol_val val);
+/// Takes the built string and resets the builder
+EXPORT sf_str sol_sbfinish(sol_strbuf *sb);
+EXPORT void sol_sbfree(sol_strbuf *sb);
+
+#endif // STRBUF_H
@@ -23,7 +23,7 @@ typedef enum {
 
     TK_DO,
     TK_AND, TK_COLON, TK_ELSE, TK_TRUE, TK_FALSE, TK_FUN, TK_FOR, TK_IF, TK_NIL, TK_OR,
-    TK_RETURN, TK_LET, TK_WHILE,
+    TK_RETURN, TK_LET, TK_WHILE, TK_IN,
 
     TK_EOF
 } sol_tokentype;
@@ -31,13 +31,15 @@ typedef enum {
 typedef struct {
     sol_tokentype tt;
     sol_val value;
-    uint16_t line, column;
+    uint32_t line;
+    uint16_t column;
 } sol_token;
 
 typedef struct {
     sol_error tt;
     sf_str token;
-    uint16_t line, column;
+    uint32_t line;
+    uint16_t column;
 } sol_scan_err;
 
 struct sol_tokenvec;
@@ -59,7 +61,7 @@ void _sol_keywords_cleanup(struct sol_keywords *vec);
 
 typedef struct {
     sol_tokenvec tv;
-    sol_dalloc *alloc;
+    sol_valvec statics; // Static values made for literals, owned by the caller
 } sol_scan_ok;
 #define EXPECTED_NAME sol_scan_ex
 #define EXPECTED_O sol_scan_ok
@@ -88,16 +90,20 @@ typedef enum {
 
     SOL_ND_IF,
     SOL_ND_WHILE,
+    SOL_ND_FOR,
     SOL_ND_RETURN,
 
     SOL_ND_OBJ,
+    SOL_ND_ARRAY,
+    SOL_ND_INDEX,
 } sol_nodetype;
 
 /// A node in the AST (Abstract Syntax Tree) that the parser exports.
 /// The compiler walks these to make the bytecode :)
 typedef struct sol_node {
     sol_nodetype tt;
-    uint16_t line, column;
+    uint32_t line;
+    uint16_t column;
     union {
         sol_val n_literal, n_identifier;
         struct {
@@ -120,6 +126,7 @@ typedef struct sol_node {
         struct { // <let> n = v; // { n = v }
             sol_val name;
             struct sol_node *value;
+            bool once; // Never written after the let, set by sol_fold
         } n_let, n_member;
         struct {
             struct sol_node *expr;
@@ -139,6 +146,11 @@ typedef struct sol_node {
             struct sol_node *condition;
             struct sol_node *stmt;
         } n_while;
+        struct { // for k, v in e {b}
+            sol_val key, val; // val is nil when only the key is named
+            struct sol_node *expr;
+            struct sol_node *stmt;
+        } n_for;
         struct sol_block { // {s}
             struct sol_node **stmts;
             uint32_t count;
@@ -165,6 +177,14 @@ typedef struct sol_node {
             struct sol_node **members;
             uint32_t mem_c;
         } n_obj;
+        struct { // [e, ]
+            struct sol_node **elems;
+            uint32_t elem_c;
+        } n_array;
+        struct { // e[i]
+            struct sol_node *expr;
+            struct sol_node *index;
+        } n_index;
     };
 } sol_node;
 
@@ -176,7 +196,8 @@ EXPORT void sol_node_free(sol_node *root);
 /// A possible result of parsing, describes what went wrong and where
 typedef struct {
     sol_error tt;
-    uint16_t line, column;
+    uint32_t line;
+    uint16_t column;
 } sol_parse_err;
 /// An optional type alias for the root node of an AST
 typedef sol_node *sol_ast;
@@ -187,4 +208,10 @@ typedef sol_node *sol_ast;
 #include <sf/containers/expected.h>
 EXPORT sol_parse_ex sol_parse(sol_tokenvec *tokens);
 
+/// Fold constant expressions in an AST before it's compiled, in place.
+/// Propagates lets that are never written again, and drops loops that can never run.
+/// Lets that are never written again are marked, so the compiler can inline the funs they hold.
+/// Strings made while folding are pushed to statics
+EXPORT void sol_fold(sol_ast ast, sol_valvec *statics);
+
 #endif // SYNTAX_H
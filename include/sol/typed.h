@@ -0,0 +1,50 @@
+#ifndef TYPED_H
+#define TYPED_H
+
+#include "bytecode.h"
+#include <stdint.h>
+
+struct sol_state;
+
+/// Element type of a typed array
+typedef enum {
+    SOL_TA_F64,
+    SOL_TA_I64,
+    SOL_TA_U8,
+
+    SOL_TA_COUNT,
+} sol_tatype;
+
+/// A packed array of raw numbers, stored inline after its header in a usertype.
+/// Elements aren't boxed, so the bulk kernels below can be vectorized
+typedef struct {
+    sol_tatype tt;
+    uint32_t count;
+    uint8_t data[];
+} sol_tarray;
+
+extern const char *SOL_TA_NAMES[SOL_TA_COUNT];
+
+/// Allocates a zeroed typed array usertype. Returns nil if count is too large
+EXPORT sol_val sol_tanew(struct sol_state *state, sol_tatype tt, uint32_t count);
+/// Returns the typed array of a value, or NULL if it isn't one
+EXPORT sol_tarray *sol_taof(sol_val val);
+
+/// Element access. Values are converted to the array's element type,
+/// returns false if the value isn't a number
+EXPORT sol_val sol_taget(sol_tarray *ta, uint32_t i);
+EXPORT bool sol_taset(sol_tarray *ta, uint32_t i, sol_val val);
+
+/// Bulk kernels. Integer results are i64, f64 arrays give f64. Arithmetic on
+/// i64 and u8 arrays wraps. min/max of an empty array are nil
+EXPORT bool sol_tafill(sol_tarray *ta, sol_val val);
+EXPORT sol_val sol_tasum(sol_tarray *ta);
+EXPORT sol_val sol_tamin(sol_tarray *ta);
+EXPORT sol_val sol_tamax(sol_tarray *ta);
+EXPORT bool sol_tascale(sol_tarray *ta, sol_val k);
+/// a and b must have the same type and length
+EXPORT sol_val sol_tadot(sol_tarray *a, sol_tarray *b);
+/// Adds b into a elementwise. a and b must have the same type and length
+EXPORT void sol_taadd(sol_tarray *a, sol_tarray *b);
+
+#endif // TYPED_H
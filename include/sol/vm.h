@@ -2,9 +2,13 @@
 #define VM_H
 
 #include "bytecode.h"
+#include "heap.h"
 #include "solc.h"
 
 #define SOL_GCSTEP 1.5
+#define SOL_GCMIN (1 << 20) // Live bytes assumed when picking the next collection
+#define SOL_FINBATCH 64 // Most queued destructors the VM runs at one safe point
+#define SOL_VIEWMIN 8 // Views under 1/n of a parent nothing else holds are copied out
 
 /// Represents a function's frame, or reserved registers, on the stack
 typedef struct {
@@ -21,24 +25,115 @@ typedef struct {
 #define VSIZE_T uint32_t
 #include <sf/containers/vec.h>
 
+#define VEC_NAME sol_slots
+#define VEC_T uint32_t
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
+/// A global that linked code reads and writes by index instead of by name, see sol_link.
+/// val is where the member lives in the global table, and is only trusted while the
+/// table's shape is the one it was found at. A NULL val means the global isn't defined
+typedef struct {
+    sf_str name; // Owned by the directory
+    sol_val *val;
+    uint32_t shape;
+} sol_gslot;
+#define VEC_NAME sol_gslots
+#define VEC_T sol_gslot
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+#define MAP_NAME sol_gdir
+#define MAP_K sf_str
+#define MAP_V uint32_t
+#define EQUAL_FN sf_str_eq
+#define HASH_FN sf_str_hash
+#define KCLEANUP sf_str_free
+#include <sf/containers/map.h>
+
+/// An image file sol_cfile loaded in place. The protos loaded from it point into it, so it's
+/// kept until the state is freed
+typedef struct {
+    void *data;
+    size_t len;
+    bool mapped; // Otherwise read into malloc'd memory, where files can't be mapped
+} sol_image;
+#define VEC_NAME sol_images
+#define VEC_T sol_image
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+#define VEC_NAME sol_fgraphs
+#define VEC_T sol_fgraph *
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
+/// A value held by the C API across collections, see sol_dhold
+typedef uint32_t sol_hold;
+
+/// A file run as a module, see sol_import
+typedef struct {
+    sf_str path; // Canonical, owned by the directory
+    sol_hold val; // What its last finished run returned
+    enum {
+        SOL_MOD_UNRUN, // Not run yet, or its last run failed
+        SOL_MOD_RUNNING, // Importing it from its own run gets val instead of running it again
+        SOL_MOD_DONE,
+    } tt;
+} sol_module;
+#define VEC_NAME sol_modules
+#define VEC_T sol_module
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+#define MAP_NAME sol_moddir
+#define MAP_K sf_str
+#define MAP_V uint32_t
+#define EQUAL_FN sf_str_eq
+#define HASH_FN sf_str_hash
+#define KCLEANUP sf_str_free
+#include <sf/containers/map.h>
+
 /// The main global state for the VM, responsible for the stack and any globals/caching
 typedef struct sol_state {
     sol_valvec stack;
     sol_frames frames;
     sol_filenames files;
+    sf_str cache; // Directory sol_cfile keeps compiled images in, empty for none
+    sol_images images;
+    sol_fgraphs frozen; // Graphs scripts froze, see sol_dsfreeze
     sol_val global;
+    sol_gslots gslots;
+    sol_gdir gdir; // Slot given to each global name
+    sol_modules modules;
+    sol_moddir moddir; // Module of each path it's been imported by, canonical or not
     bool dbg;
 
-    sol_dalloc *alloc;
-    size_t lb, cb;
+    sol_valvec roots; // Handle scope stack, see sol_hopen
+    sol_valvec holds; // Long lived holds, indexed by sol_hold
+    sol_slots hfree; // Released slots in holds
+    sol_valvec weak; // Weak refs and weak objects found while marking
+    sol_valvec views; // Str views found while marking
+
+    sol_heap heap;
+    size_t lb, cb; // Live bytes after the last collection, bytes allocated now
 } sol_state;
 EXPORT sol_state *sol_state_new(void);
 EXPORT void sol_state_free(sol_state *state);
 
 /// Include the standard library defined in std.c into the global namespace
 EXPORT void sol_usestd(struct sol_state *state);
+/// Points a proto's (and its inner protos') reads and writes of globals at the state's
+/// global slots. Names are given slots the first time they're linked, defined or not.
+/// sol_csrc does this for everything it compiles
+EXPORT void sol_link(sol_state *state, sol_fproto *proto);
 EXPORT sol_compile_ex sol_csrc(sol_state *state, sf_str src);
+/// Compiles a file. With a cache directory set, the compiled image of every source file is kept
+/// there under its canonical path, and a file whose image is current (same source and build) and
+/// intact is loaded from it instead. Stale images are overwritten by the new one, so the cache
+/// holds one per file. Anything else about the cache failing just means compiling.
+/// Files named SOL_IMAGE_EXT are images themselves, they're mapped and used in place
 EXPORT sol_compile_ex sol_cfile(sol_state *state, sf_str path);
+/// Compiles a source file into an image file at out, for sol_cfile to load without the source.
+/// Returns SOL_ERRC_NONE once it's written
+EXPORT sol_compile_err sol_cimage(sol_state *state, sf_str path, sf_str out);
 
 static inline sf_str sol_cwd(sol_state *state) {
     return sf_str_dup(*(state->files.data + (state->files.count - 1)));
@@ -52,6 +147,20 @@ EXPORT sf_str sol_stackdump(sol_state *state);
 /// Create a new dynamic value
 EXPORT sol_val sol_dnew(sol_state *state, sol_dtype type);
 EXPORT void sol_dcollect(sol_state *state);
+/// Allocates a dynamic usertype object, a dynamic type with extra user info.
+/// The value is copied into the object if it isn't NULL, otherwise it's zeroed.
+/// del isn't run by the collector, dead usertypes are queued for sol_runfinalizers
+EXPORT sol_val sol_dnewusr(sol_state *state, size_t size, sf_str name, void *value, sol_usrdel del, sol_usrtostring tostring);
+/// Sets how many bytes a usertype holds outside the heap, such as a buffer its del frees,
+/// so they pace collections like the usertype's own payload
+EXPORT void sol_dusrsize(sol_state *state, sol_val usr, size_t extra);
+/// Runs up to max queued usertype destructors in order, or all of them if max is 0.
+/// The VM also drains the queue SOL_FINBATCH at a time while it's over the GC pace.
+/// Returns how many were run
+EXPORT uint32_t sol_runfinalizers(sol_state *state, uint32_t max);
+/// Detaches every queued usertype so the batch can be finalized elsewhere, such as
+/// on a worker thread with sol_finq_run. The state no longer touches them
+EXPORT sol_finq sol_takefinalizers(sol_state *state);
 /// Shorthand for using sol_dnew and assigning a string value.
 /// This function takes ownership of the string passed, so make a copy if needed
 static inline sol_val sol_dnstr(sol_state *state, sf_str str) {
@@ -66,17 +175,48 @@ static inline sol_val sol_dnerr(sol_state *state, sf_str str) {
     *(sf_str *)strv.dyn = str;
     return strv;
 }
-/// Hold a reference to the a dyn value for the C API.
-/// This marks the object as green, meaning collection is skipped
-static inline void sol_dhold(sol_val val) {
-    if (val.tt != SOL_TDYN) return;
-    sol_dheader(val)->mark = SOL_DYN_GREEN;
+/// Creates a str that shares len characters of str from start, without copying them.
+/// Strings that aren't owned by the collector are copied instead
+EXPORT sol_val sol_dnview(sol_state *state, sol_val str, size_t start, size_t len);
+/// Freezes a value like sol_dfreeze, into a graph the state owns. The collector frees the
+/// graph once none of its values are reachable, so it mustn't be handed to other states
+EXPORT sol_freeze_ex sol_dsfreeze(sol_state *state, sol_val val);
+/// Creates a weak reference to a value. The collector sets the target to nil once
+/// nothing else keeps it alive
+static inline sol_val sol_dnweak(sol_state *state, sol_val target) {
+    sol_val weak = sol_dnew(state, SOL_DWEAK);
+    *(sol_val *)weak.dyn = target;
+    return weak;
+}
+/// Gets the target of a weak reference, or nil if it has been collected
+static inline sol_val sol_dderef(sol_val weak) { return *(sol_val *)weak.dyn; }
+/// Creates an object whose members don't keep their values alive.
+/// Members with collected values are removed by the next collection, handy for caches
+static inline sol_val sol_dnwobj(sol_state *state) {
+    sol_val obj = sol_dnew(state, SOL_DOBJ);
+    sol_dheader(obj)->flags |= SOL_DFLAG_WEAKV;
+    return obj;
 }
-/// Release a reference held to a dyn value in the C API
-static inline void sol_drelease(sol_val val) {
-    if (val.tt != SOL_TDYN || sol_dheader(val)->mark != SOL_DYN_GREEN) return;
-    sol_dheader(val)->mark = SOL_DYN_WHITE;
+/// Opens a handle scope. Values pinned with sol_hpin stay alive until the scope is closed.
+/// Scopes nest, so close them in the reverse order they were opened
+static inline uint32_t sol_hopen(sol_state *state) { return state->roots.count; }
+/// Closes a handle scope, unpinning every value pinned since the matching sol_hopen
+static inline void sol_hclose(sol_state *state, uint32_t scope) {
+    if (scope < state->roots.count)
+        state->roots.count = scope;
+}
+/// Pins a value to the innermost handle scope and returns it
+static inline sol_val sol_hpin(sol_state *state, sol_val val) {
+    sol_valvec_push(&state->roots, val);
+    return val;
 }
+/// Hold a reference to a dyn value for the C API, independent of handle scopes.
+/// Every hold is its own root, so holding a value twice needs two releases
+EXPORT sol_hold sol_dhold(sol_state *state, sol_val val);
+/// Release a reference held by sol_dhold
+EXPORT void sol_drelease(sol_state *state, sol_hold hold);
+/// Get the value behind a hold
+static inline sol_val sol_dheld(sol_state *state, sol_hold hold) { return state->holds.data[hold]; }
 
 /// Get the value of a register from a specific stack frame
 static inline sol_val sol_rawget(sol_state *state, uint32_t index, uint32_t frame) {
@@ -134,5 +274,12 @@ typedef struct {
 #include <sf/containers/expected.h>
 EXPORT sol_call_ex sol_call(sol_state *state, sol_fproto *proto, const sol_val *args, uint32_t arg_c);
 EXPORT sol_call_ex sol_dcall(sol_state *state, sol_fproto *proto, const sol_val *args, uint32_t arg_c, bool *bps);
+/// Runs a file as a module and returns what it returned. The file is path, or path with .sol
+/// added. Modules are kept by their canonical path, so importing one again by any path naming
+/// it returns the same value without compiling or running anything, and a path that's been
+/// imported by before is only a lookup
+EXPORT sol_call_ex sol_import(sol_state *state, sf_str path);
+/// Runs a module again whether it's been imported or not, and keeps what it returns this time
+EXPORT sol_call_ex sol_reload(sol_state *state, sf_str path);
 
 #endif // VM_H
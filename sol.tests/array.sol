@@ -0,0 +1,14 @@
+let primes = [2, 3, 5, 7];
+array.push(primes, 11);
+primes[0] += 0;
+
+let i = 0;
+while i < array.len(primes): {
+    io.println(primes[i]);
+    i += 1;
+}
+
+let grid = [[1, 2], [3, 4]];
+grid[1][0] = 30;
+io.println(grid[1][0]);
+array.pop(primes)
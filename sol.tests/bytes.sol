@@ -0,0 +1,16 @@
+let header = bytes.new(12);
+bytes.set(header, 0, "u32be", 1179011410);
+bytes.set(header, 4, "u32le", 36);
+bytes.set(header, 8, "f32le", 0.25);
+io.fwrite("header.bin", header);
+
+let read = io.freadb("header.bin");
+io.fremove("header.bin");
+io.println(bytes.get(read, 0, "u32be"));
+io.println(bytes.get(read, 4, "u32le"));
+io.println(bytes.get(read, 8, "f32le"));
+
+let size = bytes.slice(read, 4, 4);
+size[0] = 40;
+io.println(bytes.get(read, 4, "u32le"));
+for i, b in size: io.println(str(i) + ": " + str(b));
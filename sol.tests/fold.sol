@@ -0,0 +1,55 @@
+// Folded expressions have to give what the VM gives for the same operands
+let div = [](a, b) { return a / b; };
+let add = [](a, b) { return a + b; };
+
+let six = 6;
+let answer = six * 7;
+assert(answer == 42);
+let half = div(7, 2);
+assert(7 / 2 == half);
+let neg = -7;
+half = div(neg, 2);
+assert(neg / 2 == half);
+assert(7.0 / 2 == 3.5);
+let sum = add(1, 0.5);
+assert(1 + 0.5 == sum);
+sum = add(0.5, 1);
+assert(0.5 + 1 == sum);
+assert(3 > 2);
+assert(!(2 >= 3));
+let gt = 3 > 2;
+assert(gt == true);
+assert("ab" == "ab");
+assert("ab" != "ba");
+assert(9223372036854775807 + 1 == (-9223372036854775807) - 1);
+
+// Only lets that are never written again are propagated
+let x = 1;
+x = 2;
+assert(x + 1 == 3);
+let y = 1;
+if true: {
+    let y = 5;
+    assert(y * 2 == 10);
+}
+assert(y * 2 == 2);
+let k = 3;
+let triple = [k]() { return k * 3; };
+assert(triple() == 9);
+let n = 0;
+while false: n = 1;
+assert(n == 0);
+
+// Integer division by zero and INT64_MIN / -1 stay unfolded and fail when they run
+let zero = 0;
+let min = (-9223372036854775807) - 1;
+let neg_one = -1;
+let by_zero = attempt([zero]() { return 1 / zero; }, [](err) { return "caught"; });
+assert(by_zero == "caught");
+let overflow = attempt([min, neg_one]() { return min / neg_one; }, [](err) { return "caught"; });
+assert(overflow == "caught");
+let by_arg = attempt([div]() { return div(1, 0); }, [](err) { return "caught"; });
+assert(by_arg == "caught");
+assert(min / 1 == min);
+assert(1.0 / 0 > 1000000.0);
+io.println(answer);
@@ -0,0 +1,45 @@
+// A missing global reads as an err, not a stale or nil value
+assert(type(never_set) == "err");
+
+// Funs compiled before a global exists see it once it's set
+let read_late = []() { return late; };
+assert(type(read_late()) == "err");
+late = 1;
+assert(read_late() == 1);
+late = 2;
+assert(read_late() == 2);
+
+// Writes through the table itself are seen by slots
+_g.through = 3;
+assert(through == 3);
+obj.set(_g, "named", 4);
+assert(named == 4);
+through = 5;
+let got = obj.get(_g, "through");
+assert(got == 5);
+
+// Adding many globals reshapes the table, slots read before that still find theirs
+let first = late;
+let i = 0;
+while i < 200: {
+    obj.set(_g, "filler" + str(i), i);
+    i += 1;
+}
+assert(late == first);
+assert(filler199 == 199);
+late += 10;
+assert(read_late() == 12);
+
+// Globals written in a loop and read in a fun, and locals of the same name shadow them
+counter = 0;
+let bump = []() { counter += 1; return counter; };
+let n = 0;
+while n < 10: {
+    bump();
+    n += 1;
+}
+assert(counter == 10);
+let shadow = [](counter) { return counter * 2; };
+assert(shadow(21) == 42);
+assert(counter == 10);
+io.println(counter);
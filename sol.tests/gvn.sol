@@ -0,0 +1,55 @@
+// Every load of a fun literal makes a closure with the captures of that moment
+let x = 1;
+let a = [x]() { return x; };
+x = 2;
+let b = [x]() { return x; };
+let ab = a() * 10 + b();
+assert(ab == 12);
+let fs = [];
+let i = 0;
+while i < 3: {
+    array.push(fs, [i]() { return i * i; });
+    i += 1;
+}
+let squares = 0;
+for k, f in fs: squares = squares * 10 + f();
+assert(squares == 14);
+let make = [](n) {
+    let one = [n]() { return n; };
+    n = n + 1;
+    let two = [n]() { return n; };
+    return one() * 10 + two();
+};
+let m = make(3) + make(5) * 100;
+assert(m == 5634);
+
+// Literals that make objects make a new one every time
+let o1 = {};
+let o2 = {};
+o1.v = 1;
+assert(unwrap_or(o2.v, 0) == 0);
+let l1 = [];
+let l2 = [];
+array.push(l1, 1);
+assert(array.len(l2) == 0);
+
+// Reads after a write see the write, and calls aren't merged
+let o = { v = 1 };
+let r1 = o.v;
+o.v = 2;
+let r2 = o.v;
+assert(r1 * 10 + r2 == 12);
+calls = 0;
+let tick = []() { calls += 1; return calls; };
+let t = tick() * 10 + tick();
+assert(t == 12);
+
+// Equal computations on equal operands give one value
+let sq = [](p, q) {
+    let s1 = p * q + p * q;
+    let s2 = p * q;
+    return s1 - s2;
+};
+let sqv = sq(3, 4);
+assert(sqv == 12);
+io.println(ab);
@@ -0,0 +1,106 @@
+// Member reads are redone when the loop assigns that member, through any obj
+let cfg = { step = 1 };
+let alias = cfg;
+let total = 0;
+let i = 0;
+while i < 4: {
+    total += cfg.step;
+    alias.step = alias.step + 1;
+    i += 1;
+}
+assert(total == 10);
+let grid = { w = 2 };
+total = 0;
+i = 0;
+while i < 3: {
+    total += grid.w;
+    grid["w"] = grid.w * 2;
+    i += 1;
+}
+assert(total == 14);
+let key = "h";
+key = "w"; // Written again so it isn't folded into a literal
+total = 0;
+i = 0;
+while i < 3: {
+    total += grid.w;
+    grid[key] = 1;
+    i += 1;
+}
+assert(total == 18);
+
+// ...and when the obj it's read off is replaced
+let small = { n = 1 };
+let big = { n = 100 };
+let cur = small;
+total = 0;
+i = 0;
+while i < 3: {
+    total += cur.n;
+    cur = big;
+    i += 1;
+}
+assert(total == 201);
+
+// Global reads are redone when the loop assigns the global, by name or through _g
+speed = 1;
+total = 0;
+i = 0;
+while i < 3: {
+    total += speed;
+    speed += 1;
+    i += 1;
+}
+assert(total == 6);
+total = 0;
+i = 0;
+while i < 3: {
+    total += speed;
+    _g.speed = 10;
+    i += 1;
+}
+assert(total == 24);
+
+// An inlined call that assigns a global counts as the loop assigning it
+let set_speed = [](v) { speed = v; };
+total = 0;
+i = 0;
+while i < 3: {
+    total += speed;
+    set_speed(i + 100);
+    i += 1;
+}
+assert(total == 211);
+
+// An inner loop's writes count for the outer loop's reads
+let box = { v = 0 };
+total = 0;
+i = 0;
+while i < 3: {
+    total += box.v;
+    let j = 0;
+    while j < 2: {
+        box.v = box.v + 1;
+        j += 1;
+    }
+    i += 1;
+}
+assert(total == 6);
+
+// Reads that might not run stay where they are
+let missing = { v = 1 };
+missing = nil;
+total = 0;
+i = 0;
+while i < 3: {
+    if i > 5: { total += missing.v; }
+    i += 1;
+}
+assert(total == 0);
+i = 0;
+while i < 0: {
+    total += missing.v;
+    i += 1;
+}
+assert(total == 0);
+io.println(speed);
@@ -0,0 +1,56 @@
+// A callee reassigned in the loop is called, not inlined as its first body
+let pick = []() { return 1; };
+let total = 0;
+let i = 0;
+while i < 3: {
+    total += pick();
+    pick = []() { return 10; };
+    i += 1;
+}
+assert(total == 21);
+let swap = [](n) { return n + 1; };
+let swapped = swap(1);
+swap = [](n) { return n * 100; };
+swapped = swapped * 1000 + swap(2);
+assert(swapped == 2200);
+
+// Inlined bodies see their own names: params, and globals where the caller has locals
+shared = 7;
+let read_shared = []() { return shared; };
+let shared = 5;
+assert(read_shared() == 7);
+let inc = [](v) { v = v + 1; return v; };
+let a = 1;
+let b = inc(a);
+assert(a * 10 + b == 12);
+
+// Every way out of the body leaves the right value
+let clamp = [](v) {
+    if v < 0: { return 0; }
+    if v > 9: { return 9; }
+    return v;
+};
+let clamped = clamp(-4) * 100 + clamp(5) * 10 + clamp(40);
+assert(clamped == 59);
+let nothing = [](v) { let w = v; };
+assert(nothing(1) == nil);
+let half = [](v) { return v / 2; };
+let halves = 0;
+let j = 0;
+while j < 4: {
+    halves += half(j * 4);
+    j += 1;
+}
+assert(halves == 12);
+
+// Calls with extra args stay calls, and the extras are dropped
+let second = [](x, y) { return y; };
+let extra = second(1, 2, 3);
+assert(extra == 2);
+
+// Errors in an inlined body are still caught
+let zero = 0;
+let divide = [](v, d) { return v / d; };
+let caught = attempt([divide, zero]() { return divide(1, zero); }, [](err) { return "caught"; });
+assert(caught == "caught");
+io.println(total);
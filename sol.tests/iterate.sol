@@ -0,0 +1,9 @@
+let scores = { ada = 3 bob = 5 cy = 2 };
+let total = 0;
+for name, score in scores: {
+    io.println(name + ": " + str(score));
+    total += score;
+}
+io.println(total);
+
+for i, p in [2, 3, 5, 7]: io.println(str(i) + " -> " + str(p));
@@ -0,0 +1,89 @@
+// Else-if ladders end in jumps onto jumps, which are threaded to the final target
+let grade = [](n) {
+    let g = "f";
+    if n >= 90: { g = "a"; }
+    else: if n >= 80: { g = "b"; }
+    else: if n >= 70: { g = "c"; }
+    else: if n >= 60: { g = "d"; }
+    return g;
+};
+let grades = "";
+for i, n in [95, 85, 75, 65, 5, 90, 60]: grades = grades + grade(n);
+assert(grades == "abcdfad");
+
+// A jump onto a return becomes the return
+let sign = [](n) {
+    if n < 0: { return -1; }
+    else: if n == 0: { return 0; }
+    return 1;
+};
+let signs = sign(-5) * 100 + sign(0) * 10 + sign(7);
+assert(signs == -99);
+
+// Empty arms leave jumps to the next instruction, the one a compare skips has to stay
+let empty = [](n) {
+    let hit = 0;
+    if n < 3: {}
+    else: { hit = 1; }
+    if n == 5: { hit += 10; }
+    else: {}
+    return hit;
+};
+let e3 = empty(1) + empty(4) * 100 + empty(5) * 1000;
+assert(e3 == 11100);
+let after = [](n) {
+    let hit = 0;
+    if n < 3: {}
+    hit += 1;
+    if n == 5: {}
+    hit += 1;
+    return hit;
+};
+let a2 = after(2) + after(5) * 10 + after(0) * 100;
+assert(a2 == 222);
+
+// Conditions as values take both arms
+let lt = [](a, b) { let c = a < b; return c; };
+let nlt = [](a, b) { let c = !(a < b); return c; };
+assert(lt(1, 2) == true);
+assert(lt(2, 1) == false);
+assert(nlt(1, 2) == false);
+assert(nlt(2, 1) == true);
+
+// Loops whose bodies end in ifs jump back through the if's exit
+let collatz = [](n) {
+    let steps = 0;
+    while n != 1: {
+        if n - n / 2 * 2 == 0: { n = n / 2; }
+        else: { n = 3 * n + 1; }
+        steps += 1;
+    }
+    return steps;
+};
+let c27 = collatz(27);
+assert(c27 == 111);
+let nested = [](rows) {
+    let total = 0;
+    let i = 0;
+    while i < rows: {
+        let j = 0;
+        while j < i: {
+            if j == 2: { total += 100; }
+            else: { total += 1; }
+            j += 1;
+        }
+        i += 1;
+    }
+    return total;
+};
+let n5 = nested(5);
+assert(n5 == 208);
+let first = [](xs, want) {
+    for i, x in xs: if x == want: { return i; }
+    return -1;
+};
+let f7 = first([3, 5, 7, 9], 7);
+assert(f7 == 2);
+let f4 = first([3, 5, 7, 9], 4);
+assert(f4 == -1);
+io.println(grades);
@@ -0,0 +1,113 @@
+// Values made before a loop and read after it keep their register through the loop's temps
+let before = [](n) {
+    let keep = n * 7;
+    let i = 0;
+    let junk = 0;
+    while i < n: {
+        let t1 = i * 2;
+        let t2 = t1 + 3;
+        let t3 = t2 * t1;
+        junk = junk + t3 - t2;
+        i += 1;
+    }
+    return keep * 1000 + junk;
+};
+let b4 = before(4);
+assert(b4 == 28068);
+
+// Values carried around the loop survive what the body makes after reading them
+let fib = [](n) {
+    let a = 0;
+    let b = 1;
+    let i = 0;
+    while i < n: {
+        let next = a + b;
+        a = b;
+        b = next;
+        i += 1;
+    }
+    return a;
+};
+let f20 = fib(20);
+assert(f20 == 6765);
+
+// A value only read at the top of the next pass stays live across the back edge
+let lag = [](n) {
+    let prev = -1;
+    let out = 0;
+    let i = 0;
+    while i < n: {
+        out = out * 10 + prev + 1;
+        let cur = i * 2;
+        prev = cur;
+        i += 1;
+    }
+    return out;
+};
+let l4 = lag(4);
+assert(l4 == 135);
+
+// A value read only when a late pass takes a branch
+let late = [](n) {
+    let far = n + 100;
+    let i = 0;
+    let hit = 0;
+    while i < n: {
+        let a = i + 1;
+        let b = a * a;
+        if i == n - 1: { hit = far + b; }
+        i += 1;
+    }
+    return hit;
+};
+let lt5 = late(5);
+assert(lt5 == 130);
+
+// Nested loops: the inner loop's temps don't clobber what the outer one carries
+let grid = [](rows, cols) {
+    let total = 0;
+    let r = 0;
+    let row_mul = 1;
+    while r < rows: {
+        let c = 0;
+        let line = 0;
+        while c < cols: {
+            let cell = r * cols + c;
+            let sq = cell * cell;
+            line = line + sq - cell;
+            c += 1;
+        }
+        total = total + line * row_mul;
+        row_mul = row_mul * 2;
+        r += 1;
+    }
+    return total;
+};
+let g = grid(3, 3);
+assert(g == 2 + 2 * 38 + 4 * 128);
+
+// for loops read their cursor while writing the key and value
+let keyed = [](xs) {
+    let before_loop = 5;
+    let acc = 0;
+    for k, v in xs: {
+        let t = k * 100 + v;
+        acc = acc + t;
+    }
+    return acc * 10 + before_loop;
+};
+let kx = keyed([1, 2, 3]);
+assert(kx == 3065);
+
+// Locals that are never written read as nil, even when their register is reused
+let unset = [](n) {
+    let i = 0;
+    while i < n: {
+        let tmp = i * 3;
+        i += 1;
+    }
+    let later = nil;
+    return later;
+};
+assert(unset(3) == nil);
+io.println(f20);
@@ -0,0 +1,19 @@
+let f = typed.f64(3);
+let n = typed.i64(3);
+let b = typed.u8(3);
+assert(type(f) == "f64array");
+assert(type(n) == "i64array");
+assert(type(b) == "u8array");
+assert(type(1) == "i64");
+assert(type("s") == "str");
+
+typed.fill(f, 0.5);
+typed.fill(n, 2);
+assert(typed.sum(f) == 1.5);
+assert(typed.dot(n, n) == 12);
+let stored = attempt(
+    []() { f[0] = "s"; return true; },
+    [](err) { return false; }
+);
+assert(!stored);
+io.println(type(f) + " " + type(n) + " " + type(b));
@@ -1,6 +1,7 @@
 #include "sol/bytecode.h"
 #include "sf/str.h"
 #include <stdlib.h>
+#include <string.h>
 
 #define MAP_NAME sol_pp
 #define MAP_K sf_str
@@ -24,11 +25,6 @@
 #define KCLEANUP sf_str_free
 #include <sf/containers/map.h>
 
-void _dobj_foreach(void *_u, sf_str k, sol_val _v) { (void)_u;(void)_v; sf_str_free(k); }
-void _sol_dobj_cleanup(sol_dobj *obj) {
-    sol_dobj_foreach(obj, _dobj_foreach, NULL);
-}
-
 sol_fproto sol_fproto_new(void) {
     return (sol_fproto){
         .tt = SOL_FPROTO_BC,
@@ -38,6 +34,7 @@ sol_fproto sol_fproto_new(void) {
         .arg_c = 0,
         .entry = 0,
         .dbg_res = 0, .dbg_ll = 0,
+        .dbg = NULL, .dbg_len = 0, .dbg_lines = NULL, .borrowed = false,
         .file_name = SF_STR_EMPTY,
         .constants = sol_valvec_new(),
         .upvals = NULL,
@@ -58,8 +55,13 @@ sol_fproto sol_fproto_c(sol_cfunction c_fun, uint32_t arg_c, uint32_t temp_c) {
 
 void sol_fproto_free(sol_fproto *proto) {
     if (proto->tt == SOL_FPROTO_BC && proto->code) {
-        free(proto->code);
-        if (proto->dbg) free(proto->dbg);
+        if (!proto->borrowed) {
+            free(proto->code);
+            if (proto->dbg) free(proto->dbg);
+        }
+        if (proto->dbg_lines) free(proto->dbg_lines);
+        proto->dbg = NULL;
+        proto->dbg_lines = NULL;
     }
     proto->code = NULL;
     proto->c_fun = NULL;
@@ -75,18 +77,164 @@ void sol_fproto_free(sol_fproto *proto) {
     proto->reg_c = 0;
 }
 
-void sol_dclean(sol_val val) {
+static uint8_t *sol_varint(uint8_t *out, uint64_t v) {
+    while (v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
+/// Reads a varint that has to end before end, returns NULL if it doesn't
+static const uint8_t *sol_unvarint(const uint8_t *in, const uint8_t *end, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        *v |= (uint64_t)(*in & 0x7F) << shift;
+        if (!(*in++ & 0x80)) return in;
+    }
+    return NULL;
+}
+
+uint8_t *sol_dbgencode(const sol_dbgpos *pos, uint32_t count, uint32_t *len) {
+    // A run takes at most 5 + 10 + 5 bytes
+    uint8_t *data = malloc((size_t)count * 20 + 1), *out = data;
+    uint32_t line = 0;
+    for (uint32_t i = 0; i < count;) {
+        uint32_t run = 1;
+        while (i + run < count && pos[i + run].line == pos[i].line && pos[i + run].column == pos[i].column)
+            ++run;
+        int64_t delta = (int64_t)pos[i].line - line;
+        out = sol_varint(out, run);
+        out = sol_varint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        out = sol_varint(out, pos[i].column);
+        line = pos[i].line;
+        i += run;
+    }
+    *len = (uint32_t)(out - data);
+    return realloc(data, *len ? *len : 1);
+}
+
+/// Walks a line table run by run
+typedef struct {
+    const uint8_t *in, *end;
+    uint32_t run;
+    sol_dbgpos pos;
+} sol_dbgit;
+
+/// Decodes the next run. Stops at the end of the table, or at a run cut off by it
+static bool sol_dbgnext(sol_dbgit *it) {
+    if (it->in >= it->end) return false;
+    uint64_t run, zz, col;
+    const uint8_t *in = sol_unvarint(it->in, it->end, &run);
+    if (in) in = sol_unvarint(in, it->end, &zz);
+    if (in) in = sol_unvarint(in, it->end, &col);
+    if (!in) {
+        it->in = it->end;
+        return false;
+    }
+    it->in = in;
+    it->run = (uint32_t)run;
+    it->pos.line += (uint32_t)((zz >> 1) ^ (0 - (zz & 1)));
+    it->pos.column = (uint32_t)col;
+    return true;
+}
+
+bool sol_dbgcheck(const uint8_t *dbg, uint32_t len, uint32_t code_c, uint32_t line_c) {
+    sol_dbgit it = {dbg, dbg + len, 0, {0, 0}};
+    uint64_t pc = 0;
+    while (it.in < it.end) {
+        if (!sol_dbgnext(&it)) return false;
+        pc += it.run;
+        if (it.run == 0 || pc > code_c || it.pos.line > line_c) return false;
+    }
+    return pc == code_c;
+}
+
+sol_dbgpos sol_dbgat(const sol_fproto *proto, uint32_t pc) {
+    sol_dbgit it = {proto->dbg, proto->dbg + proto->dbg_len, 0, {0, 0}};
+    while (sol_dbgnext(&it)) {
+        if (pc < it.run) return it.pos;
+        pc -= it.run;
+    }
+    return (sol_dbgpos){0, 0};
+}
+
+void sol_dbgexpand(const sol_fproto *proto, sol_dbgpos *out) {
+    sol_dbgit it = {proto->dbg, proto->dbg + proto->dbg_len, 0, {0, 0}};
+    uint32_t pc = 0;
+    while (pc < proto->code_c && sol_dbgnext(&it))
+        for (uint32_t i = 0; i < it.run && pc < proto->code_c; ++i)
+            out[pc++] = it.pos;
+    while (pc < proto->code_c)
+        out[pc++] = (sol_dbgpos){0, 0};
+}
+
+const uint32_t *sol_dbglines(sol_fproto *proto) {
+    if (proto->dbg_lines) return proto->dbg_lines;
+    sol_dbgpos *pos = malloc(sizeof(sol_dbgpos) * (proto->code_c ? proto->code_c : 1));
+    sol_dbgexpand(proto, pos);
+    proto->dbg_lines = malloc(sizeof(uint32_t) * (proto->code_c ? proto->code_c : 1));
+    for (uint32_t pc = 0; pc < proto->code_c; ++pc)
+        proto->dbg_lines[pc] = pos[pc].line;
+    free(pos);
+    return proto->dbg_lines;
+}
+
+sol_val sol_dnstatic(sol_dtype tt) {
+    sol_dalloc *dh = calloc(1, sizeof(sol_dalloc) + sol_dtsize(tt));
+    *dh = (sol_dalloc){
+        .tt = (uint8_t)tt,
+        .sc = SOL_SC_STATIC,
+    };
+    return (sol_val){SOL_TDYN, .dyn = dh + 1};
+}
+
+void sol_dclear(sol_val val) {
     sol_dalloc *dh = sol_dheader(val);
     if (!dh) return;
     switch (dh->tt) {
         case SOL_DSTR:
+            if (!((sol_dstr *)val.dyn)->parent)
+                sf_str_free(*(sf_str *)val.dyn);
+            break;
         case SOL_DERR: sf_str_free(*(sf_str *)val.dyn); break;
         case SOL_DOBJ: sol_dobj_free(val.dyn); break;
         case SOL_DARRAY: sol_valvec_free(val.dyn); break;
         case SOL_DFUN: sol_fproto_free((sol_fproto *)val.dyn); break;
+        case SOL_DUSR: {
+            sol_usrwrap *w = sol_uheader(val);
+            if (w->del) w->del(sol_uptr(val));
+            sf_str_free(w->name);
+            break;
+        }
         default: break;
     }
-    free(dh);
+}
+
+void sol_dclean(sol_val val) {
+    sol_dclear(val);
+    if (val.tt == SOL_TDYN && sol_dheader(val)->sc == SOL_SC_STATIC)
+        free(sol_dheader(val));
+}
+
+void sol_dunview(sol_val str) {
+    sol_dstr *ds = str.dyn;
+    if (!ds->parent) return;
+    char *buf = malloc(ds->str.len + 1);
+    memcpy(buf, ds->str.c_str, ds->str.len);
+    buf[ds->str.len] = '\0';
+    ds->str = sf_own(buf);
+    ds->parent = NULL;
+}
+
+sf_str sol_dcstr(sol_val str) {
+    sol_dstr *ds = str.dyn;
+    if (ds->parent) {
+        sf_str parent = ((sol_dstr *)ds->parent)->str;
+        if (ds->str.c_str + ds->str.len != parent.c_str + parent.len) // Suffixes share the terminator
+            sol_dunview(str);
+    }
+    return ds->str;
 }
 
 const char *SOL_ERR_STRINGS[SOL_ERR_COUNT] = {
@@ -206,6 +354,43 @@ const sol_inssig SOL_OP_INFO[SOL_OP_COUNT] = {
         .mnemonic = "GUPO",
         .type = SOL_INS_ABC,
     },
+    [SOL_OP_GSET] = {
+        .opcode = SOL_OP_GSET,
+        .mnemonic = "GSET",
+        .type = SOL_INS_AB,
+    },
+    [SOL_OP_GGET] = {
+        .opcode = SOL_OP_GGET,
+        .mnemonic = "GGET",
+        .type = SOL_INS_AB,
+    },
+
+    [SOL_OP_ARR] = {
+        .opcode = SOL_OP_ARR,
+        .mnemonic = "ARR",
+        .type = SOL_INS_A,
+    },
+    [SOL_OP_PUSH] = {
+        .opcode = SOL_OP_PUSH,
+        .mnemonic = "PUSH",
+        .type = SOL_INS_AB,
+    },
+    [SOL_OP_IGET] = {
+        .opcode = SOL_OP_IGET,
+        .mnemonic = "IGET",
+        .type = SOL_INS_ABC,
+    },
+    [SOL_OP_ISET] = {
+        .opcode = SOL_OP_ISET,
+        .mnemonic = "ISET",
+        .type = SOL_INS_ABC,
+    },
+
+    [SOL_OP_NEXT] = {
+        .opcode = SOL_OP_NEXT,
+        .mnemonic = "NEXT",
+        .type = SOL_INS_AB,
+    },
 
     [SOL_OP_UNKNOWN] = {
         .opcode = SOL_OP_UNKNOWN,
@@ -226,6 +411,7 @@ const char *SOL_TYPE_NAMES[(size_t)SOL_TCOUNT + (size_t)SOL_DCOUNT] = {
     "array",
     "fun",
     "ref",
+    "weak",
 
     "usr",
 };
@@ -242,10 +428,11 @@ sf_str sol_dasmi(sol_instruction ins) {
 
 sf_str sol_dasmp(sol_fproto *p) {
     sf_str final = SF_STR_EMPTY;
+    sol_dbgpos *pos = malloc(sizeof(sol_dbgpos) * (p->code_c ? p->code_c : 1));
+    sol_dbgexpand(p, pos);
     for (uint32_t pc = 0; pc < p->code_c; ++pc) {
         sf_str bc = sol_dasmi(p->code[pc]);
-        uint16_t line = SOL_DBG_LINE(p->dbg[pc]), column = SOL_DBG_COL(p->dbg[pc]);
-        sf_str f = sf_str_fmt("%.2u:%-6.2u%s\n", line, column, bc.c_str);
+        sf_str f = sf_str_fmt("%.2u:%-6.2u%s\n", pos[pc].line, pos[pc].column, bc.c_str);
         sf_str_free(bc);
         if (sf_isempty(final))
             final = f;
@@ -254,5 +441,6 @@ sf_str sol_dasmp(sol_fproto *p) {
             sf_str_free(f);
         }
     }
+    free(pos);
     return final;
 }
@@ -0,0 +1,147 @@
+#include "sol/bytes.h"
+#include "sol/vm.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *SOL_BK_NAMES[SOL_BK_COUNT] = {"u8", "i8", "u16", "i16", "u32", "i32", "i64", "f32", "f64"};
+static const size_t SOL_BK_SIZES[SOL_BK_COUNT] = {1, 1, 2, 2, 4, 4, 8, 4, 8};
+
+static sf_str sol_bytostring(void *ptr) {
+    return sf_str_fmt("bytes(%zu)", ((sol_bytes *)ptr)->len);
+}
+
+sol_val sol_bynew(sol_state *state, const void *data, size_t len) {
+    if (len > SIZE_MAX - sizeof(sol_bytes))
+        return SOL_NIL;
+    sol_val usr = sol_dnewusr(state, sizeof(sol_bytes) + len, sf_lit("bytes"), NULL, NULL, sol_bytostring);
+    if (usr.tt == SOL_TNIL) return usr;
+    sol_bytes *b = sol_uptr(usr);
+    *b = (sol_bytes){b->buf, len, SOL_NIL};
+    if (data && len) memcpy(b->buf, data, len);
+    return usr;
+}
+
+sol_bytes *sol_byof(sol_val val) {
+    if (!sol_isdtype(val, SOL_DUSR) || sol_uheader(val)->tostring != sol_bytostring)
+        return NULL;
+    return sol_uptr(val);
+}
+
+sol_val sol_byslice(sol_state *state, sol_val bytes, size_t start, size_t len) {
+    sol_bytes *src = sol_byof(bytes);
+    sol_val usr = sol_dnewusr(state, sizeof(sol_bytes), sf_lit("bytes"), NULL, NULL, sol_bytostring);
+    if (usr.tt == SOL_TNIL) return usr;
+    // Slices of slices point at the original owner, so there's never a chain to keep alive
+    *(sol_bytes *)sol_uptr(usr) = (sol_bytes){src->data + start, len, src->owner.tt == SOL_TNIL ? bytes : src->owner};
+    return usr;
+}
+
+bool sol_bykind(sf_str name, sol_bytekind *out) {
+    bool be = name.len > 2 && (sf_str_eq(sf_ref(name.c_str + name.len - 2), sf_lit("be")) ||
+        sf_str_eq(sf_ref(name.c_str + name.len - 2), sf_lit("le")));
+    size_t base = be ? name.len - 2 : name.len;
+    for (int k = 0; k < SOL_BK_COUNT; ++k) {
+        if (strlen(SOL_BK_NAMES[k]) != base || memcmp(SOL_BK_NAMES[k], name.c_str, base) != 0)
+            continue;
+        *out = (sol_bytekind)k;
+        if (be && name.c_str[name.len - 2] == 'b') *out |= SOL_BK_BE;
+        return true;
+    }
+    return false;
+}
+
+size_t sol_bysize(sol_bytekind kind) { return SOL_BK_SIZES[kind & ~(unsigned)SOL_BK_BE]; }
+
+// Scalars are assembled a byte at a time, which is independent of the host's byte order.
+// Compilers turn these loops into a single load or store (plus a swap for the other order)
+
+static inline uint64_t sol_byload(const uint8_t *p, size_t n, bool be) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i)
+        v |= (uint64_t)p[be ? n - 1 - i : i] << (8 * i);
+    return v;
+}
+static inline void sol_bystore(uint8_t *p, size_t n, bool be, uint64_t v) {
+    for (size_t i = 0; i < n; ++i)
+        p[be ? n - 1 - i : i] = (uint8_t)(v >> (8 * i));
+}
+
+bool sol_byget(sol_bytes *b, size_t off, sol_bytekind kind, sol_val *out) {
+    size_t n = sol_bysize(kind);
+    if (off > b->len || n > b->len - off)
+        return false;
+    uint64_t raw = sol_byload(b->data + off, n, kind & SOL_BK_BE);
+    switch (kind & ~(unsigned)SOL_BK_BE) {
+        case SOL_BK_I8: raw = (uint64_t)(int64_t)(int8_t)raw; break;
+        case SOL_BK_I16: raw = (uint64_t)(int64_t)(int16_t)raw; break;
+        case SOL_BK_I32: raw = (uint64_t)(int64_t)(int32_t)raw; break;
+        case SOL_BK_F32: {
+            uint32_t r32 = (uint32_t)raw;
+            float f;
+            memcpy(&f, &r32, sizeof(f));
+            *out = (sol_val){SOL_TF64, .f64 = f};
+            return true;
+        }
+        case SOL_BK_F64: {
+            sol_f64 f;
+            memcpy(&f, &raw, sizeof(f));
+            *out = (sol_val){SOL_TF64, .f64 = f};
+            return true;
+        }
+        default: break;
+    }
+    *out = (sol_val){SOL_TI64, .i64 = (sol_i64)raw};
+    return true;
+}
+
+bool sol_byset(sol_bytes *b, size_t off, sol_bytekind kind, sol_val val) {
+    size_t n = sol_bysize(kind);
+    if (off > b->len || n > b->len - off)
+        return false;
+    if (val.tt != SOL_TI64 && val.tt != SOL_TF64)
+        return false;
+
+    uint64_t raw;
+    switch (kind & ~(unsigned)SOL_BK_BE) {
+        case SOL_BK_F32: {
+            float f = (float)(val.tt == SOL_TF64 ? val.f64 : (sol_f64)val.i64);
+            uint32_t r32;
+            memcpy(&r32, &f, sizeof(f));
+            raw = r32;
+            break;
+        }
+        case SOL_BK_F64: {
+            sol_f64 f = val.tt == SOL_TF64 ? val.f64 : (sol_f64)val.i64;
+            memcpy(&raw, &f, sizeof(f));
+            break;
+        }
+        default: raw = (uint64_t)(val.tt == SOL_TI64 ? val.i64 : (sol_i64)val.f64); break;
+    }
+    sol_bystore(b->data + off, n, kind & SOL_BK_BE, raw);
+    return true;
+}
+
+sol_val sol_byread(sol_state *state, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return SOL_NIL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return SOL_NIL;
+    }
+
+    sol_val bytes = sol_bynew(state, NULL, (size_t)size);
+    if (bytes.tt != SOL_TNIL && fread(sol_byof(bytes)->data, 1, (size_t)size, f) != (size_t)size)
+        bytes = SOL_NIL;
+    fclose(f);
+    return bytes;
+}
+
+bool sol_bywrite(sol_bytes *b, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(b->data, 1, b->len, f) == b->len;
+    return fclose(f) == 0 && ok;
+}
@@ -1,10 +1,12 @@
 #include "sol/bytecode.h"
+#include "sol/image.h"
 #include "sol/solc.h"
 #include "sol/vm.h"
 #include "sol/cli.h"
 #include <sf/str.h>
 #include <sf/fs.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -16,11 +18,16 @@
 typedef enum {
     CLI_RUN,
     CLI_DBG,
+    CLI_COMPILE,
 } cli_mode;
 
-void cli_highlight_line(sf_str src, sf_str err, uint16_t line, uint16_t column) {
+void cli_highlight_line(sf_str src, sf_str err, uint32_t line, uint16_t column) {
+    if (sf_isempty(src)) { // Images are run without their source
+        fprintf(stderr, TUI_ERR "%s\n" TUI_CLR, err.c_str);
+        return;
+    }
     char *c = src.c_str, *cc = c;
-    uint16_t ln = 1;
+    uint32_t ln = 1;
     while (true) {
         if (*c == '\n')
             ++ln;
@@ -48,7 +55,7 @@ void cli_highlight_line(sf_str src, sf_str err, uint16_t line, uint16_t column)
 }
 
 sf_str cli_load_file(char *name) {
-    sf_str f = sf_lit(name);
+    sf_str f = sf_ref(name);
     if (!sf_file_exists(f)) {
         fprintf(stderr, TUI_ERR "error: file '%s' not found.", name);
         return SF_STR_EMPTY;
@@ -67,9 +74,22 @@ sf_str cli_load_file(char *name) {
     return sf_own((char *)fsb.ok.ptr);
 }
 
+/// Where compiled images are cached: $SOLUS_CACHE (empty turns caching off), otherwise
+/// solus/ under $XDG_CACHE_HOME or ~/.cache
+static sf_str cli_cache_dir(void) {
+    const char *dir = getenv("SOLUS_CACHE");
+    if (dir) return *dir ? sf_str_cdup(dir) : SF_STR_EMPTY;
+    if ((dir = getenv("XDG_CACHE_HOME")) && *dir)
+        return sf_str_fmt("%s/solus", dir);
+    if ((dir = getenv("HOME")) && *dir)
+        return sf_str_fmt("%s/.cache/solus", dir);
+    return SF_STR_EMPTY;
+}
+
 int cli_run(char *path, sf_str src) {
     sol_state *s = sol_state_new();
     sol_usestd(s);
+    s->cache = cli_cache_dir();
     sol_compile_ex comp_ex = sol_cfile(s, sf_ref(path));
     if (!comp_ex.is_ok) {
         fprintf(stderr, TUI_ERR "error: %s:%u:%u\n" TUI_CLR, path, comp_ex.err.line, comp_ex.err.column);
@@ -81,7 +101,9 @@ int cli_run(char *path, sf_str src) {
     sol_fproto *fun = &comp_ex.ok;
     sol_call_ex call_ex = sol_call(s, fun, NULL, 0);
     if (!call_ex.is_ok) {
-        uint16_t line = SOL_DBG_LINE(fun->dbg[call_ex.err.pc]), col = SOL_DBG_COL(fun->dbg[call_ex.err.pc]);
+        sol_dbgpos pos = sol_dbgat(fun, (uint32_t)call_ex.err.pc);
+        uint32_t line = pos.line;
+        uint16_t col = (uint16_t)pos.column;
         fprintf(stderr, TUI_ERR "error: %s:%u:%u\n" TUI_CLR, path, line, col);
 
         if (!sf_isempty(call_ex.err.panic)) {
@@ -104,9 +126,27 @@ int cli_run(char *path, sf_str src) {
     return 0;
 }
 
+/// Writes the image of a source next to it, or to out
+int cli_compile(char *path, sf_str src, char *out) {
+    sf_str name = sf_ref(path);
+    bool sol = name.len > 4 && sf_str_eq(sf_ref(path + name.len - 4), sf_lit(".sol"));
+    sf_str dst = out ? sf_str_cdup(out) : sf_str_fmt(sol ? "%sc" : "%s" SOL_IMAGE_EXT, path);
+
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    sol_compile_err err = sol_cimage(s, name, dst);
+    if (err.tt != SOL_ERRC_NONE) {
+        fprintf(stderr, TUI_ERR "error: %s:%u:%u\n" TUI_CLR, err.tt == SOL_ERRC_FILE_UNWRITABLE ? dst.c_str : path, err.line, err.column);
+        cli_highlight_line(err.line ? src : SF_STR_EMPTY, sol_err_string(err.tt), err.line, err.column);
+    }
+    sol_state_free(s);
+    sf_str_free(dst);
+    return err.tt == SOL_ERRC_NONE ? 0 : -1;
+}
+
 int main(int argc, char **argv) {
     if (argc == 1) {
-        printf("Usage: %s [run|dbg] <file>\n", argv[0]);
+        printf("Usage: %s [run|dbg|compile] <file>\n", argv[0]);
         return 1;
     }
 
@@ -123,19 +163,32 @@ int main(int argc, char **argv) {
             return 1;
         }
         mode = CLI_DBG;
+    } else if (!strcmp(argv[1], "compile")) {
+        if (argc == 2) {
+            printf("Usage: %s compile <file> [out]\n", argv[0]);
+            return 1;
+        }
+        mode = CLI_COMPILE;
     } else {
-        printf("Unknown option '%s'.\nUsage: %s [run|dbg] <file>\n", argv[1], argv[0]);
+        printf("Unknown option '%s'.\nUsage: %s [run|dbg|compile] <file>\n", argv[1], argv[0]);
         return 1;
     }
 
-    sf_str src = cli_load_file(argv[2]);
-    if (sf_isempty(src))
+    sf_str ext = sf_lit(SOL_IMAGE_EXT), name = sf_ref(argv[2]);
+    bool image = name.len > ext.len && sf_str_eq(sf_ref(argv[2] + name.len - ext.len), ext);
+    if (image && mode != CLI_RUN) {
+        fprintf(stderr, TUI_ERR "error: '%s' is compiled, %s needs its source\n" TUI_CLR, argv[2], argv[1]);
+        return 1;
+    }
+    sf_str src = image ? SF_STR_EMPTY : cli_load_file(argv[2]);
+    if (!image && sf_isempty(src))
         return 1;
 
     int ret = 0;
     switch (mode) {
         case CLI_RUN: ret = cli_run(argv[2], src); break;
         case CLI_DBG: ret = sol_cli_cbg(argv[2], src); break;
+        case CLI_COMPILE: ret = cli_compile(argv[2], src, argc > 3 ? argv[3] : NULL); break;
     }
     sf_str_free(src);
     return ret;
@@ -144,14 +144,14 @@ static int sol_rdcmd(void) {
             sol_writeout(p);
             sf_str_free(p);
         } else if (e.err.tt == SOL_ERRV_BREAK) {
-            dbg.cur = SOL_DBG_LINE(dbg.proto.dbg[e.err.pc]);
+            dbg.cur = (int)sol_dbglines(&dbg.proto)[e.err.pc];
             dbg.line_o = dbg.cur;
             dbg._break = dbg.cur;
             dbg.pane = SOL_DBG_STACK;
             sol_cmderr(sf_lit("BREAK"));
         } else {
-            uint16_t line = SOL_DBG_LINE(dbg.proto.dbg[e.err.pc]), column = SOL_DBG_COL(dbg.proto.dbg[e.err.pc]);
-            sf_str p = sf_str_fmt(e.err.tt == SOL_ERRV_PANIC ? "panic: %s:%u:%u %s\n" : "error: %s:%u:%u %s\n", dbg.path, line, column,
+            sol_dbgpos pos = sol_dbgat(&dbg.proto, (uint32_t)e.err.pc);
+            sf_str p = sf_str_fmt(e.err.tt == SOL_ERRV_PANIC ? "panic: %s:%u:%u %s\n" : "error: %s:%u:%u %s\n", dbg.path, pos.line, pos.column,
                 (e.err.panic.len > 0 ? e.err.panic : sol_err_string(e.err.tt)).c_str
             );
             sol_writeout(p);
@@ -225,13 +225,13 @@ static int sol_rdcmd(void) {
 static void sol_drawsrc(void) {
     werase(dbg.src_w);
     wmove(dbg.src_w, 1, 0);
-    uint16_t line = 1;
+    int line = 1;
     char *cs, *c = dbg.src.c_str, *end = dbg.src.c_str + dbg.src.len;
     cs = c;
     while (c < end) {
         if (*c == '\n') {
             if (line > dbg.line_o - 1)
-                mvwprintw(dbg.src_w, line - (dbg.line_o - 1), 2, "%c%4u %c %.*s\n",
+                mvwprintw(dbg.src_w, line - (dbg.line_o - 1), 2, "%c%4d %c %.*s\n",
                     dbg.bp && dbg.bp[line - 1] ? (dbg._break == line ? '#' : 'o') : ' ',
                     line,
                     dbg.cur == line ? '>' : '|',
@@ -243,7 +243,7 @@ static void sol_drawsrc(void) {
         c++;
     }
     if (cs < end && line > dbg.line_o - 1)
-        mvwprintw(dbg.src_w, line - (dbg.line_o - 1), 2, "%c%4u %c %.*s\n",
+        mvwprintw(dbg.src_w, line - (dbg.line_o - 1), 2, "%c%4d %c %.*s\n",
             dbg.bp && dbg.bp[line - 1] ? (dbg._break == line ? '#' : 'o') : ' ',
             line,
             dbg.cur == line ? '>' : '|',
@@ -252,7 +252,7 @@ static void sol_drawsrc(void) {
 
     if (!dbg.bp)
         dbg.bp = calloc((size_t)dbg.proto.line_c, sizeof(bool));
-    dbg.proto.line_c = line;
+    dbg.proto.line_c = (uint32_t)line;
 
     box(dbg.src_w, 0, 0);
     mvwprintw(dbg.src_w, 0, 2, "src");
@@ -262,37 +262,39 @@ static void sol_drawsrc(void) {
 static void sol_drawasm(void) {
     werase(dbg.asm_w);
 
-    sol_dbg *db = dbg.proto.dbg,
-            *end = dbg.proto.dbg + dbg.proto.code_c;
-    if (!db) {
+    if (!dbg.proto.dbg) {
         mvwprintw(dbg.asm_w, 1, 1, "Assembly unavailable.");
         box(dbg.asm_w, 0, 0);
         mvwprintw(dbg.asm_w, 0, 2, "asm");
         wrefresh(dbg.asm_w);
         return;
     }
+    sol_dbgpos *db = malloc(sizeof(sol_dbgpos) * (dbg.proto.code_c ? dbg.proto.code_c : 1)),
+               *end = db + dbg.proto.code_c;
+    sol_dbgexpand(&dbg.proto, db);
 
-    sol_dbg *cur_db = db;  // start with first entry
-    for (sol_dbg *it = db; it < end; ++it) {
-        int line = (int)SOL_DBG_LINE(*it);
+    sol_dbgpos *cur_db = db;  // start with first entry
+    for (sol_dbgpos *it = db; it < end; ++it) {
+        int line = (int)it->line;
         if (line <= dbg.cur) {
-            if ((int)SOL_DBG_LINE(*cur_db) < line)
+            if ((int)cur_db->line < line)
                 cur_db = it;
         } else
             break;
     }
 
     int y = 1;
-    for (sol_dbg *it = cur_db; it < end && ((int)SOL_DBG_LINE(*it) <= dbg.cur || !dbg.cap_cur); ++it, ++y) {
-        sol_instruction ins = dbg.proto.code[it - dbg.proto.dbg];
+    for (sol_dbgpos *it = cur_db; it < end && ((int)it->line <= dbg.cur || !dbg.cap_cur); ++it, ++y) {
+        sol_instruction ins = dbg.proto.code[it - db];
         const char *op = sol_op_info(sol_ins_op(ins))->mnemonic;
-        uint16_t line = SOL_DBG_LINE(*it), column = SOL_DBG_COL(*it);
+        uint32_t line = it->line, column = it->column;
         switch (sol_op_info(sol_ins_op(ins))->type) {
             case SOL_INS_A: mvwprintw(dbg.asm_w, y, 1, "%4u:%-3u %-7s %-8d", line, column, op, sol_ia_a(ins)); break;
             case SOL_INS_AB: mvwprintw(dbg.asm_w, y, 1, "%4u:%-3u %-7s %-4u %-4u", line, column, op, sol_iab_a(ins), sol_iab_b(ins)); break;
             case SOL_INS_ABC: mvwprintw(dbg.asm_w, y, 1, "%4u:%-3u %-7s %-4u %-4u %-4u", line, column, op, sol_iabc_a(ins), sol_iabc_b(ins), sol_iabc_c(ins)); break;
         }
     }
+    free(db);
 
     box(dbg.asm_w, 0, 0);
     mvwprintw(dbg.asm_w, 0, 2, "asm");
@@ -403,7 +405,7 @@ static void sol_drawcmd(void) {
             if (dbg.cur < dbg.line_o)
                 --dbg.line_o;
         } else if (ch == KEY_DOWN) {
-            if (dbg.cur < dbg.proto.line_c) dbg.cur += 1;
+            if ((uint32_t)dbg.cur < dbg.proto.line_c) dbg.cur += 1;
             if (dbg.cur - (dbg.line_o - 1) > dbg.src_h)
                 ++dbg.line_o;
         } else if (isprint(ch) && dbg.cmd_len < CMD_MAX - 1) {
@@ -0,0 +1,336 @@
+#include "sol/bytecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOL_DOBJ_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline uint32_t sol_ctz32(uint32_t x) { unsigned long i; _BitScanForward(&i, x); return (uint32_t)i; }
+#else
+static inline uint32_t sol_ctz32(uint32_t x) { return (uint32_t)__builtin_ctz(x); }
+#endif
+
+#define SOL_CTRL_EMPTY 0x80
+#define SOL_CTRL_DELETED 0xFE
+#define SOL_DOBJ_MINCAP 4
+#define SOL_DOBJ_MINARR 4
+
+/// sf_str_hash barely changes between keys that differ in their last byte, so it's mixed
+/// before being split into a group index (h1) and the 7 control bits (h2)
+static inline uint64_t sol_dobj_hash(sf_str key) {
+    uint64_t h = sf_str_hash(key) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+static inline uint8_t sol_h2(uint64_t hash) { return (uint8_t)(hash >> 57); }
+static inline uint32_t sol_h1(uint64_t hash) { return (uint32_t)hash; }
+
+static inline uint32_t sol_dobj_groups(const sol_dobj *obj) {
+    return obj->cap > SOL_DOBJ_GROUP ? obj->cap / SOL_DOBJ_GROUP : 1;
+}
+/// Tables hold 7/8 of their capacity before growing, small ones leave a single slot empty
+static inline uint32_t sol_dobj_maxload(uint32_t cap) {
+    return cap > 8 ? cap - cap / 8 : cap - 1;
+}
+
+// Group matching, each returns a bitmask with bit i set for ctrl byte i
+
+static inline uint32_t sol_gmatch(const uint8_t *g, uint8_t h2) {
+#if defined(SOL_DOBJ_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)g);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < SOL_DOBJ_GROUP; ++i)
+        m |= (uint32_t)(g[i] == h2) << i;
+    return m;
+#endif
+}
+static inline uint32_t sol_gempty(const uint8_t *g) { return sol_gmatch(g, SOL_CTRL_EMPTY); }
+/// Empty and deleted are the only control bytes with the high bit set
+static inline uint32_t sol_gfree(const uint8_t *g) {
+#if defined(SOL_DOBJ_SSE2)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)g));
+#else
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < SOL_DOBJ_GROUP; ++i)
+        m |= (uint32_t)(g[i] >> 7) << i;
+    return m;
+#endif
+}
+
+/// Finds the slot of a key, or UINT32_MAX
+static inline uint32_t sol_dobj_find(const sol_dobj *obj, sf_str key, uint64_t hash) {
+    if (obj->cap == 0) return UINT32_MAX;
+    uint32_t gmask = sol_dobj_groups(obj) - 1, g = sol_h1(hash) & gmask;
+    uint8_t h2 = sol_h2(hash);
+    for (uint32_t step = 1;; ++step) {
+        const uint8_t *ctrl = obj->ctrl + (size_t)g * SOL_DOBJ_GROUP;
+        for (uint32_t m = sol_gmatch(ctrl, h2); m; m &= m - 1) {
+            uint32_t i = g * SOL_DOBJ_GROUP + sol_ctz32(m);
+            sol_dobj_slot *slot = obj->slots + i;
+            if (slot->hash == hash && sf_str_eq(slot->key, key))
+                return i;
+        }
+        // A group with an empty byte was never full, so no key probed past it
+        if (sol_gempty(ctrl) || step > gmask) return UINT32_MAX;
+        g = (g + step) & gmask;
+    }
+}
+
+/// Finds the first empty or deleted slot on the probe sequence of a hash
+static uint32_t sol_dobj_findfree(const sol_dobj *obj, uint64_t hash) {
+    uint32_t gmask = sol_dobj_groups(obj) - 1, g = sol_h1(hash) & gmask;
+    uint32_t valid = obj->cap < SOL_DOBJ_GROUP ? (1u << obj->cap) - 1 : 0xFFFF;
+    for (uint32_t step = 1;; ++step) {
+        uint32_t m = sol_gfree(obj->ctrl + (size_t)g * SOL_DOBJ_GROUP) & valid;
+        if (m) return g * SOL_DOBJ_GROUP + sol_ctz32(m);
+        g = (g + step) & gmask;
+    }
+}
+
+/// Moves every member into a fresh table of the given capacity, dropping tombstones
+static void sol_dobj_resize(sol_dobj *obj, uint32_t cap) {
+    size_t ctrl_c = cap < SOL_DOBJ_GROUP ? SOL_DOBJ_GROUP : cap;
+    sol_dobj_slot *slots = malloc(sizeof(sol_dobj_slot) * cap + ctrl_c);
+    uint8_t *ctrl = (uint8_t *)(slots + cap);
+    memset(ctrl, SOL_CTRL_EMPTY, ctrl_c);
+
+    sol_dobj old = *obj;
+    obj->ctrl = ctrl;
+    obj->slots = slots;
+    obj->cap = cap;
+    obj->growth_left = sol_dobj_maxload(cap) - old.pair_count;
+    ++obj->shape;
+    for (uint32_t i = 0; i < old.cap; ++i) {
+        if (old.ctrl[i] & 0x80) continue;
+        sol_dobj_slot *slot = old.slots + i;
+        uint32_t n = sol_dobj_findfree(obj, slot->hash);
+        obj->ctrl[n] = sol_h2(slot->hash);
+        obj->slots[n] = *slot;
+    }
+    free(old.slots);
+}
+
+/// Inserts or replaces a hash member, taking ownership of the key.
+/// Returns whether the member is new
+static bool sol_dobj_hset(sol_dobj *obj, sf_str key, sol_val val) {
+    uint64_t hash = sol_dobj_hash(key);
+    uint32_t i = sol_dobj_find(obj, key, hash);
+    if (i != UINT32_MAX) {
+        sf_str_free(key);
+        obj->slots[i].val = val;
+        return false;
+    }
+
+    if (obj->cap == 0) sol_dobj_resize(obj, SOL_DOBJ_MINCAP);
+    i = sol_dobj_findfree(obj, hash);
+    if (obj->ctrl[i] == SOL_CTRL_EMPTY && obj->growth_left == 0) {
+        // Rehash in place if deletes left enough room, otherwise grow
+        bool grow = obj->pair_count >= sol_dobj_maxload(obj->cap) / 2;
+        sol_dobj_resize(obj, grow ? obj->cap * 2 : obj->cap);
+        i = sol_dobj_findfree(obj, hash);
+    }
+    if (obj->ctrl[i] == SOL_CTRL_EMPTY) --obj->growth_left;
+    obj->ctrl[i] = sol_h2(hash);
+    obj->slots[i] = (sol_dobj_slot){hash, key, val, NULL};
+    ++obj->pair_count;
+    ++obj->shape;
+    return true;
+}
+
+static void sol_dobj_herase(sol_dobj *obj, uint32_t i) {
+    sf_str_free(obj->slots[i].key);
+    obj->slots[i].keystr = NULL;
+    --obj->pair_count;
+    ++obj->shape;
+
+    // Probes only continue past full groups, so the slot can go back to empty unless
+    // its group has been full at some point
+    uint8_t *group = obj->ctrl + (size_t)(i / SOL_DOBJ_GROUP) * SOL_DOBJ_GROUP;
+    if (sol_gempty(group)) {
+        obj->ctrl[i] = SOL_CTRL_EMPTY;
+        ++obj->growth_left;
+    } else obj->ctrl[i] = SOL_CTRL_DELETED;
+}
+
+// Array part
+
+static inline bool sol_dobj_isindex(sol_i64 key) { return key >= 0 && key < UINT32_MAX; }
+
+/// Parses a key that spells an index. Signs and leading zeros are rejected, so every
+/// index has exactly one spelling and it matches sol_tostring
+static bool sol_dobj_index(sf_str key, sol_i64 *out) {
+    if (key.len == 0 || key.len > 10 || (key.c_str[0] == '0' && key.len > 1)) return false;
+    sol_i64 n = 0;
+    for (size_t i = 0; i < key.len; ++i) {
+        if (key.c_str[i] < '0' || key.c_str[i] > '9') return false;
+        n = n * 10 + (key.c_str[i] - '0');
+    }
+    if (!sol_dobj_isindex(n)) return false;
+    *out = n;
+    return true;
+}
+
+/// Spells an integer key into buf, the result borrows it
+static inline sf_str sol_dobj_ikey(char buf[24], sol_i64 key) {
+    snprintf(buf, 24, "%lld", (long long)key);
+    return sf_ref(buf);
+}
+
+static void sol_dobj_push(sol_dobj *obj, sol_val val) {
+    if (obj->arr_c == obj->arr_cap) {
+        obj->arr_cap = obj->arr_cap ? obj->arr_cap * 2 : SOL_DOBJ_MINARR;
+        obj->arr = realloc(obj->arr, sizeof(sol_val) * obj->arr_cap);
+    }
+    obj->arr[obj->arr_c++] = val;
+}
+
+void sol_dobj_seti(sol_dobj *obj, sol_i64 key, sol_val val) {
+    if (key >= 0 && key < obj->arr_c) {
+        obj->arr[key] = val;
+        return;
+    }
+    if (key != obj->arr_c || !sol_dobj_isindex(key)) {
+        if (sol_dobj_hset(obj, sf_str_fmt("%lld", key), val) && sol_dobj_isindex(key))
+            ++obj->idx_c;
+        return;
+    }
+
+    sol_dobj_push(obj, val);
+    // Members set ahead of the array part join it once it reaches them
+    char buf[24];
+    while (obj->idx_c) {
+        sf_str k = sol_dobj_ikey(buf, obj->arr_c);
+        uint32_t i = sol_dobj_find(obj, k, sol_dobj_hash(k));
+        if (i == UINT32_MAX) break;
+        sol_dobj_push(obj, obj->slots[i].val);
+        sol_dobj_herase(obj, i);
+        --obj->idx_c;
+    }
+}
+
+sol_dobj_ex sol_dobj_geti(sol_dobj *obj, sol_i64 key) {
+    if (key >= 0 && key < obj->arr_c)
+        return sol_dobj_ex_ok(obj->arr[key]);
+    if (sol_dobj_isindex(key) && obj->idx_c == 0)
+        return sol_dobj_ex_err(SOL_ERRV_MEMBER_NOT_FOUND);
+    char buf[24];
+    sf_str k = sol_dobj_ikey(buf, key);
+    uint32_t i = sol_dobj_find(obj, k, sol_dobj_hash(k));
+    if (i == UINT32_MAX) return sol_dobj_ex_err(SOL_ERRV_MEMBER_NOT_FOUND);
+    return sol_dobj_ex_ok(obj->slots[i].val);
+}
+
+bool sol_dobj_removei(sol_dobj *obj, sol_i64 key) {
+    if (key >= 0 && key < obj->arr_c) {
+        // Keep the array part dense, the members after the hole move to the hash part
+        for (uint32_t i = (uint32_t)key + 1; i < obj->arr_c; ++i) {
+            sol_dobj_hset(obj, sf_str_fmt("%u", i), obj->arr[i]);
+            ++obj->idx_c;
+        }
+        obj->arr_c = (uint32_t)key;
+        return true;
+    }
+    char buf[24];
+    sf_str k = sol_dobj_ikey(buf, key);
+    uint32_t i = sol_dobj_find(obj, k, sol_dobj_hash(k));
+    if (i == UINT32_MAX) return false;
+    sol_dobj_herase(obj, i);
+    if (sol_dobj_isindex(key)) --obj->idx_c;
+    return true;
+}
+
+// String keys, index spellings are routed to the integer functions
+
+void sol_dobj_set(sol_dobj *obj, sf_str key, sol_val val) {
+    sol_i64 i;
+    if (sol_dobj_index(key, &i)) {
+        sf_str_free(key);
+        sol_dobj_seti(obj, i, val);
+        return;
+    }
+    sol_dobj_hset(obj, key, val);
+}
+
+sol_dobj_ex sol_dobj_get(sol_dobj *obj, sf_str key) {
+    sol_i64 idx;
+    if (sol_dobj_index(key, &idx)) return sol_dobj_geti(obj, idx);
+    uint32_t i = sol_dobj_find(obj, key, sol_dobj_hash(key));
+    if (i == UINT32_MAX) return sol_dobj_ex_err(SOL_ERRV_MEMBER_NOT_FOUND);
+    return sol_dobj_ex_ok(obj->slots[i].val);
+}
+
+sol_val *sol_dobj_ref(sol_dobj *obj, sf_str key) {
+    sol_i64 idx;
+    if (sol_dobj_index(key, &idx)) return NULL;
+    uint32_t i = sol_dobj_find(obj, key, sol_dobj_hash(key));
+    return i == UINT32_MAX ? NULL : &obj->slots[i].val;
+}
+
+bool sol_dobj_remove(sol_dobj *obj, sf_str key) {
+    sol_i64 idx;
+    if (sol_dobj_index(key, &idx)) return sol_dobj_removei(obj, idx);
+    uint32_t i = sol_dobj_find(obj, key, sol_dobj_hash(key));
+    if (i == UINT32_MAX) return false;
+    sol_dobj_herase(obj, i);
+    return true;
+}
+
+void sol_dobj_foreach(sol_dobj *obj, void (*fn)(void *, sf_str, sol_val), void *user) {
+    char buf[24];
+    for (uint32_t i = 0; i < obj->arr_c; ++i)
+        fn(user, sol_dobj_ikey(buf, i), obj->arr[i]);
+    for (uint32_t i = 0; i < obj->cap; ++i)
+        if (!(obj->ctrl[i] & 0x80))
+            fn(user, obj->slots[i].key, obj->slots[i].val);
+}
+
+void sol_dobj_foreachv(sol_dobj *obj, void (*fn)(void *, sol_val), void *user) {
+    for (uint32_t i = 0; i < obj->arr_c; ++i)
+        fn(user, obj->arr[i]);
+    for (uint32_t i = 0; i < obj->cap; ++i)
+        if (!(obj->ctrl[i] & 0x80))
+            fn(user, obj->slots[i].val);
+}
+
+void sol_dobj_foreachks(sol_dobj *obj, void (*fn)(void *, sol_val), void *user) {
+    for (uint32_t i = 0; i < obj->cap; ++i)
+        if (!(obj->ctrl[i] & 0x80) && obj->slots[i].keystr)
+            fn(user, (sol_val){SOL_TDYN, .dyn = obj->slots[i].keystr});
+}
+
+bool sol_dobj_next(sol_dobj *obj, sol_dobj_it *it) {
+    // Cursors count the array part first, then the hash slots
+    if (it->cursor < obj->arr_c) {
+        it->index = it->cursor;
+        it->key = SF_STR_EMPTY;
+        it->val = obj->arr[it->cursor++];
+        it->slot = NULL;
+        return true;
+    }
+    for (uint32_t i = it->cursor - obj->arr_c; i < obj->cap; ++i) {
+        if (obj->ctrl[i] & 0x80) continue;
+        it->cursor = obj->arr_c + i + 1;
+        it->index = -1;
+        it->key = obj->slots[i].key;
+        it->val = obj->slots[i].val;
+        it->slot = obj->slots + i;
+        return true;
+    }
+    it->cursor = obj->arr_c + obj->cap;
+    return false;
+}
+
+void sol_dobj_free(sol_dobj *obj) {
+    for (uint32_t i = 0; i < obj->cap; ++i)
+        if (!(obj->ctrl[i] & 0x80))
+            sf_str_free(obj->slots[i].key);
+    free(obj->slots);
+    free(obj->arr);
+    *obj = sol_dobj_new();
+}
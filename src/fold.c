@@ -0,0 +1,367 @@
+#include "sol/syntax.h"
+#include "sf/str.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of times a name is bound or written anywhere in the tree. Names bound by a
+// single let and never written are the only ones propagated, so shadowing, captures
+// that assign and asm that touches registers by name never need to be tracked
+#define MAP_NAME sol_fnames
+#define MAP_K sf_str
+#define MAP_V uint32_t
+#define EQUAL_FN(s1, s2) (sf_str_eq(s1, s2))
+#define HASH_FN(s) (sf_str_hash(s))
+#include <sf/containers/map.h>
+
+/// A let in scope whose value is a literal
+typedef struct {
+    sf_str name;
+    sol_val value;
+} sol_fbind;
+
+#define VEC_NAME sol_fbinds
+#define VEC_T sol_fbind
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
+typedef struct {
+    sol_fnames writes;
+    sol_fbinds binds;
+    uint32_t floor; // Binds below this belong to an enclosing fun
+    sol_valvec *statics;
+} sol_folder;
+
+static void sol_fwrite(sol_folder *f, sol_val name, uint32_t n) {
+    sf_str key = *(sf_str *)name.dyn;
+    sol_fnames_ex ex = sol_fnames_get(&f->writes, key);
+    sol_fnames_set(&f->writes, key, (ex.is_ok ? ex.ok : 0) + n);
+}
+
+static void sol_fcount(sol_folder *f, sol_node *node) {
+    if (!node) return;
+    switch (node->tt) {
+        case SOL_ND_MEMBER: sol_fcount(f, node->n_postfix.expr); break;
+        case SOL_ND_LET:
+            sol_fwrite(f, node->n_let.name, 1);
+            sol_fcount(f, node->n_let.value);
+            break;
+        case SOL_ND_ASSIGN:
+            if (node->n_assign.expr->tt == SOL_ND_IDENTIFIER)
+                sol_fwrite(f, node->n_assign.expr->n_identifier, 2);
+            else sol_fcount(f, node->n_assign.expr);
+            sol_fcount(f, node->n_assign.value);
+            break;
+        case SOL_ND_UNARY: sol_fcount(f, node->n_unary.right); break;
+        case SOL_ND_BINARY:
+            switch (node->n_binary.op) {
+                case TK_EQUAL: case TK_PLUS_EQUAL: case TK_MINUS_EQUAL:
+                    if (node->n_binary.left->tt == SOL_ND_IDENTIFIER) {
+                        sol_fwrite(f, node->n_binary.left->n_identifier, 2);
+                        break;
+                    } // fallthrough
+                default: sol_fcount(f, node->n_binary.left);
+            }
+            sol_fcount(f, node->n_binary.right);
+            break;
+        case SOL_ND_CALL:
+            sol_fcount(f, node->n_call.identifier);
+            for (uint32_t i = 0; i < node->n_call.arg_c; ++i)
+                sol_fcount(f, node->n_call.args[i]);
+            break;
+        case SOL_ND_FUN:
+            for (uint32_t i = 0; i < node->n_fun.arg_c; ++i)
+                sol_fwrite(f, node->n_fun.args[i], 2);
+            sol_fcount(f, node->n_fun.block);
+            break;
+        case SOL_ND_ASM: sol_fcount(f, node->n_asm.n_fun); break;
+        case SOL_ND_INS:
+            for (int i = 0; i < 3; ++i)
+                if (sol_isdtype(node->n_ins.opa[i], SOL_DSTR))
+                    sol_fwrite(f, node->n_ins.opa[i], 2);
+            break;
+        case SOL_ND_IF:
+            sol_fcount(f, node->n_if.condition);
+            sol_fcount(f, node->n_if.then_node);
+            sol_fcount(f, node->n_if.else_node);
+            break;
+        case SOL_ND_WHILE:
+            sol_fcount(f, node->n_while.condition);
+            sol_fcount(f, node->n_while.stmt);
+            break;
+        case SOL_ND_FOR:
+            sol_fwrite(f, node->n_for.key, 2);
+            if (node->n_for.val.tt != SOL_TNIL)
+                sol_fwrite(f, node->n_for.val, 2);
+            sol_fcount(f, node->n_for.expr);
+            sol_fcount(f, node->n_for.stmt);
+            break;
+        case SOL_ND_RETURN: sol_fcount(f, node->n_return.expr); break;
+        case SOL_ND_BLOCK:
+            for (uint32_t i = 0; i < node->n_block.count; ++i)
+                sol_fcount(f, node->n_block.stmts[i]);
+            break;
+        case SOL_ND_OBJ: // Members are written as assignments, but they name keys rather than locals
+            for (uint32_t i = 0; i < node->n_obj.mem_c; ++i)
+                sol_fcount(f, node->n_obj.members[i]->n_binary.right);
+            break;
+        case SOL_ND_ARRAY:
+            for (uint32_t i = 0; i < node->n_array.elem_c; ++i)
+                sol_fcount(f, node->n_array.elems[i]);
+            break;
+        case SOL_ND_INDEX:
+            sol_fcount(f, node->n_index.expr);
+            sol_fcount(f, node->n_index.index);
+            break;
+        default: break;
+    }
+}
+
+static bool sol_flookup(sol_folder *f, sf_str name, sol_val *out) {
+    for (uint32_t i = f->binds.count; i > f->floor; --i)
+        if (sf_str_eq(f->binds.data[i - 1].name, name)) {
+            *out = f->binds.data[i - 1].value;
+            return true;
+        }
+    return false;
+}
+static void sol_fpop(sol_folder *f, uint32_t mark) {
+    while (f->binds.count > mark)
+        sol_fbinds_pop(&f->binds);
+}
+
+static inline bool sol_fnum(sol_val v) { return v.tt == SOL_TI64 || v.tt == SOL_TF64; }
+/// Converts rhs to the type of lhs, the same way the VM does for mixed arithmetic
+static inline sol_val sol_fconv(sol_val lhs, sol_val rhs) {
+    if (lhs.tt == rhs.tt) return rhs;
+    return lhs.tt == SOL_TI64 ? (sol_val){.tt = SOL_TI64, .i64 = (sol_i64)rhs.f64} :
+        (sol_val){.tt = SOL_TF64, .f64 = (sol_f64)rhs.i64};
+}
+
+/// Evaluates an operator on two literals. Returns false for anything the VM would
+/// raise an error on (or that would be undefined), so those stay runtime errors
+static bool sol_fbinary(sol_folder *f, sol_tokentype op, sol_val l, sol_val r, sol_val *out) {
+    if (op == TK_PLUS && sol_isdtype(l, SOL_DSTR) && sol_isdtype(r, SOL_DSTR)) {
+        *out = sol_dnstatic(SOL_DSTR);
+        *(sf_str *)out->dyn = sf_str_join(*(sf_str *)l.dyn, *(sf_str *)r.dyn);
+        sol_valvec_push(f->statics, *out);
+        return true;
+    }
+    if (op == TK_DOUBLE_EQUAL || op == TK_NOT_EQUAL) {
+        bool e;
+        if (sol_fnum(l) && sol_fnum(r)) {
+            r = sol_fconv(l, r);
+            e = l.tt == SOL_TI64 ? l.i64 == r.i64 : l.f64 == r.f64;
+        } else if (l.tt == SOL_TNIL || r.tt == SOL_TNIL) e = l.tt == r.tt;
+        else if (l.tt == SOL_TBOOL && r.tt == SOL_TBOOL) e = l.boolean == r.boolean;
+        else if (sol_isdtype(l, SOL_DSTR) && sol_isdtype(r, SOL_DSTR))
+            e = sf_str_eq(*(sf_str *)l.dyn, *(sf_str *)r.dyn);
+        else return false;
+        *out = (sol_val){.tt = SOL_TBOOL, .boolean = op == TK_DOUBLE_EQUAL ? e : !e};
+        return true;
+    }
+    if (!sol_fnum(l) || !sol_fnum(r)) return false;
+
+    if (op == TK_GREATER || op == TK_GREATER_EQUAL) { // Swapped, like the compiler does
+        sol_val t = l; l = r; r = t;
+        op = op == TK_GREATER ? TK_LESS : TK_LESS_EQUAL;
+    }
+    r = sol_fconv(l, r);
+    if (l.tt == SOL_TF64) {
+        switch (op) {
+            case TK_PLUS: *out = (sol_val){.tt = SOL_TF64, .f64 = l.f64 + r.f64}; return true;
+            case TK_MINUS: *out = (sol_val){.tt = SOL_TF64, .f64 = l.f64 - r.f64}; return true;
+            case TK_ASTERISK: *out = (sol_val){.tt = SOL_TF64, .f64 = l.f64 * r.f64}; return true;
+            case TK_SLASH: *out = (sol_val){.tt = SOL_TF64, .f64 = l.f64 / r.f64}; return true;
+            case TK_LESS: *out = (sol_val){.tt = SOL_TBOOL, .boolean = l.f64 < r.f64}; return true;
+            case TK_LESS_EQUAL: *out = (sol_val){.tt = SOL_TBOOL, .boolean = l.f64 <= r.f64}; return true;
+            default: return false;
+        }
+    }
+    // i64 arithmetic wraps at runtime, unsigned math gives the same bits without the UB
+    uint64_t a = (uint64_t)l.i64, b = (uint64_t)r.i64;
+    switch (op) {
+        case TK_PLUS: *out = (sol_val){.tt = SOL_TI64, .i64 = (sol_i64)(a + b)}; return true;
+        case TK_MINUS: *out = (sol_val){.tt = SOL_TI64, .i64 = (sol_i64)(a - b)}; return true;
+        case TK_ASTERISK: *out = (sol_val){.tt = SOL_TI64, .i64 = (sol_i64)(a * b)}; return true;
+        case TK_SLASH:
+            if (r.i64 == 0 || (l.i64 == INT64_MIN && r.i64 == -1)) return false;
+            *out = (sol_val){.tt = SOL_TI64, .i64 = l.i64 / r.i64};
+            return true;
+        case TK_LESS: *out = (sol_val){.tt = SOL_TBOOL, .boolean = l.i64 < r.i64}; return true;
+        case TK_LESS_EQUAL: *out = (sol_val){.tt = SOL_TBOOL, .boolean = l.i64 <= r.i64}; return true;
+        default: return false;
+    }
+}
+
+static bool sol_funary(sol_tokentype op, sol_val r, sol_val *out) {
+    switch (op) {
+        case TK_MINUS:
+            if (r.tt == SOL_TI64) *out = (sol_val){.tt = SOL_TI64, .i64 = (sol_i64)(0 - (uint64_t)r.i64)};
+            else if (r.tt == SOL_TF64) *out = (sol_val){.tt = SOL_TF64, .f64 = -r.f64};
+            else return false;
+            return true;
+        case TK_BANG:
+            if (r.tt != SOL_TBOOL) return false;
+            *out = (sol_val){.tt = SOL_TBOOL, .boolean = !r.boolean};
+            return true;
+        default: return false;
+    }
+}
+
+/// Replaces a node with a literal in place, freeing whatever it held
+static void sol_fliteral(sol_node *node, sol_val val) {
+    sol_node old = *node;
+    switch (old.tt) {
+        case SOL_ND_UNARY: sol_node_free(old.n_unary.right); break;
+        case SOL_ND_BINARY:
+            sol_node_free(old.n_binary.left);
+            sol_node_free(old.n_binary.right);
+            break;
+        default: break;
+    }
+    *node = (sol_node){SOL_ND_LITERAL, old.line, old.column, .n_literal = val};
+}
+
+static inline bool sol_fisfalse(sol_node *node) {
+    return node->tt == SOL_ND_LITERAL && node->n_literal.tt == SOL_TBOOL && !node->n_literal.boolean;
+}
+
+static void sol_fnode(sol_folder *f, sol_node *node);
+
+/// Folds a statement that may declare locals, without letting them escape
+static void sol_fscoped(sol_folder *f, sol_node *node) {
+    uint32_t mark = f->binds.count;
+    sol_fnode(f, node);
+    sol_fpop(f, mark);
+}
+
+static void sol_fnode(sol_folder *f, sol_node *node) {
+    if (!node) return;
+    switch (node->tt) {
+        case SOL_ND_IDENTIFIER: {
+            sol_val v;
+            if (sol_flookup(f, *(sf_str *)node->n_identifier.dyn, &v))
+                *node = (sol_node){SOL_ND_LITERAL, node->line, node->column, .n_literal = v};
+            break;
+        }
+        case SOL_ND_MEMBER: sol_fnode(f, node->n_postfix.expr); break;
+        case SOL_ND_LET: {
+            sol_fnode(f, node->n_let.value);
+            sol_fnames_ex ex = sol_fnames_get(&f->writes, *(sf_str *)node->n_let.name.dyn);
+            node->n_let.once = ex.is_ok && ex.ok == 1;
+            // The let stays, captures and redefinition errors still need the local
+            if (node->n_let.value->tt == SOL_ND_LITERAL && node->n_let.once)
+                sol_fbinds_push(&f->binds, (sol_fbind){*(sf_str *)node->n_let.name.dyn, node->n_let.value->n_literal});
+            break;
+        }
+        case SOL_ND_ASSIGN:
+            if (node->n_assign.expr->tt != SOL_ND_IDENTIFIER)
+                sol_fnode(f, node->n_assign.expr);
+            sol_fnode(f, node->n_assign.value);
+            break;
+        case SOL_ND_UNARY: {
+            sol_fnode(f, node->n_unary.right);
+            sol_val v;
+            if (node->n_unary.right->tt == SOL_ND_LITERAL && sol_funary(node->n_unary.op, node->n_unary.right->n_literal, &v))
+                sol_fliteral(node, v);
+            break;
+        }
+        case SOL_ND_BINARY: {
+            sol_node *l = node->n_binary.left, *r = node->n_binary.right;
+            switch (node->n_binary.op) {
+                case TK_EQUAL: case TK_PLUS_EQUAL: case TK_MINUS_EQUAL:
+                    if (l->tt == SOL_ND_INDEX) {
+                        sol_fnode(f, l->n_index.expr);
+                        sol_fnode(f, l->n_index.index);
+                    } else if (l->tt == SOL_ND_MEMBER)
+                        sol_fnode(f, l->n_postfix.expr);
+                    sol_fnode(f, r);
+                    return;
+                default: break;
+            }
+            sol_fnode(f, l);
+            sol_fnode(f, r);
+            sol_val v;
+            if (l->tt == SOL_ND_LITERAL && r->tt == SOL_ND_LITERAL &&
+                sol_fbinary(f, node->n_binary.op, l->n_literal, r->n_literal, &v))
+                sol_fliteral(node, v);
+            break;
+        }
+        case SOL_ND_CALL:
+            sol_fnode(f, node->n_call.identifier);
+            for (uint32_t i = 0; i < node->n_call.arg_c; ++i)
+                sol_fnode(f, node->n_call.args[i]);
+            break;
+        case SOL_ND_FUN: {
+            // Only captured names are visible inside, anything else is a global there
+            uint32_t floor = f->floor, mark = f->binds.count;
+            for (uint32_t i = 0; i < node->n_fun.cap_c; ++i) {
+                sol_val v;
+                sf_str name = *(sf_str *)node->n_fun.captures[i].dyn;
+                if (sol_flookup(f, name, &v))
+                    sol_fbinds_push(&f->binds, (sol_fbind){name, v});
+            }
+            f->floor = mark;
+            sol_fnode(f, node->n_fun.block);
+            sol_fpop(f, mark);
+            f->floor = floor;
+            break;
+        }
+        case SOL_ND_IF:
+            sol_fnode(f, node->n_if.condition);
+            sol_fscoped(f, node->n_if.then_node);
+            sol_fscoped(f, node->n_if.else_node);
+            break;
+        case SOL_ND_WHILE:
+            sol_fnode(f, node->n_while.condition);
+            sol_fscoped(f, node->n_while.stmt);
+            break;
+        case SOL_ND_FOR:
+            sol_fnode(f, node->n_for.expr);
+            sol_fscoped(f, node->n_for.stmt);
+            break;
+        case SOL_ND_RETURN: sol_fnode(f, node->n_return.expr); break;
+        case SOL_ND_BLOCK: {
+            uint32_t mark = f->binds.count, kept = 0;
+            for (uint32_t i = 0; i < node->n_block.count; ++i) {
+                sol_node *stmt = node->n_block.stmts[i];
+                sol_fnode(f, stmt);
+                if (stmt->tt == SOL_ND_WHILE && sol_fisfalse(stmt->n_while.condition)) { // Never runs
+                    sol_node_free(stmt);
+                    continue;
+                }
+                node->n_block.stmts[kept++] = stmt;
+            }
+            node->n_block.count = kept;
+            sol_fpop(f, mark);
+            break;
+        }
+        case SOL_ND_OBJ:
+            for (uint32_t i = 0; i < node->n_obj.mem_c; ++i)
+                sol_fnode(f, node->n_obj.members[i]->n_binary.right);
+            break;
+        case SOL_ND_ARRAY:
+            for (uint32_t i = 0; i < node->n_array.elem_c; ++i)
+                sol_fnode(f, node->n_array.elems[i]);
+            break;
+        case SOL_ND_INDEX:
+            sol_fnode(f, node->n_index.expr);
+            sol_fnode(f, node->n_index.index);
+            break;
+        default: break; // Literals, and asm which is compiled exactly as written
+    }
+}
+
+void sol_fold(sol_ast ast, sol_valvec *statics) {
+    sol_folder f = {
+        .writes = sol_fnames_new(),
+        .binds = sol_fbinds_new(),
+        .floor = 0,
+        .statics = statics,
+    };
+    sol_fcount(&f, ast);
+    sol_fnode(&f, ast);
+    sol_fnames_free(&f.writes);
+    sol_fbinds_free(&f.binds);
+}
@@ -0,0 +1,115 @@
+#include "sol/bytecode.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAP_NAME sol_ptrmap
+#define MAP_K void *
+#define MAP_V sol_val
+#define EQUAL_FN(a, b) ((a) == (b))
+#define HASH_FN(p) ((uint64_t)(uintptr_t)(p) >> 4)
+#include <sf/containers/map.h>
+
+/// Values already visited by a walk, so shared members and cycles are only handled once.
+/// The graph is made along with the first value
+typedef struct {
+    sol_ptrmap seen;
+    sol_fgraph *graph;
+} sol_freezer;
+
+/// Copies len characters into a new null terminated string
+static sf_str sol_fcopy(sf_str str) {
+    char *buf = malloc(str.len + 1);
+    if (str.len) memcpy(buf, str.c_str, str.len);
+    buf[str.len] = '\0';
+    return sf_own(buf);
+}
+
+static sol_val sol_fnew(sol_freezer *fz, sol_val src, sol_dtype tt) {
+    sol_val f;
+    if (!fz->graph) {
+        fz->graph = calloc(1, sizeof(sol_fgraph) + sol_dtsize(tt));
+        *fz->graph = (sol_fgraph){
+            .made = sol_valvec_new(),
+            .shared = sol_valvec_new(),
+            .head = {.tt = (uint8_t)tt, .sc = SOL_SC_STATIC, .flags = SOL_DFLAG_FROZEN | SOL_DFLAG_FROOT},
+        };
+        f = (sol_val){SOL_TDYN, .dyn = &fz->graph->head + 1};
+    } else {
+        f = sol_dnstatic(tt);
+        sol_dheader(f)->flags = SOL_DFLAG_FROZEN;
+    }
+    sol_ptrmap_set(&fz->seen, src.dyn, f);
+    sol_valvec_push(&fz->graph->made, f);
+    return f;
+}
+
+static sol_freeze_ex sol_dfreeze_r(sol_freezer *fz, sol_val val) {
+    if (val.tt != SOL_TDYN)
+        return sol_freeze_ex_ok(val);
+    if (sol_dfrozen(val)) { // Already part of a graph, share it
+        sol_valvec_push(&fz->graph->shared, val);
+        return sol_freeze_ex_ok(val);
+    }
+    sol_ptrmap_ex done = sol_ptrmap_get(&fz->seen, val.dyn);
+    if (done.is_ok)
+        return sol_freeze_ex_ok(done.ok);
+
+    switch (sol_dtypeof(val)) {
+        case SOL_DSTR: {
+            sol_val f = sol_fnew(fz, val, SOL_DSTR);
+            ((sol_dstr *)f.dyn)->str = sol_fcopy(((sol_dstr *)val.dyn)->str);
+            return sol_freeze_ex_ok(f);
+        }
+        case SOL_DERR: {
+            sol_val f = sol_fnew(fz, val, SOL_DERR);
+            *(sf_str *)f.dyn = sol_fcopy(*(sf_str *)val.dyn);
+            return sol_freeze_ex_ok(f);
+        }
+        case SOL_DOBJ: {
+            // Registered before its members, so cycles find it
+            sol_val f = sol_fnew(fz, val, SOL_DOBJ);
+            for (sol_dobj_it it = SOL_DOBJ_IT_START; sol_dobj_next(val.dyn, &it);) {
+                sol_freeze_ex ex = sol_dfreeze_r(fz, it.val);
+                if (!ex.is_ok) return ex;
+                if (it.index >= 0) sol_dobj_seti(f.dyn, it.index, ex.ok);
+                else sol_dobj_set(f.dyn, sol_fcopy(it.key), ex.ok);
+            }
+            return sol_freeze_ex_ok(f);
+        }
+        case SOL_DARRAY: {
+            sol_val f = sol_fnew(fz, val, SOL_DARRAY);
+            sol_valvec *src = val.dyn;
+            for (uint32_t i = 0; i < src->count; ++i) {
+                sol_freeze_ex ex = sol_dfreeze_r(fz, src->data[i]);
+                if (!ex.is_ok) return ex;
+                sol_valvec_push(f.dyn, ex.ok);
+            }
+            return sol_freeze_ex_ok(f);
+        }
+        default: return sol_freeze_ex_err(SOL_ERRV_TYPE_MISMATCH);
+    }
+}
+
+sol_freeze_ex sol_dfreeze(sol_val val) {
+    if (val.tt != SOL_TDYN || sol_dfrozen(val))
+        return sol_freeze_ex_ok(val);
+
+    sol_freezer fz = {sol_ptrmap_new(), NULL};
+    sol_freeze_ex ex = sol_dfreeze_r(&fz, val);
+    sol_ptrmap_free(&fz.seen);
+    if (!ex.is_ok && fz.graph) // Every value made so far is complete, so they can simply be cleaned
+        sol_dunfreeze(fz.graph->made.data[0]);
+    return ex;
+}
+
+void sol_dunfreeze(sol_val root) {
+    // The graph lists what it owns, so nothing is walked and shared values are left alone
+    sol_fgraph *g = sol_dgraph(root);
+    if (!g) return;
+    for (uint32_t i = 1; i < g->made.count; ++i)
+        sol_dclean(g->made.data[i]);
+    sol_dclear(root);
+    sol_valvec_free(&g->made);
+    sol_valvec_free(&g->shared);
+    free(g);
+}
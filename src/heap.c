@@ -0,0 +1,204 @@
+#include "sol/heap.h"
+#include "sol/bytecode.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define sol_slab_alloc() _aligned_malloc(SOL_SLAB_SIZE, SOL_SLAB_SIZE)
+#define sol_slab_free(p) _aligned_free(p)
+#else
+#define sol_slab_alloc() aligned_alloc(SOL_SLAB_SIZE, SOL_SLAB_SIZE)
+#define sol_slab_free(p) free(p)
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline uint32_t sol_ctz64(uint64_t x) { unsigned long i; _BitScanForward64(&i, x); return (uint32_t)i; }
+static inline uint32_t sol_popcount64(uint64_t x) { return (uint32_t)__popcnt64(x); }
+#else
+static inline uint32_t sol_ctz64(uint64_t x) { return (uint32_t)__builtin_ctzll(x); }
+static inline uint32_t sol_popcount64(uint64_t x) { return (uint32_t)__builtin_popcountll(x); }
+#endif
+
+static const uint32_t SOL_SC_PAYLOAD[SOL_SC_COUNT] = {16, 32, 48, 64, 96, 128, 192, 256};
+
+/// Bytes a big value holds, counting what a usertype reported outside the heap
+static size_t sol_bigsize(sol_dbig *b) {
+    sol_val val = {SOL_TDYN, .dyn = (sol_dalloc *)(b + 1) + 1};
+    return b->size + (sol_dtypeof(val) == SOL_DUSR ? sol_uheader(val)->extra : 0);
+}
+
+static sol_dsize sol_sizeclass(size_t size) {
+    for (uint32_t sc = 0; sc < SOL_SC_COUNT; ++sc)
+        if (size <= SOL_SC_PAYLOAD[sc])
+            return (sol_dsize)sc;
+    return SOL_SC_BIG;
+}
+
+static inline sol_dalloc *sol_slabslot(sol_slab *sl, uint32_t slot) {
+    return (sol_dalloc *)((char *)sl + SOL_SLAB_HDR + (size_t)slot * sl->stride);
+}
+
+static inline bool sol_slabhasroom(sol_slab *sl) { return sl->free || sl->used < sl->cap; }
+
+static sol_slab *sol_slab_new(sol_dsize sc) {
+    sol_slab *sl = sol_slab_alloc();
+    if (!sl) return NULL;
+    memset(sl, 0, SOL_SLAB_HDR);
+    sl->stride = (uint32_t)sizeof(sol_dalloc) + SOL_SC_PAYLOAD[sc];
+    sl->cap = (uint32_t)((SOL_SLAB_SIZE - SOL_SLAB_HDR) / sl->stride);
+    if (sl->cap > SOL_SLAB_BITS) sl->cap = SOL_SLAB_BITS;
+    return sl;
+}
+
+sol_dalloc *sol_halloc(sol_heap *heap, sol_dtype tt, size_t size) {
+    // Usertypes may wait on the finalizer queue, so their slot can't be reused by the sweep
+    sol_dsize sc = tt == SOL_DUSR ? SOL_SC_BIG : sol_sizeclass(size);
+    if (sc == SOL_SC_BIG) {
+        sol_dbig *big = calloc(1, sizeof(sol_dbig) + sizeof(sol_dalloc) + size);
+        if (!big) return NULL;
+        big->size = size;
+        if (heap->bigtail) heap->bigtail->next = big;
+        else heap->big = big;
+        heap->bigtail = big;
+        sol_dalloc *dh = (sol_dalloc *)(big + 1);
+        *dh = (sol_dalloc){.tt = (uint8_t)tt, .sc = SOL_SC_BIG};
+        return dh;
+    }
+
+    sol_slab *sl = heap->slabs[sc];
+    if (!sl) {
+        sl = sol_slab_new(sc);
+        if (!sl) return NULL;
+        heap->slabs[sc] = sl;
+    }
+
+    sol_dalloc *dh;
+    uint32_t slot;
+    if (sl->free) {
+        dh = sl->free;
+        sl->free = *(sol_dalloc **)(dh + 1);
+        slot = dh->slot;
+    } else {
+        slot = sl->used++;
+        dh = sol_slabslot(sl, slot);
+    }
+    memset(dh + 1, 0, SOL_SC_PAYLOAD[sc]);
+    *dh = (sol_dalloc){.tt = (uint8_t)tt, .sc = (uint8_t)sc, .slot = slot};
+    sl->live[slot >> 6] |= 1ull << (slot & 63);
+
+    if (!sol_slabhasroom(sl)) { // Park it with the full slabs until the next sweep
+        heap->slabs[sc] = sl->next;
+        sl->next = heap->full[sc];
+        heap->full[sc] = sl;
+    }
+    return dh;
+}
+
+/// Sweeps one slab, returning how many values are still alive in it
+static uint32_t sol_hsweepslab(sol_slab *sl) {
+    uint32_t alive = 0;
+    for (uint32_t w = 0; w < SOL_SLAB_WORDS; ++w) {
+        uint64_t dead = sl->live[w] & ~sl->mark[w];
+        while (dead) {
+            sol_dalloc *dh = sol_slabslot(sl, w * 64 + sol_ctz64(dead));
+            dead &= dead - 1;
+            sol_dclear((sol_val){SOL_TDYN, .dyn = dh + 1});
+            *(sol_dalloc **)(dh + 1) = sl->free;
+            sl->free = dh;
+        }
+        sl->live[w] &= sl->mark[w];
+        sl->mark[w] = 0;
+        alive += sol_popcount64(sl->live[w]);
+    }
+    return alive;
+}
+
+size_t sol_hsweep(sol_heap *heap) {
+    size_t alive = 0;
+    for (uint32_t sc = 0; sc < SOL_SC_COUNT; ++sc) {
+        sol_slab *avail = NULL, *full = NULL;
+        for (int l = 0; l < 2; ++l) {
+            sol_slab *sl = l == 0 ? heap->slabs[sc] : heap->full[sc];
+            while (sl) {
+                sol_slab *next = sl->next;
+                uint32_t n = sol_hsweepslab(sl);
+                alive += (size_t)n * sl->stride;
+                if (n == 0) sol_slab_free(sl);
+                else if (sol_slabhasroom(sl)) { sl->next = avail; avail = sl; }
+                else { sl->next = full; full = sl; }
+                sl = next;
+            }
+        }
+        heap->slabs[sc] = avail;
+        heap->full[sc] = full;
+    }
+
+    sol_dbig **big = &heap->big;
+    heap->bigtail = NULL;
+    while (*big) {
+        sol_dbig *b = *big;
+        if (b->mark) {
+            b->mark = false;
+            alive += sol_bigsize(b);
+            heap->bigtail = b;
+            big = &b->next;
+            continue;
+        }
+        *big = b->next;
+
+        sol_val val = {SOL_TDYN, .dyn = (sol_dalloc *)(b + 1) + 1};
+        if (sol_dtypeof(val) == SOL_DUSR && sol_uheader(val)->del) {
+            // Destructors may be slow, leave them out of the pause
+            b->next = NULL;
+            if (heap->fin.tail) heap->fin.tail->next = b;
+            else heap->fin.head = b;
+            heap->fin.tail = b;
+            ++heap->fin.count;
+            heap->fin.bytes += sol_bigsize(b);
+            continue;
+        }
+        sol_dclear(val);
+        free(b);
+    }
+    return alive;
+}
+
+uint32_t sol_finq_run(sol_finq *queue, uint32_t max) {
+    uint32_t ran = 0;
+    while (queue->head && (max == 0 || ran < max)) {
+        sol_dbig *dead = queue->head;
+        queue->head = dead->next;
+        queue->bytes -= sol_bigsize(dead);
+        sol_dclear((sol_val){SOL_TDYN, .dyn = (sol_dalloc *)(dead + 1) + 1});
+        free(dead);
+        ++ran;
+    }
+    if (!queue->head) queue->tail = NULL;
+    queue->count -= ran;
+    return ran;
+}
+
+void sol_hfree(sol_heap *heap) {
+    sol_finq_run(&heap->fin, 0);
+    for (uint32_t sc = 0; sc < SOL_SC_COUNT; ++sc) {
+        for (int l = 0; l < 2; ++l) {
+            sol_slab *sl = l == 0 ? heap->slabs[sc] : heap->full[sc];
+            while (sl) {
+                sol_slab *next = sl->next;
+                memset(sl->mark, 0, sizeof(sl->mark));
+                sol_hsweepslab(sl);
+                sol_slab_free(sl);
+                sl = next;
+            }
+        }
+        heap->slabs[sc] = heap->full[sc] = NULL;
+    }
+    for (sol_dbig *b = heap->big, *next; b; b = next) {
+        next = b->next;
+        sol_dclear((sol_val){SOL_TDYN, .dyn = (sol_dalloc *)(b + 1) + 1});
+        free(b);
+    }
+    heap->big = heap->bigtail = NULL;
+}
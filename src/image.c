@@ -0,0 +1,310 @@
+#include "sol/image.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t sol_imhash(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+#if defined(__VERSION__)
+#define SOL_CC __VERSION__
+#elif defined(_MSC_FULL_VER)
+#define SOL_CC_STR(x) #x
+#define SOL_CC_XSTR(x) SOL_CC_STR(x)
+#define SOL_CC "MSVC " SOL_CC_XSTR(_MSC_FULL_VER)
+#else
+#define SOL_CC "unknown"
+#endif
+
+uint64_t sol_imbuild(void) {
+    static const char cc[] = SOL_VERSION " " SOL_CC;
+    uint64_t id = sol_imhash(cc, sizeof(cc) - 1);
+#ifdef SOL_BUILD_ID
+    return id ^ (uint64_t)SOL_BUILD_ID;
+#else
+    static const char at[] = __DATE__ " " __TIME__;
+    return id ^ sol_imhash(at, sizeof(at) - 1);
+#endif
+}
+
+#define VEC_NAME sol_improtos
+#define VEC_T const sol_fproto *
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
+static inline bool sol_imput(sol_strbuf *sb, const void *data, size_t len) {
+    return sol_sbappend(sb, (sf_str){.c_str = (char *)data, .len = len});
+}
+/// Appends bytes to the data part of an image, outputs where they'll be in it
+static bool sol_imblob(sol_strbuf *blob, size_t base, const void *data, size_t len, uint32_t *off) {
+    if (base + blob->len > UINT32_MAX) return false;
+    *off = (uint32_t)(base + blob->len);
+    return sol_imput(blob, data, len);
+}
+/// Appends a name or str and its terminator
+static bool sol_imstr(sol_strbuf *blob, size_t base, sf_str str, uint32_t *off) {
+    return sol_imblob(blob, base, str.c_str, str.len, off) && sol_sbappendc(blob, '\0', 1);
+}
+
+bool sol_imdump(const sol_fproto *proto, sol_val global, uint64_t src_hash, sol_strbuf *out) {
+    // Every proto in the tree, parents before their funs. Fun constants are met in the same
+    // order when they're written, so each one's proto is the next index not given out yet
+    sol_improtos all = sol_improtos_new();
+    sol_improtos_push(&all, proto);
+    size_t const_c = 0, up_c = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < all.count && ok; ++i) {
+        const sol_fproto *p = all.data[i];
+        ok = p->tt == SOL_FPROTO_BC;
+        const_c += p->constants.count;
+        up_c += p->up_c;
+        for (uint32_t k = 0; k < p->constants.count; ++k)
+            if (sol_isdtype(p->constants.data[k], SOL_DFUN))
+                sol_improtos_push(&all, p->constants.data[k].dyn);
+    }
+
+    size_t consts = sizeof(sol_imheader) + all.count * sizeof(sol_improto);
+    size_t upvals = consts + const_c * sizeof(sol_imconst);
+    size_t base = upvals + up_c * sizeof(sol_imupval);
+    sol_strbuf tab = SOL_STRBUF_EMPTY, cons = SOL_STRBUF_EMPTY, ups = SOL_STRBUF_EMPTY, blob = SOL_STRBUF_EMPTY;
+    uint32_t fun_i = 1;
+    for (uint32_t i = 0; i < all.count && ok; ++i) {
+        const sol_fproto *p = all.data[i];
+        sol_improto ip = {
+            .code_c = p->code_c, .dbg_len = p->dbg_len,
+            .consts = (uint32_t)(consts + cons.len), .const_c = p->constants.count,
+            .upvals = (uint32_t)(upvals + ups.len), .up_c = p->up_c,
+            .reg_c = p->reg_c, .arg_c = p->arg_c, .entry = p->entry, .line_c = p->line_c,
+        };
+        ok = sol_sbappendc(&blob, '\0', (4 - blob.len % 4) % 4) &&
+            sol_imblob(&blob, base, p->code, p->code_c * sizeof(sol_instruction), &ip.code) &&
+            sol_imblob(&blob, base, p->dbg, p->dbg_len, &ip.dbg);
+
+        for (uint32_t k = 0; k < p->constants.count && ok; ++k) {
+            sol_val v = p->constants.data[k];
+            sol_imconst ic = {.tt = v.tt};
+            switch (v.tt) {
+                case SOL_TNIL: break;
+                case SOL_TBOOL: ic.bits = v.boolean; break;
+                case SOL_TF64: memcpy(&ic.bits, &v.f64, sizeof(ic.bits)); break;
+                case SOL_TI64: ic.bits = (uint64_t)v.i64; break;
+                default:
+                    ic.tt = SOL_TCOUNT + sol_dtypeof(v);
+                    if (sol_isdtype(v, SOL_DSTR)) {
+                        sf_str str = *(sf_str *)v.dyn;
+                        uint32_t off;
+                        ok = str.len <= UINT32_MAX && sol_imstr(&blob, base, str, &off);
+                        ic.len = (uint32_t)str.len;
+                        ic.bits = off;
+                    } else if (sol_isdtype(v, SOL_DFUN)) ic.bits = fun_i++;
+                    else ok = false;
+            }
+            ok = ok && sol_imput(&cons, &ic, sizeof(ic));
+        }
+        for (uint32_t u = 0; u < p->up_c && ok; ++u) {
+            sol_upvalue upv = p->upvals[u];
+            sol_imupval iu = {.tt = upv.tt, .name_len = (uint32_t)upv.name.len};
+            if (upv.tt == SOL_UP_REF) {
+                iu.ref = upv.ref;
+                iu.frame = upv.frame;
+            } else ok = upv.value.tt == SOL_TDYN && upv.value.dyn == global.dyn;
+            ok = ok && upv.name.len <= UINT32_MAX && sol_imstr(&blob, base, upv.name, &iu.name) && sol_imput(&ups, &iu, sizeof(iu));
+        }
+        ok = ok && sol_imput(&tab, &ip, sizeof(ip));
+    }
+    ok = ok && base + blob.len <= UINT32_MAX;
+
+    size_t start = out->len;
+    sol_imheader h = {.version = SOL_IMAGE_VERSION, .build = sol_imbuild(), .src_hash = src_hash, .size = (uint32_t)(base + blob.len), .proto_c = all.count};
+    memcpy(h.magic, SOL_IMAGE_MAGIC, sizeof(h.magic));
+    ok = ok && sol_imput(out, &h, sizeof(h)) && sol_imput(out, tab.data, tab.len) && sol_imput(out, cons.data, cons.len) &&
+        sol_imput(out, ups.data, ups.len) && sol_imput(out, blob.data, blob.len);
+    if (ok) {
+        h.sum = sol_imhash(out->data + start + sizeof(h), h.size - sizeof(h));
+        memcpy(out->data + start, &h, sizeof(h));
+    } else if (out->data) {
+        out->len = start;
+        out->data[start] = '\0';
+    }
+
+    sol_sbfree(&tab);
+    sol_sbfree(&cons);
+    sol_sbfree(&ups);
+    sol_sbfree(&blob);
+    sol_improtos_free(&all);
+    return ok;
+}
+
+/// An image being loaded, see sol_imload
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    sol_val global;
+    uint32_t proto_c;
+    bool *used; // Protos already given to a fun constant, so none is loaded twice
+    bool borrow; // Point code, line tables and strs into data instead of copying them
+    uint32_t *regs; // reg_c of each proto on the way down to the one loading, by depth
+    uint32_t line_c; // Of the root, no line table can go past it
+} sol_imreader;
+
+static inline bool sol_imfits(const sol_imreader *r, uint64_t off, uint64_t size) {
+    return off <= r->len && size <= r->len - off;
+}
+/// Whether a str and its terminator are in bounds
+static inline bool sol_imstrok(const sol_imreader *r, uint64_t off, uint32_t len) {
+    return sol_imfits(r, off, (uint64_t)len + 1) && r->data[off + len] == '\0';
+}
+
+/// A str of the image, borrowed or copied out
+static inline sf_str sol_imref(const sol_imreader *r, uint64_t off, uint32_t len) {
+    sf_str str = {.c_str = (char *)r->data + off, .len = len};
+    return r->borrow ? str : sf_str_dup(str);
+}
+
+/// Whether the operands of the instruction at pc are in the bounds of its proto.
+/// Images hold unlinked code, so global slots (GGET, GSET) never belong in one
+static bool sol_imins_ok(const sol_improto *ip, uint32_t pc, sol_instruction ins) {
+    uint32_t a = sol_iabc_a(ins), b = sol_iabc_b(ins), c = sol_iabc_c(ins), bx = sol_iab_b(ins);
+    uint32_t reg_c = ip->reg_c, up_c = ip->up_c, const_c = ip->const_c;
+    switch (sol_ins_op(ins)) {
+        case SOL_OP_LOAD: return a < reg_c && bx < const_c;
+        case SOL_OP_MOVE: case SOL_OP_NEG: case SOL_OP_PUSH: return a < reg_c && bx < reg_c;
+        case SOL_OP_RET: case SOL_OP_REFU: case SOL_OP_NEW: case SOL_OP_ARR:
+            return sol_ia_a(ins) >= 0 && (uint32_t)sol_ia_a(ins) < reg_c;
+        case SOL_OP_JMP: {
+            int64_t to = (int64_t)pc + 1 + sol_ia_a(ins);
+            return to >= 0 && to <= (int64_t)ip->code_c;
+        }
+        case SOL_OP_CALL: case SOL_OP_ADD: case SOL_OP_SUB: case SOL_OP_MUL: case SOL_OP_DIV:
+        case SOL_OP_SET: case SOL_OP_GET: case SOL_OP_IGET: case SOL_OP_ISET:
+            return a < reg_c && b < reg_c && c < reg_c;
+        case SOL_OP_EQ: case SOL_OP_LT: case SOL_OP_LE: return b < reg_c && c < reg_c; // a is the inversion flag
+        case SOL_OP_SETU: return a < up_c && bx < reg_c;
+        case SOL_OP_GETU: return a < reg_c && bx < up_c;
+        case SOL_OP_SUPO: return a < up_c && b < const_c && c < reg_c;
+        case SOL_OP_GUPO: return a < reg_c && b < up_c && c < const_c;
+        case SOL_OP_NEXT: return a + 2 < reg_c && bx < reg_c; // Cursor, key and value
+        case SOL_OP_UNKNOWN: return true;
+        default: return false;
+    }
+}
+
+/// Loads a proto of the image and the protos of its funs into out, depth funs down from the root.
+/// On failure, whatever was loaded is freed again
+static bool sol_improto_load(sol_imreader *r, uint32_t idx, uint32_t depth, sol_fproto *out) {
+    sol_improto ip;
+    memcpy(&ip, r->data + sizeof(sol_imheader) + (size_t)idx * sizeof(sol_improto), sizeof(ip));
+    *out = sol_fproto_new();
+    if (!sol_imfits(r, ip.code, (uint64_t)ip.code_c * sizeof(sol_instruction)) || ip.code % 4 != 0 ||
+        !sol_imfits(r, ip.dbg, ip.dbg_len) ||
+        !sol_imfits(r, ip.consts, (uint64_t)ip.const_c * sizeof(sol_imconst)) ||
+        !sol_imfits(r, ip.upvals, (uint64_t)ip.up_c * sizeof(sol_imupval)))
+        return false;
+    if (depth == 0) r->line_c = ip.line_c;
+    if (!sol_dbgcheck(r->data + ip.dbg, ip.dbg_len, ip.code_c, r->line_c))
+        return false;
+    r->regs[depth] = ip.reg_c;
+
+    if (r->borrow) {
+        out->code = (sol_instruction *)(r->data + ip.code);
+        out->dbg = (uint8_t *)r->data + ip.dbg;
+        out->borrowed = true;
+    } else {
+        out->code = malloc(ip.code_c ? ip.code_c * sizeof(sol_instruction) : 1);
+        memcpy(out->code, r->data + ip.code, ip.code_c * sizeof(sol_instruction));
+        out->dbg = malloc(ip.dbg_len ? ip.dbg_len : 1);
+        memcpy(out->dbg, r->data + ip.dbg, ip.dbg_len);
+    }
+    out->code_c = ip.code_c;
+    out->dbg_len = ip.dbg_len;
+    out->reg_c = ip.reg_c;
+    out->arg_c = ip.arg_c;
+    out->entry = ip.entry;
+    out->line_c = ip.line_c;
+    bool ok = true;
+    for (uint32_t pc = 0; pc < ip.code_c && ok; ++pc)
+        ok = sol_imins_ok(&ip, pc, out->code[pc]);
+
+    out->upvals = malloc((ip.up_c ? ip.up_c : 1) * sizeof(sol_upvalue));
+    for (uint32_t u = 0; u < ip.up_c && ok; ++u) {
+        sol_imupval iu;
+        memcpy(&iu, r->data + ip.upvals + (size_t)u * sizeof(iu), sizeof(iu));
+        // Refs are to a register of an enclosing proto's frame, which is its depth
+        ok = sol_imstrok(r, iu.name, iu.name_len) && (iu.tt == SOL_UP_VAL ||
+            (iu.tt == SOL_UP_REF && iu.frame < depth && iu.ref < r->regs[iu.frame]));
+        if (!ok) break;
+        sf_str name = sol_imref(r, iu.name, iu.name_len);
+        out->upvals[u] = iu.tt == SOL_UP_VAL ?
+            (sol_upvalue){name, SOL_UP_VAL, .value = r->global, .frame = iu.frame} :
+            (sol_upvalue){name, SOL_UP_REF, .ref = iu.ref, .frame = iu.frame};
+        out->up_c = u + 1;
+    }
+
+    for (uint32_t k = 0; k < ip.const_c && ok; ++k) {
+        sol_imconst ic;
+        memcpy(&ic, r->data + ip.consts + (size_t)k * sizeof(ic), sizeof(ic));
+        sol_val v = {.tt = (sol_ptype)ic.tt};
+        switch (ic.tt) {
+            case SOL_TNIL: break;
+            case SOL_TBOOL: v.boolean = ic.bits != 0; break;
+            case SOL_TF64: memcpy(&v.f64, &ic.bits, sizeof(v.f64)); break;
+            case SOL_TI64: v.i64 = (sol_i64)ic.bits; break;
+            case SOL_TCOUNT + SOL_DSTR:
+                if (!(ok = sol_imstrok(r, ic.bits, ic.len))) break;
+                v = sol_dnstatic(SOL_DSTR);
+                *(sf_str *)v.dyn = sol_imref(r, ic.bits, ic.len);
+                break;
+            case SOL_TCOUNT + SOL_DFUN:
+                if (!(ok = ic.bits > 0 && ic.bits < r->proto_c && !r->used[ic.bits])) break;
+                r->used[ic.bits] = true;
+                v = sol_dnstatic(SOL_DFUN);
+                if (!(ok = sol_improto_load(r, (uint32_t)ic.bits, depth + 1, v.dyn)))
+                    free(sol_dheader(v));
+                break;
+            default: ok = false; break;
+        }
+        if (ok) sol_valvec_push(&out->constants, v);
+    }
+
+    if (!ok) sol_fproto_free(out);
+    return ok;
+}
+
+static sol_compile_ex sol_imread(const void *data, size_t len, sol_val global, bool borrow) {
+    sol_imheader h;
+    if (len < sizeof(h))
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_CORRUPT, 0, 0});
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, SOL_IMAGE_MAGIC, sizeof(h.magic)) != 0)
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_CORRUPT, 0, 0});
+    if (h.version != SOL_IMAGE_VERSION || h.build != sol_imbuild())
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_STALE, 0, 0});
+    if (h.size != len || h.proto_c == 0 || (uint64_t)h.proto_c * sizeof(sol_improto) > len - sizeof(h) ||
+        sol_imhash((const uint8_t *)data + sizeof(h), len - sizeof(h)) != h.sum)
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_CORRUPT, 0, 0});
+
+    sol_imreader r = {data, len, global, h.proto_c, calloc(h.proto_c, sizeof(bool)), borrow,
+        malloc(h.proto_c * sizeof(uint32_t)), 0};
+    sol_fproto proto;
+    bool ok = sol_improto_load(&r, 0, 0, &proto);
+    free(r.used);
+    free(r.regs);
+    if (!ok) return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_CORRUPT, 0, 0});
+    return sol_compile_ex_ok(proto);
+}
+
+sol_compile_ex sol_imload(const void *data, size_t len, sol_val global) {
+    return sol_imread(data, len, global, false);
+}
+
+sol_compile_ex sol_imview(void *data, size_t len, sol_val global) {
+    if ((uintptr_t)data % sizeof(sol_instruction) != 0)
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_IMAGE_CORRUPT, 0, 0});
+    return sol_imread(data, len, global, true);
+}
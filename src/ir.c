@@ -0,0 +1,810 @@
+#include "sol/ir.h"
+#include <stdlib.h>
+#include <string.h>
+
+/// How an op treats its operands. Every op that writes registers writes them from its
+/// first operand on
+typedef struct {
+    uint8_t reads; // Operands that are registers it reads, by bit
+    uint8_t bases; // Reads that have to stay in their register (they're also written, or a range)
+    uint8_t write_c; // Registers written
+    bool removable; // Does nothing but write, and can't raise an error
+    bool numbered; // Equal operands always give an equal result
+} sol_irop;
+
+#define R(n) (1U << (n))
+static const sol_irop SOL_IR_OPS[SOL_OP_COUNT] = {
+    [SOL_OP_LOAD] = {.write_c = 1, .removable = true, .numbered = true},
+    [SOL_OP_MOVE] = {.reads = R(1), .write_c = 1, .removable = true, .numbered = true},
+    [SOL_OP_RET] = {.reads = R(0)},
+    [SOL_OP_JMP] = {0},
+    [SOL_OP_CALL] = {.reads = R(1), .write_c = 1}, // And its args, see sol_irargs
+
+    [SOL_OP_ADD] = {.reads = R(1) | R(2), .write_c = 1, .numbered = true},
+    [SOL_OP_SUB] = {.reads = R(1) | R(2), .write_c = 1, .numbered = true},
+    [SOL_OP_MUL] = {.reads = R(1) | R(2), .write_c = 1, .numbered = true},
+    [SOL_OP_DIV] = {.reads = R(1) | R(2), .write_c = 1, .numbered = true},
+
+    [SOL_OP_NEG] = {.reads = R(1), .write_c = 1, .numbered = true},
+    [SOL_OP_EQ] = {.reads = R(1) | R(2)},
+    [SOL_OP_LT] = {.reads = R(1) | R(2)},
+    [SOL_OP_LE] = {.reads = R(1) | R(2)},
+
+    [SOL_OP_SETU] = {.reads = R(1)},
+    [SOL_OP_GETU] = {.write_c = 1, .removable = true},
+    [SOL_OP_REFU] = {.reads = R(0), .bases = R(0), .write_c = 1},
+
+    [SOL_OP_NEW] = {.write_c = 1, .removable = true},
+    [SOL_OP_SET] = {.reads = R(0) | R(1) | R(2)},
+    [SOL_OP_GET] = {.reads = R(1) | R(2), .write_c = 1},
+
+    [SOL_OP_SUPO] = {.reads = R(2)},
+    [SOL_OP_GUPO] = {.write_c = 1, .removable = true},
+    [SOL_OP_GSET] = {.reads = R(0)},
+    [SOL_OP_GGET] = {.write_c = 1, .removable = true},
+
+    [SOL_OP_ARR] = {.write_c = 1, .removable = true},
+    [SOL_OP_PUSH] = {.reads = R(0) | R(1)},
+    [SOL_OP_IGET] = {.reads = R(1) | R(2), .write_c = 1},
+    [SOL_OP_ISET] = {.reads = R(0) | R(1) | R(2)},
+    [SOL_OP_NEXT] = {.reads = R(0) | R(1), .bases = R(0), .write_c = 3},
+};
+#define sol_irinfo(in) (&SOL_IR_OPS[(in)->op])
+
+/// Whether an op skips the next instruction when it's true
+static inline bool sol_irskips(sol_opcode op) {
+    return op == SOL_OP_EQ || op == SOL_OP_LT || op == SOL_OP_LE || op == SOL_OP_NEXT;
+}
+
+/// Encodes an instruction, returns false if an operand doesn't fit
+static bool sol_irencode(const sol_irins *in, sol_instruction *out) {
+    const uint32_t *o = in->opa;
+    switch (sol_op_info(in->op)->type) {
+        case SOL_INS_A:
+            *out = sol_ins_a(in->op, (int32_t)o[0]);
+            return in->op == SOL_OP_JMP || o[0] <= MAXARG_A;
+        case SOL_INS_AB:
+            *out = sol_ins_ab(in->op, o[0], o[1]);
+            return o[0] <= MASKI(8U) && o[1] <= MASKI(18U);
+        default:
+            *out = sol_ins_abc(in->op, o[0], o[1], o[2]);
+            return o[0] <= MASKI(8U) && o[1] <= MASKI(9U) && o[2] <= MASKI(9U);
+    }
+}
+
+/// Registers a closure made inside the fun can reach. Those are read and written
+/// behind the IR's back, so they're left alone
+static void sol_irpin(sol_ir *ir, const sol_fproto *proto, uint32_t frame) {
+    for (uint32_t i = 0; i < proto->constants.count; ++i) {
+        sol_val k = proto->constants.data[i];
+        if (!sol_isdtype(k, SOL_DFUN)) continue;
+        sol_fproto *inner = k.dyn;
+        if (inner->tt != SOL_FPROTO_BC) continue;
+        for (uint32_t u = 0; u < inner->up_c; ++u)
+            if (inner->upvals[u].tt == SOL_UP_REF && inner->upvals[u].frame == frame && inner->upvals[u].ref < ir->reg_c)
+                ir->pinned[inner->upvals[u].ref] = true;
+        sol_irpin(ir, inner, frame);
+    }
+}
+
+static void sol_irblocks(sol_ir *ir) {
+    uint32_t n = ir->ins_c;
+    bool *lead = calloc(n + 1, sizeof(bool));
+    lead[0] = true;
+    for (uint32_t pc = 0; pc < n; ++pc) {
+        sol_opcode op = ir->ins[pc].op;
+        if (op == SOL_OP_JMP) {
+            uint32_t t = (uint32_t)((int32_t)pc + 1 + (int32_t)ir->ins[pc].opa[0]);
+            if (t < n) lead[t] = true;
+            lead[pc + 1] = true;
+        } else if (op == SOL_OP_RET) lead[pc + 1] = true;
+        else if (sol_irskips(op)) {
+            lead[pc + 1] = true;
+            if (pc + 2 <= n) lead[pc + 2] = true;
+            if (pc + 1 < n) ir->ins[pc + 1].fixed = true;
+        }
+    }
+
+    uint32_t *bof = malloc((n + 1) * sizeof(uint32_t)); // Block of every pc
+    ir->block_c = 0;
+    for (uint32_t pc = 0; pc < n; ++pc) {
+        if (lead[pc]) ++ir->block_c;
+        bof[pc] = ir->block_c - 1;
+    }
+    bof[n] = ir->block_c;
+    ir->blocks = calloc(ir->block_c ? ir->block_c : 1, sizeof(sol_irblock));
+    for (uint32_t pc = 0; pc < n; ++pc) {
+        sol_irblock *b = ir->blocks + bof[pc];
+        if (lead[pc]) *b = (sol_irblock){pc, pc, {SOL_IR_NONE, SOL_IR_NONE}, NULL, 0, false};
+        b->end = pc + 1;
+    }
+
+    // Successors, jumps out of the code go to the end (block_c)
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi) {
+        sol_irblock *b = ir->blocks + bi;
+        uint32_t pc = b->end - 1;
+        sol_opcode op = ir->ins[pc].op;
+        if (op == SOL_OP_JMP) {
+            uint32_t t = (uint32_t)((int32_t)pc + 1 + (int32_t)ir->ins[pc].opa[0]);
+            ir->ins[pc].target = t < n ? bof[t] : ir->block_c;
+            if (t < n) b->succ[0] = bof[t];
+        } else if (op != SOL_OP_RET) {
+            if (pc + 1 < n) b->succ[0] = bof[pc + 1];
+            if (sol_irskips(op) && pc + 2 < n) b->succ[1] = bof[pc + 2];
+        }
+    }
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi)
+        for (int s = 0; s < 2; ++s)
+            if (ir->blocks[bi].succ[s] != SOL_IR_NONE) ++ir->blocks[ir->blocks[bi].succ[s]].pred_c;
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi) {
+        ir->blocks[bi].preds = malloc((ir->blocks[bi].pred_c ? ir->blocks[bi].pred_c : 1) * sizeof(uint32_t));
+        ir->blocks[bi].pred_c = 0;
+    }
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi)
+        for (int s = 0; s < 2; ++s) {
+            uint32_t t = ir->blocks[bi].succ[s];
+            if (t != SOL_IR_NONE) ir->blocks[t].preds[ir->blocks[t].pred_c++] = bi;
+        }
+
+    // Reverse postorder, walked with an explicit stack of (block, next successor)
+    ir->order = malloc((ir->block_c ? ir->block_c : 1) * sizeof(uint32_t));
+    ir->order_c = 0;
+    if (ir->block_c) {
+        uint32_t *stack = malloc(ir->block_c * 2 * sizeof(uint32_t)), top = 0;
+        uint32_t post = ir->block_c;
+        stack[top++] = 0; stack[top++] = 0;
+        ir->blocks[0].reached = true;
+        while (top) {
+            uint32_t bi = stack[top - 2], si = stack[top - 1];
+            if (si < 2) {
+                stack[top - 1] = si + 1;
+                uint32_t t = ir->blocks[bi].succ[si];
+                if (t != SOL_IR_NONE && !ir->blocks[t].reached) {
+                    ir->blocks[t].reached = true;
+                    stack[top++] = t; stack[top++] = 0;
+                }
+                continue;
+            }
+            ir->order[--post] = bi;
+            top -= 2;
+        }
+        ir->order_c = ir->block_c - post;
+        memmove(ir->order, ir->order + post, ir->order_c * sizeof(uint32_t));
+        free(stack);
+    }
+
+    free(bof);
+    free(lead);
+}
+
+sol_ir sol_irnew(sol_fproto *proto, sol_dbgpos *dbg, const uint32_t (*opa)[3], uint32_t frame) {
+    sol_ir ir = {
+        .proto = proto,
+        .dbg = dbg,
+        .reg_c = proto->reg_c,
+        .ins_c = proto->code_c,
+        .vals = sol_irvals_new(),
+    };
+    ir.ins = malloc((ir.ins_c ? ir.ins_c : 1) * sizeof(sol_irins));
+    for (uint32_t pc = 0; pc < ir.ins_c; ++pc) {
+        sol_instruction ins = proto->code[pc];
+        sol_irins *in = ir.ins + pc;
+        *in = (sol_irins){
+            .op = sol_ins_op(ins),
+            .pos = dbg[pc],
+            .target = SOL_IR_NONE,
+            .def = SOL_IR_NONE,
+            .use = {SOL_IR_NONE, SOL_IR_NONE, SOL_IR_NONE},
+        };
+        // Jumps are patched in the code after they're emitted, so their offset is always read from it
+        if (opa && in->op != SOL_OP_JMP) memcpy(in->opa, opa[pc], sizeof(in->opa));
+        else switch (sol_op_info(in->op)->type) {
+            case SOL_INS_A: in->opa[0] = (uint32_t)sol_ia_a(ins); break;
+            case SOL_INS_AB: in->opa[0] = sol_iab_a(ins); in->opa[1] = sol_iab_b(ins); break;
+            default: in->opa[0] = sol_iabc_a(ins); in->opa[1] = sol_iabc_b(ins); in->opa[2] = sol_iabc_c(ins);
+        }
+        if (in->op == SOL_OP_CALL && in->opa[1] > in->opa[2])
+            in->arg_c = in->opa[1] - in->opa[2];
+
+        const sol_irop *info = sol_irinfo(in);
+        for (int s = 0; s < 3; ++s)
+            if (info->reads & R(s) && in->opa[s] + 1 > ir.reg_c) ir.reg_c = in->opa[s] + 1;
+        if (info->write_c && in->opa[0] + info->write_c > ir.reg_c)
+            ir.reg_c = in->opa[0] + info->write_c;
+    }
+
+    ir.pinned = calloc(ir.reg_c ? ir.reg_c : 1, sizeof(bool));
+    sol_irpin(&ir, proto, frame);
+    for (uint32_t pc = 0; pc < ir.ins_c; ++pc)
+        if (ir.ins[pc].op == SOL_OP_REFU) ir.pinned[ir.ins[pc].opa[0]] = true;
+    sol_irblocks(&ir);
+
+    size_t cells = (size_t)(ir.block_c ? ir.block_c : 1) * (ir.reg_c ? ir.reg_c : 1);
+    ir.in = malloc(cells * sizeof(uint32_t));
+    ir.phis = malloc(cells * sizeof(uint32_t));
+    return ir;
+}
+
+void sol_irfree(sol_ir *ir) {
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi)
+        free(ir->blocks[bi].preds);
+    free(ir->blocks);
+    free(ir->order);
+    free(ir->ins);
+    free(ir->pinned);
+    free(ir->in);
+    free(ir->phis);
+    free(ir->leaders);
+    sol_irvals_free(&ir->vals);
+}
+
+/// Key of a computation for value numbering
+typedef struct {
+    uint32_t op, x, y;
+} sol_irkey;
+static inline bool sol_irkeq(sol_irkey a, sol_irkey b) { return a.op == b.op && a.x == b.x && a.y == b.y; }
+static inline uint64_t sol_irkhash(sol_irkey k) {
+    uint64_t h = ((uint64_t)k.op << 32 | k.x) * 0x9E3779B97F4A7C15ULL;
+    return (h ^ (h >> 29) ^ k.y) * 0xBF58476D1CE4E5B9ULL;
+}
+#define MAP_NAME sol_irkeys
+#define MAP_K sol_irkey
+#define MAP_V uint32_t
+#define EQUAL_FN sol_irkeq
+#define HASH_FN sol_irkhash
+#include <sf/containers/map.h>
+
+static uint32_t sol_irphi(sol_ir *ir, uint32_t block, uint32_t reg) {
+    uint32_t *phi = ir->phis + (size_t)block * ir->reg_c + reg;
+    if (*phi == SOL_IR_NONE) {
+        *phi = ir->vals.count;
+        sol_irvals_push(&ir->vals, (sol_irval){reg, SOL_IR_NONE, SOL_IR_NONE});
+    }
+    return *phi;
+}
+
+/// Applies the writes of an instruction to the value of every register
+static inline void sol_irwrite(const sol_irins *in, uint32_t *cur) {
+    const sol_irop *info = sol_irinfo(in);
+    for (uint32_t k = 0; k < info->write_c; ++k)
+        cur[in->opa[0] + k] = in->def + k;
+}
+
+/// Gives the value an instruction writes a number. Copies share the number of what they
+/// copy, and computations share one with any equal computation on equal operands
+static uint32_t sol_irnumber(sol_ir *ir, sol_irkeys *keys, const sol_irins *in) {
+    const sol_irop *info = sol_irinfo(in);
+    sol_opcode op = in->op;
+    if (!info->numbered || ir->pinned[in->opa[0]]) return ir->vn_c++;
+
+    sol_irkey key = {op, SOL_IR_NONE, SOL_IR_NONE};
+    for (int s = 1; s < 3; ++s) {
+        if (!(info->reads & R(s))) continue;
+        uint32_t u = in->use[s];
+        if (u == SOL_IR_NONE || ir->pinned[ir->vals.data[u].reg] || ir->vals.data[u].vn == SOL_IR_NONE)
+            return ir->vn_c++;
+        *(s == 1 ? &key.x : &key.y) = ir->vals.data[u].vn;
+    }
+    if (op == SOL_OP_MOVE) return key.x;
+    if (op == SOL_OP_LOAD) { // Funs capture their upvalues when they're loaded, so each load is its own
+        sol_val k = ir->proto->constants.data[in->opa[1]];
+        if (k.tt == SOL_TDYN && !sol_isdtype(k, SOL_DSTR)) return ir->vn_c++;
+        key.x = in->opa[1];
+    }
+
+    sol_irkeys_ex ex = sol_irkeys_get(keys, key);
+    if (ex.is_ok) return ex.ok;
+    sol_irkeys_set(keys, key, ir->vn_c);
+    return ir->vn_c++;
+}
+
+void sol_irssa(sol_ir *ir) {
+    uint32_t rc = ir->reg_c;
+    size_t cells = (size_t)ir->block_c * rc;
+    ir->vals.count = 0;
+    for (uint32_t r = 0; r < rc; ++r) // Entry values
+        sol_irvals_push(&ir->vals, (sol_irval){r, SOL_IR_NONE, SOL_IR_NONE});
+    for (uint32_t i = 0; i < ir->ins_c; ++i) {
+        sol_irins *in = ir->ins + i;
+        const sol_irop *info = sol_irinfo(in);
+        in->def = SOL_IR_NONE;
+        in->use[0] = in->use[1] = in->use[2] = SOL_IR_NONE;
+        if (in->dead || !info->write_c) continue;
+        in->def = ir->vals.count;
+        for (uint32_t k = 0; k < info->write_c; ++k)
+            sol_irvals_push(&ir->vals, (sol_irval){in->opa[0] + k, SOL_IR_NONE, i});
+    }
+    for (size_t c = 0; c < cells; ++c)
+        ir->in[c] = ir->phis[c] = SOL_IR_NONE;
+
+    // Values on entry to every block. A register that gets different values from different
+    // predecessors gets a phi, and keeps it, so this always settles
+    uint32_t *out = malloc((cells ? cells : 1) * sizeof(uint32_t));
+    bool *done = calloc(ir->block_c ? ir->block_c : 1, sizeof(bool));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+            uint32_t bi = ir->order[oi];
+            sol_irblock *b = ir->blocks + bi;
+            uint32_t *in = ir->in + (size_t)bi * rc;
+            bool moved = !done[bi];
+            for (uint32_t r = 0; r < rc; ++r) {
+                uint32_t v = bi == 0 ? r : SOL_IR_NONE;
+                for (uint32_t p = 0; p < b->pred_c; ++p) {
+                    if (!done[b->preds[p]]) continue;
+                    uint32_t pv = out[(size_t)b->preds[p] * rc + r];
+                    if (v == SOL_IR_NONE) v = pv;
+                    else if (v != pv) v = sol_irphi(ir, bi, r);
+                }
+                if (in[r] != SOL_IR_NONE && in[r] != v) v = sol_irphi(ir, bi, r);
+                if (in[r] != v) {
+                    in[r] = v;
+                    moved = true;
+                }
+            }
+            if (!moved) continue;
+            uint32_t *o = out + (size_t)bi * rc;
+            memcpy(o, in, rc * sizeof(uint32_t));
+            for (uint32_t i = b->start; i < b->end; ++i)
+                if (!ir->ins[i].dead) sol_irwrite(ir->ins + i, o);
+            done[bi] = true;
+            changed = true;
+        }
+    }
+    free(done);
+    free(out);
+
+    // What every instruction reads, and value numbers in the order values are made.
+    // The leader of a number is the first value given it, phis and entry values come first
+    sol_irkeys keys = sol_irkeys_new();
+    ir->vn_c = 0;
+    for (uint32_t v = 0; v < ir->vals.count; ++v)
+        if (ir->vals.data[v].ins == SOL_IR_NONE) ir->vals.data[v].vn = ir->vn_c++;
+    free(ir->leaders);
+    ir->leaders = malloc(((size_t)ir->vals.count + 1) * sizeof(uint32_t)); // There are never more numbers than values
+    for (uint32_t v = 0; v < ir->vals.count; ++v)
+        if (ir->vals.data[v].ins == SOL_IR_NONE) ir->leaders[ir->vals.data[v].vn] = v;
+
+    uint32_t *cur = malloc((rc ? rc : 1) * sizeof(uint32_t));
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        sol_irblock *b = ir->blocks + ir->order[oi];
+        memcpy(cur, ir->in + (size_t)ir->order[oi] * rc, rc * sizeof(uint32_t));
+        for (uint32_t i = b->start; i < b->end; ++i) {
+            sol_irins *in = ir->ins + i;
+            if (in->dead) continue;
+            const sol_irop *info = sol_irinfo(in);
+            for (int s = 0; s < 3; ++s)
+                if (info->reads & R(s)) in->use[s] = cur[in->opa[s]];
+            for (uint32_t k = 0; k < info->write_c; ++k) {
+                uint32_t fresh = ir->vn_c;
+                uint32_t vn = k == 0 ? sol_irnumber(ir, &keys, in) : ir->vn_c++;
+                if (vn >= fresh) ir->leaders[vn] = in->def + k;
+                ir->vals.data[in->def + k].vn = vn;
+            }
+            sol_irwrite(in, cur);
+        }
+    }
+    free(cur);
+    sol_irkeys_free(&keys);
+}
+
+/// Whether a register holds a value with a number right now, and can be read for it
+static inline bool sol_irholds(const sol_ir *ir, const uint32_t *cur, uint32_t reg, uint32_t vn) {
+    return !ir->pinned[reg] && cur[reg] != SOL_IR_NONE && ir->vals.data[cur[reg]].vn == vn;
+}
+/// A register that holds a value with a number right now, preferring the one it was first
+/// made in. Returns SOL_IR_NONE if none do
+static uint32_t sol_irholder(const sol_ir *ir, const uint32_t *cur, uint32_t vn, uint32_t except) {
+    uint32_t lr = ir->vals.data[ir->leaders[vn]].reg;
+    if (lr != except && sol_irholds(ir, cur, lr, vn)) return lr;
+    for (uint32_t r = 0; r < ir->reg_c; ++r)
+        if (r != except && sol_irholds(ir, cur, r, vn)) return r;
+    return SOL_IR_NONE;
+}
+
+bool sol_irgvn(sol_ir *ir) {
+    sol_irssa(ir);
+    bool changed = false;
+    uint32_t *cur = malloc((ir->reg_c ? ir->reg_c : 1) * sizeof(uint32_t));
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        sol_irblock *b = ir->blocks + ir->order[oi];
+        memcpy(cur, ir->in + (size_t)ir->order[oi] * ir->reg_c, ir->reg_c * sizeof(uint32_t));
+        for (uint32_t i = b->start; i < b->end; ++i) {
+            sol_irins *in = ir->ins + i;
+            if (in->dead) continue;
+            const sol_irop *info = sol_irinfo(in);
+            if (info->numbered && info->write_c == 1) {
+                uint32_t a = in->opa[0], vn = ir->vals.data[in->def].vn;
+                if (sol_irholds(ir, cur, a, vn) && !in->fixed) { // Already there
+                    in->dead = true;
+                    changed = true;
+                    continue;
+                }
+                uint32_t r;
+                if (in->op != SOL_OP_MOVE && (r = sol_irholder(ir, cur, vn, a)) != SOL_IR_NONE) {
+                    in->op = SOL_OP_MOVE;
+                    in->opa[1] = r;
+                    in->opa[2] = 0;
+                    in->use[0] = in->use[2] = SOL_IR_NONE;
+                    in->use[1] = cur[r];
+                    changed = true;
+                }
+            }
+            sol_irwrite(in, cur);
+        }
+    }
+    free(cur);
+    return changed;
+}
+
+bool sol_ircopies(sol_ir *ir) {
+    sol_irssa(ir);
+    bool changed = false;
+    uint32_t *cur = malloc((ir->reg_c ? ir->reg_c : 1) * sizeof(uint32_t));
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        sol_irblock *b = ir->blocks + ir->order[oi];
+        memcpy(cur, ir->in + (size_t)ir->order[oi] * ir->reg_c, ir->reg_c * sizeof(uint32_t));
+        for (uint32_t i = b->start; i < b->end; ++i) {
+            sol_irins *in = ir->ins + i;
+            if (in->dead) continue;
+            const sol_irop *info = sol_irinfo(in);
+            for (int s = 0; s < 3; ++s) {
+                if (!(info->reads & R(s)) || info->bases & R(s) || in->use[s] == SOL_IR_NONE) continue;
+                uint32_t r = in->opa[s];
+                if (ir->pinned[r]) continue;
+                uint32_t vn = ir->vals.data[in->use[s]].vn;
+                uint32_t lr = ir->vals.data[ir->leaders[vn]].reg;
+                if (lr == r || !sol_irholds(ir, cur, lr, vn)) continue;
+                in->opa[s] = lr;
+                in->use[s] = cur[lr];
+                changed = true;
+            }
+            sol_irwrite(in, cur);
+        }
+    }
+    free(cur);
+    return changed;
+}
+
+/// Liveness through one instruction, backwards
+static void sol_irtransfer(const sol_irins *in, bool *live) {
+    const sol_irop *info = sol_irinfo(in);
+    for (uint32_t k = 0; k < info->write_c; ++k)
+        live[in->opa[0] + k] = false;
+    for (int s = 0; s < 3; ++s)
+        if (info->reads & R(s)) live[in->opa[s]] = true;
+    for (uint32_t k = 0; k < in->arg_c; ++k)
+        live[in->opa[2] + k] = true;
+}
+
+/// Registers live on leaving a block, from what's live on entry to its successors
+static void sol_irliveout(const sol_ir *ir, uint32_t bi, const bool *live_in, bool *live) {
+    const sol_irblock *b = ir->blocks + bi;
+    memset(live, 0, ir->reg_c);
+    for (int s = 0; s < 2; ++s)
+        if (b->succ[s] != SOL_IR_NONE)
+            for (uint32_t r = 0; r < ir->reg_c; ++r)
+                live[r] |= live_in[(size_t)b->succ[s] * ir->reg_c + r];
+}
+/// Registers live on entry to every block, reg_c cells per block. live is scratch
+static void sol_irlive(const sol_ir *ir, bool *live_in, bool *live) {
+    uint32_t rc = ir->reg_c;
+    memset(live_in, 0, (size_t)ir->block_c * rc);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (uint32_t bi = ir->block_c; bi-- > 0;) {
+            sol_irblock *b = ir->blocks + bi;
+            sol_irliveout(ir, bi, live_in, live);
+            for (uint32_t i = b->end; i-- > b->start;)
+                if (!ir->ins[i].dead) sol_irtransfer(ir->ins + i, live);
+            if (memcmp(live, live_in + (size_t)bi * rc, rc)) {
+                memcpy(live_in + (size_t)bi * rc, live, rc);
+                changed = true;
+            }
+        }
+    }
+}
+
+bool sol_irdead(sol_ir *ir) {
+    uint32_t rc = ir->reg_c;
+    size_t cells = (size_t)ir->block_c * rc;
+    bool *live_in = malloc(cells ? cells : 1), *live = malloc(rc ? rc : 1);
+    bool removed = false;
+    for (bool swept = true; swept;) {
+        swept = false;
+        sol_irlive(ir, live_in, live);
+        for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+            sol_irblock *b = ir->blocks + ir->order[oi];
+            sol_irliveout(ir, ir->order[oi], live_in, live);
+            for (uint32_t i = b->end; i-- > b->start;) {
+                sol_irins *in = ir->ins + i;
+                if (in->dead) continue;
+                const sol_irop *info = sol_irinfo(in);
+                if (info->removable && !in->fixed) {
+                    bool used = false;
+                    for (uint32_t k = 0; k < info->write_c; ++k) {
+                        uint32_t r = in->opa[0] + k;
+                        used |= live[r] || ir->pinned[r];
+                    }
+                    if (!used) {
+                        in->dead = swept = removed = true;
+                        continue;
+                    }
+                }
+                sol_irtransfer(in, live);
+            }
+        }
+    }
+    free(live);
+    free(live_in);
+    return removed;
+}
+
+const sol_irpass SOL_IR_PASSES[SOL_IR_PASS_C] = {
+    {"gvn", sol_irgvn},
+    {"copies", sol_ircopies},
+    {"dead", sol_irdead},
+};
+
+bool sol_irrun(sol_ir *ir, const sol_irpass *passes, uint32_t pass_c) {
+    bool any = false;
+    for (uint32_t round = 0; round < 8; ++round) { // Each round only finds what the last one left, so a few is plenty
+        bool changed = false;
+        for (uint32_t p = 0; p < pass_c; ++p)
+            changed |= passes[p].run(ir);
+        any |= changed;
+        if (!changed) break;
+    }
+    return any;
+}
+
+/// Root of a set of values, sets are merged into the lowest one
+static uint32_t sol_irfind(uint32_t *set, uint32_t v) {
+    while (set[v] != v) v = set[v] = set[set[v]];
+    return v;
+}
+static inline void sol_irunion(uint32_t *set, uint32_t a, uint32_t b) {
+    a = sol_irfind(set, a);
+    b = sol_irfind(set, b);
+    if (a != b) set[a > b ? a : b] = a < b ? a : b;
+}
+/// Stretches the span a value is live over to cover a point
+static inline void sol_irspan(uint32_t *lo, uint32_t *hi, uint32_t v, uint32_t at) {
+    if (at < lo[v]) lo[v] = at;
+    if (at > hi[v]) hi[v] = at;
+}
+
+/// The registers of a set of values that are placed together, keeping their distance.
+/// A register's span covers every value of the set that lives in it
+typedef struct {
+    uint32_t set, reg, lo, hi;
+} sol_irslot;
+static int sol_irslotcmp(const void *a, const void *b) {
+    const sol_irslot *x = a, *y = b;
+    if (x->set != y->set) return x->set < y->set ? -1 : 1;
+    return x->reg < y->reg ? -1 : x->reg > y->reg;
+}
+typedef struct {
+    uint32_t first, count; // Slots
+    uint32_t lo;
+    bool fixed; // Holds args or registers closures see, so it stays where it is
+    bool nil; // Reads a register before anything writes it, so it can't go where the args are
+} sol_irbundle;
+static int sol_irbundlecmp(const void *a, const void *b) {
+    const sol_irbundle *x = a, *y = b;
+    return x->lo < y->lo ? -1 : x->lo > y->lo;
+}
+
+/// Span of register p that's taken so far, by the highest point anything in it is live
+static int64_t *sol_irbusy(int64_t **busy, uint32_t *cap, uint32_t p) {
+    if (p >= *cap) {
+        uint32_t n = p * 2 + 8;
+        *busy = realloc(*busy, n * sizeof(int64_t));
+        for (uint32_t i = *cap; i < n; ++i) (*busy)[i] = -1;
+        *cap = n;
+    }
+    return *busy + p;
+}
+
+void sol_iralloc(sol_ir *ir) {
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi) // Never run, so they don't need registers
+        if (!ir->blocks[bi].reached)
+            for (uint32_t i = ir->blocks[bi].start; i < ir->blocks[bi].end; ++i) ir->ins[i].dead = true;
+    sol_irssa(ir);
+
+    uint32_t rc = ir->reg_c, vc = ir->vals.count, arg_c = ir->proto->arg_c;
+    size_t cells = (size_t)ir->block_c * rc;
+    bool *live_in = malloc(cells ? cells : 1), *live = malloc(rc ? rc : 1);
+    uint32_t *cur = malloc((rc ? rc : 1) * sizeof(uint32_t));
+    uint32_t *out = malloc((cells ? cells : 1) * sizeof(uint32_t));
+    uint32_t *at = malloc((ir->ins_c ? ir->ins_c : 1) * sizeof(uint32_t)); // Position of every instruction
+    uint32_t *set = malloc((vc ? vc : 1) * sizeof(uint32_t));
+    uint32_t *lo = malloc((vc ? vc : 1) * sizeof(uint32_t)), *hi = calloc(vc ? vc : 1, sizeof(uint32_t));
+    sol_irlive(ir, live_in, live);
+    for (uint32_t v = 0; v < vc; ++v) {
+        set[v] = v;
+        lo[v] = SOL_IR_NONE;
+    }
+    for (uint32_t i = 0, p = 0; i < ir->ins_c; ++i)
+        if (!ir->ins[i].dead) at[i] = p++;
+
+    // Spans, a use is at 2 * position and a write right after it, so an instruction
+    // can write to what it reads last. NEXT writes before it's done reading
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        uint32_t bi = ir->order[oi];
+        sol_irblock *b = ir->blocks + bi;
+        uint32_t first = SOL_IR_NONE, last = SOL_IR_NONE;
+        memcpy(cur, ir->in + (size_t)bi * rc, rc * sizeof(uint32_t));
+        for (uint32_t i = b->start; i < b->end; ++i) {
+            sol_irins *in = ir->ins + i;
+            if (in->dead) continue;
+            if (first == SOL_IR_NONE) {
+                first = i;
+                for (uint32_t r = 0; r < rc; ++r)
+                    if (live_in[(size_t)bi * rc + r]) sol_irspan(lo, hi, cur[r], 2 * at[i]);
+            }
+            last = i;
+            const sol_irop *info = sol_irinfo(in);
+            for (int s = 0; s < 3; ++s)
+                if (info->reads & R(s)) sol_irspan(lo, hi, cur[in->opa[s]], 2 * at[i]);
+            for (uint32_t k = 0; k < in->arg_c; ++k) { // Args are passed as a run of registers
+                sol_irspan(lo, hi, cur[in->opa[2] + k], 2 * at[i]);
+                sol_irunion(set, cur[in->opa[2]], cur[in->opa[2] + k]);
+            }
+            if (in->op == SOL_OP_NEXT) // So are the cursor, key and value
+                for (uint32_t k = 0; k < info->write_c; ++k) sol_irunion(set, cur[in->opa[0]], in->def + k);
+            for (uint32_t k = 0; k < info->write_c; ++k)
+                sol_irspan(lo, hi, in->def + k, 2 * at[i] + (in->op != SOL_OP_NEXT));
+            sol_irwrite(in, cur);
+        }
+        memcpy(out + (size_t)bi * rc, cur, rc * sizeof(uint32_t));
+        if (last == SOL_IR_NONE) continue;
+        sol_irliveout(ir, bi, live_in, live);
+        for (uint32_t r = 0; r < rc; ++r)
+            if (live[r]) sol_irspan(lo, hi, cur[r], 2 * at[last] + 1);
+    }
+
+    // Values a phi merges share a register
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        uint32_t bi = ir->order[oi];
+        for (uint32_t r = 0; r < rc; ++r) {
+            uint32_t phi = ir->phis[(size_t)bi * rc + r];
+            if (phi == SOL_IR_NONE) continue;
+            if (bi == 0) sol_irunion(set, phi, r);
+            for (uint32_t p = 0; p < ir->blocks[bi].pred_c; ++p)
+                if (ir->blocks[ir->blocks[bi].preds[p]].reached)
+                    sol_irunion(set, phi, out[(size_t)ir->blocks[bi].preds[p] * rc + r]);
+        }
+    }
+
+    // Slots of every set, every set is one bundle
+    sol_irslot *slots = malloc((vc ? vc : 1) * sizeof(sol_irslot));
+    uint32_t slot_c = 0;
+    bool *fixed = calloc(vc ? vc : 1, sizeof(bool)), *nil = calloc(vc ? vc : 1, sizeof(bool));
+    for (uint32_t v = 0; v < vc; ++v) {
+        if (lo[v] == SOL_IR_NONE) continue;
+        uint32_t root = sol_irfind(set, v), reg = ir->vals.data[v].reg;
+        slots[slot_c++] = (sol_irslot){root, reg, lo[v], hi[v]};
+        if (ir->pinned[reg] || (v < rc && reg < arg_c)) fixed[root] = true;
+        else if (v < rc) nil[root] = true;
+    }
+    qsort(slots, slot_c, sizeof(sol_irslot), sol_irslotcmp);
+    sol_irbundle *bundles = malloc((slot_c ? slot_c : 1) * sizeof(sol_irbundle));
+    uint32_t bundle_c = 0, merged = 0;
+    for (uint32_t i = 0; i < slot_c; ++i) {
+        sol_irslot *sl = slots + i;
+        if (merged && slots[merged - 1].set == sl->set && slots[merged - 1].reg == sl->reg) {
+            sol_irslot *m = slots + merged - 1;
+            m->lo = sl->lo < m->lo ? sl->lo : m->lo;
+            m->hi = sl->hi > m->hi ? sl->hi : m->hi;
+            bundles[bundle_c - 1].lo = sl->lo < bundles[bundle_c - 1].lo ? sl->lo : bundles[bundle_c - 1].lo;
+            continue;
+        }
+        if (!merged || slots[merged - 1].set != sl->set)
+            bundles[bundle_c++] = (sol_irbundle){merged, 0, sl->lo, fixed[sl->set], nil[sl->set]};
+        sol_irbundle *bn = bundles + bundle_c - 1;
+        bn->lo = sl->lo < bn->lo ? sl->lo : bn->lo;
+        ++bn->count;
+        slots[merged++] = *sl;
+    }
+    qsort(bundles, bundle_c, sizeof(sol_irbundle), sol_irbundlecmp);
+
+    // Linear scan, bundles in the order they start go to the lowest registers that are free
+    // for all of their span. Fixed ones take their own registers first
+    int64_t *busy = NULL, *shift = calloc(vc ? vc : 1, sizeof(int64_t));
+    uint32_t cap = 0, reg_c = arg_c;
+    for (uint32_t r = 0; r < rc; ++r)
+        if (ir->pinned[r]) {
+            *sol_irbusy(&busy, &cap, r) = INT64_MAX;
+            reg_c = r + 1 > reg_c ? r + 1 : reg_c;
+        }
+    for (uint32_t bn = 0; bn < bundle_c; ++bn) {
+        if (!bundles[bn].fixed) continue;
+        for (uint32_t k = 0; k < bundles[bn].count; ++k) {
+            sol_irslot *sl = slots + bundles[bn].first + k;
+            int64_t *bz = sol_irbusy(&busy, &cap, sl->reg);
+            *bz = *bz > (int64_t)sl->hi ? *bz : (int64_t)sl->hi;
+        }
+    }
+    for (uint32_t bn = 0; bn < bundle_c; ++bn) {
+        sol_irbundle *b = bundles + bn;
+        sol_irslot *sl = slots + b->first;
+        uint32_t base = sl[0].reg, place = base;
+        if (!b->fixed)
+            for (place = b->nil ? arg_c : 0;; ++place) {
+                bool fits = true;
+                for (uint32_t k = 0; k < b->count && fits; ++k)
+                    fits = *sol_irbusy(&busy, &cap, place + sl[k].reg - base) < (int64_t)sl[k].lo;
+                if (fits) break;
+            }
+        for (uint32_t k = 0; k < b->count; ++k) {
+            uint32_t p = place + sl[k].reg - base;
+            int64_t *bz = sol_irbusy(&busy, &cap, p);
+            if (!b->fixed) *bz = sl[k].hi;
+            reg_c = p + 1 > reg_c ? p + 1 : reg_c;
+        }
+        shift[sl[0].set] = (int64_t)place - base;
+    }
+
+    // Renumber, reads are looked up before the instruction writes
+    #define PHYS(v) ((uint32_t)((int64_t)ir->vals.data[(v)].reg + shift[sol_irfind(set, (v))]))
+    for (uint32_t oi = 0; oi < ir->order_c; ++oi) {
+        sol_irblock *b = ir->blocks + ir->order[oi];
+        memcpy(cur, ir->in + (size_t)ir->order[oi] * rc, rc * sizeof(uint32_t));
+        for (uint32_t i = b->start; i < b->end; ++i) {
+            sol_irins *in = ir->ins + i;
+            if (in->dead) continue;
+            const sol_irop *info = sol_irinfo(in);
+            uint32_t o[3] = {in->opa[0], in->opa[1], in->opa[2]};
+            for (int s = 0; s < 3; ++s)
+                if (info->reads & R(s)) o[s] = PHYS(cur[in->opa[s]]);
+            if (in->op == SOL_OP_CALL) o[2] = in->arg_c ? PHYS(cur[in->opa[2]]) : o[1];
+            sol_irwrite(in, cur);
+            if (info->write_c) o[0] = PHYS(in->def);
+            memcpy(in->opa, o, sizeof(o));
+        }
+    }
+    #undef PHYS
+    ir->proto->reg_c = reg_c;
+
+    free(busy);
+    free(shift);
+    free(bundles);
+    free(fixed);
+    free(nil);
+    free(slots);
+    free(lo);
+    free(hi);
+    free(set);
+    free(at);
+    free(out);
+    free(cur);
+    free(live);
+    free(live_in);
+}
+
+bool sol_iremit(sol_ir *ir) {
+    uint32_t *at = malloc((ir->block_c + 1) * sizeof(uint32_t)); // Where every block starts now
+    uint32_t pc = 0;
+    for (uint32_t bi = 0; bi < ir->block_c; ++bi) {
+        at[bi] = pc;
+        for (uint32_t i = ir->blocks[bi].start; i < ir->blocks[bi].end; ++i)
+            if (!ir->ins[i].dead) ++pc;
+    }
+    at[ir->block_c] = pc;
+
+    bool fits = true;
+    pc = 0;
+    for (uint32_t i = 0; i < ir->ins_c; ++i) {
+        sol_irins *in = ir->ins + i;
+        if (in->dead) continue;
+        if (in->op == SOL_OP_JMP && in->target != SOL_IR_NONE)
+            in->opa[0] = (uint32_t)((int32_t)at[in->target] - (int32_t)pc - 1);
+        fits &= sol_irencode(in, ir->proto->code + pc);
+        ir->dbg[pc] = in->pos;
+        ++pc;
+    }
+    ir->proto->code_c = pc;
+    free(at);
+    return fits;
+}
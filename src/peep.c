@@ -0,0 +1,106 @@
+#include "sol/bytecode.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Whether an op skips the next instruction when it's true, those have two successors
+static inline bool sol_pskips(sol_opcode op) {
+    return op == SOL_OP_EQ || op == SOL_OP_LT || op == SOL_OP_LE || op == SOL_OP_NEXT;
+}
+static inline uint32_t sol_ptarget(uint32_t pc, sol_instruction ins) {
+    return (uint32_t)((int32_t)pc + 1 + sol_ia_a(ins));
+}
+
+/// Follows a jump through any jumps it lands on. Cycles (an empty `while true`) stop
+/// wherever the walk gives up, which is still a jump into the same cycle
+static uint32_t sol_pthread(const sol_fproto *proto, uint32_t target) {
+    for (uint32_t hops = 0; hops < proto->code_c && target < proto->code_c; ++hops) {
+        sol_instruction ins = proto->code[target];
+        if (sol_ins_op(ins) != SOL_OP_JMP) break;
+        target = sol_ptarget(target, ins);
+    }
+    return target;
+}
+
+/// Marks every instruction reachable from the entry
+static void sol_preach(const sol_fproto *proto, bool *live, uint32_t *work) {
+    uint32_t top = 0;
+    memset(live, 0, proto->code_c * sizeof(bool));
+    if (proto->entry < proto->code_c) {
+        live[proto->entry] = true;
+        work[top++] = proto->entry;
+    }
+    while (top) {
+        uint32_t pc = work[--top];
+        sol_instruction ins = proto->code[pc];
+        uint32_t next[2], next_c = 0;
+        switch (sol_ins_op(ins)) {
+            case SOL_OP_RET: break;
+            case SOL_OP_JMP: next[next_c++] = sol_ptarget(pc, ins); break;
+            default:
+                next[next_c++] = pc + 1;
+                if (sol_pskips(sol_ins_op(ins))) next[next_c++] = pc + 2;
+        }
+        for (uint32_t i = 0; i < next_c; ++i)
+            if (next[i] < proto->code_c && !live[next[i]]) {
+                live[next[i]] = true;
+                work[top++] = next[i];
+            }
+    }
+}
+
+void sol_peephole(sol_fproto *proto, sol_dbgpos *dbg) {
+    uint32_t count = proto->code_c;
+    if (!count) return;
+    bool *live = malloc(count * sizeof(bool));
+    uint32_t *work = malloc((count + 1) * sizeof(uint32_t)); // Reachability stack, then the new index of every pc
+    sol_instruction *code = proto->code;
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        count = proto->code_c;
+
+        // Jumps go straight to their final target, and a jump onto a ret becomes the ret
+        for (uint32_t pc = 0; pc < count; ++pc) {
+            if (sol_ins_op(code[pc]) != SOL_OP_JMP) continue;
+            uint32_t target = sol_pthread(proto, sol_ptarget(pc, code[pc]));
+            if (target < count && sol_ins_op(code[target]) == SOL_OP_RET)
+                code[pc] = code[target];
+            else code[pc] = sol_ins_a(SOL_OP_JMP, (int32_t)target - (int32_t)pc - 1);
+        }
+
+        // Drop what can't be reached, and jumps to the next instruction. The instruction
+        // right after a skipping op is what it skips, so that one always stays
+        sol_preach(proto, live, work);
+        for (uint32_t pc = 0; pc < count; ++pc) {
+            if (!live[pc]) continue;
+            bool skipped = pc > 0 && live[pc - 1] && sol_pskips(sol_ins_op(code[pc - 1]));
+            if (!skipped && code[pc] == sol_ins_a(SOL_OP_JMP, 0))
+                live[pc] = false;
+        }
+
+        uint32_t kept = 0;
+        for (uint32_t pc = 0; pc < count; ++pc) {
+            work[pc] = kept;
+            if (live[pc]) ++kept;
+        }
+        work[count] = kept;
+        if (kept == count) break;
+
+        for (uint32_t pc = 0; pc < count; ++pc) {
+            if (!live[pc]) continue;
+            sol_instruction ins = code[pc];
+            if (sol_ins_op(ins) == SOL_OP_JMP) {
+                uint32_t target = sol_ptarget(pc, ins);
+                ins = sol_ins_a(SOL_OP_JMP, (int32_t)work[target] - (int32_t)work[pc] - 1);
+            }
+            code[work[pc]] = ins;
+            dbg[work[pc]] = dbg[pc];
+        }
+        proto->code_c = kept;
+        changed = true;
+    }
+
+    free(live);
+    free(work);
+}
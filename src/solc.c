@@ -1,5 +1,6 @@
 #include "sol/solc.h"
 #include "sol/bytecode.h"
+#include "sol/ir.h"
 #include "sol/syntax.h"
 #include "sf/str.h"
 #include <limits.h>
@@ -25,6 +26,7 @@ typedef struct {
     uint32_t reg, scope;
     bool upval;
     uint32_t frame;
+    sol_node *fun; // Fun literal the local holds for good, calls to it can be inlined
 } sol_local;
 
 struct sol_scope;
@@ -49,25 +51,117 @@ void _sol_scopes_cleanup(struct sol_scopes *v) {
         sol_scope_free(v->data + i);
 }
 
+/// Identity of a constant in the pool. Numbers compare by bits, strs by content
+/// and other dyn values by pointer
+static inline bool sol_keq(sol_val a, sol_val b) {
+    if (a.tt != b.tt) return false;
+    switch (a.tt) {
+        case SOL_TNIL: return true;
+        case SOL_TBOOL: return a.boolean == b.boolean;
+        case SOL_TF64: return memcmp(&a.f64, &b.f64, sizeof(sol_f64)) == 0;
+        case SOL_TI64: return a.i64 == b.i64;
+        case SOL_TDYN:
+            if (sol_isdtype(a, SOL_DSTR) && sol_isdtype(b, SOL_DSTR))
+                return sf_str_eq(*(sf_str *)a.dyn, *(sf_str *)b.dyn);
+            return a.dyn == b.dyn;
+        default: return false;
+    }
+}
+static inline uint64_t sol_khash(sol_val v) {
+    uint64_t h;
+    switch (v.tt) {
+        case SOL_TBOOL: h = v.boolean; break;
+        case SOL_TF64: memcpy(&h, &v.f64, sizeof(h)); break;
+        case SOL_TI64: h = (uint64_t)v.i64; break;
+        case SOL_TDYN:
+            h = sol_isdtype(v, SOL_DSTR) ? sf_str_hash(*(sf_str *)v.dyn) : (uint64_t)(uintptr_t)v.dyn;
+            break;
+        default: h = 0; break;
+    }
+    h = (h ^ v.tt) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+/// Constant pool index, maps a constant to its slot in proto.constants.
+/// Keys are the pool's own copies, so they live as long as the proto
+#define MAP_NAME sol_kindex
+#define MAP_K sol_val
+#define MAP_V uint32_t
+#define EQUAL_FN sol_keq
+#define HASH_FN sol_khash
+#include <sf/containers/map.h>
+
+/// A call whose callee's body is being compiled in its place, see sol_cinline
+typedef struct {
+    uint32_t ret; // Register returns write to
+    uint32_t line;
+    uint16_t column; // Position of the call, every instruction of the body gets it
+    uint32_t *exits; // JMPs from returns to the end of the body
+    uint32_t exit_c;
+} sol_cinl;
+
+/// A global or member read that's moved out of a loop, see sol_cinvariants. It's read into
+/// reg once before the loop, and reads of it in the loop move from there.
+/// Members are read off a local, or off another lookup that was moved
+typedef struct {
+    enum { SOL_HOIST_GLOBAL, SOL_HOIST_LOCAL, SOL_HOIST_MEMBER } tt;
+    sf_str key; // Name of the global or member, owned by the AST
+    uint32_t base; // Register of the local, or index of the lookup the member is read off
+    uint32_t reg;
+    sol_node *node; // First read in the loop, the moved one gets its position
+} sol_choist;
+
+#define VEC_NAME sol_choists
+#define VEC_T sol_choist
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+
 /// Temporary compilation info that's shared between all compiler functions
 typedef struct {
     sol_fproto proto;
+    sol_dbgpos *dbg; // Position of every instruction, encoded into proto.dbg when done
+    uint32_t (*opa)[3]; // Operands of every instruction at full width, see sol_cins
+    sol_kindex kindex;
     sol_ast ast;
     sol_scopes scopes;
     uint32_t locals, max_locals, temps, max_temps, frame;
-    sol_dalloc *alloc;
+    sol_valvec *statics;
 
     uint32_t obj_r;
+    sol_cinl *inl;
+    sol_choists hoists; // Lookups moved out of the loops being compiled, innermost last
 } sol_compiler;
 
+/// An instruction and its operands. Registers are numbered with no limit while compiling,
+/// and only have to fit the encoding once sol_iralloc has renumbered them
+typedef struct {
+    sol_instruction ins;
+    uint32_t opa[3];
+} sol_cins;
+static inline sol_cins sol_ca(sol_opcode op, int32_t a) {
+    return (sol_cins){sol_ins_a(op, a), {(uint32_t)a, 0, 0}};
+}
+static inline sol_cins sol_cab(sol_opcode op, uint32_t a, uint32_t b) {
+    return (sol_cins){sol_ins_ab(op, a, b), {a, b, 0}};
+}
+static inline sol_cins sol_cabc(sol_opcode op, uint32_t a, uint32_t b, uint32_t c) {
+    return (sol_cins){sol_ins_abc(op, a, b, c), {a, b, c}};
+}
+
 #define OP_W 10
 /// Add an instruction to the proto.
 /// Optionally logs every instruction compiled (see SOL_DBG_LOG)
-static inline void sol_cemitraw(sol_compiler *c, sol_instruction ins, uint16_t line, uint16_t column) {
+static inline void sol_cemitraw(sol_compiler *c, sol_cins ins, uint32_t line, uint16_t column) {
+    if (c->inl) { // Errors in an inlined body point at the call, like they would from a real one
+        line = c->inl->line;
+        column = c->inl->column;
+    }
     c->proto.code = realloc(c->proto.code, ++c->proto.code_c * sizeof(sol_instruction));
-    c->proto.code[c->proto.code_c - 1] = ins;
-    c->proto.dbg = realloc(c->proto.dbg, c->proto.code_c * sizeof(sol_dbg));
-    c->proto.dbg[c->proto.code_c - 1] = SOL_DBG_ENCODE(line, column);
+    c->proto.code[c->proto.code_c - 1] = ins.ins;
+    c->opa = realloc(c->opa, c->proto.code_c * sizeof(*c->opa));
+    memcpy(c->opa[c->proto.code_c - 1], ins.opa, sizeof(ins.opa));
+    c->dbg = realloc(c->dbg, c->proto.code_c * sizeof(sol_dbgpos));
+    c->dbg[c->proto.code_c - 1] = (sol_dbgpos){line, column};
 }
 #define sol_cemit(c, ins) sol_cemitraw(c, ins, node->line, node->column)
 
@@ -104,37 +198,22 @@ static inline void sol_ctemps(sol_compiler *c, uint32_t count) {
 }
 /// Find whether a constant exists, and output the index if it does
 bool sol_kfind(sol_compiler *c, sol_val con, uint32_t *idx) {
-    for (uint32_t i = 0; i < c->proto.constants.count; ++i) {
-        sol_val v = c->proto.constants.data[i];
-        if (v.tt != con.tt) continue;
-        switch (v.tt) {
-            case SOL_TNIL: *idx = i; return true;
-            case SOL_TF64: if (v.f64 == con.f64) { *idx = i; return true; } else continue;
-            case SOL_TI64: if (v.i64 == con.i64) { *idx = i; return true; } else continue;
-            case SOL_TDYN: {
-                if (sol_isdtype(v, SOL_DSTR) && sol_isdtype(con, SOL_DSTR))
-                    if (sf_str_eq(*(sf_str *)v.dyn, *(sf_str *)con.dyn)) { *idx = i; return true; }
-                    else continue;
-                else if (v.dyn == con.dyn) { *idx = i; return true; }
-                else continue;
-            }
-            default: continue;
-        }
-    }
-    return false;
+    sol_kindex_ex ex = sol_kindex_get(&c->kindex, con);
+    if (ex.is_ok) *idx = ex.ok;
+    return ex.is_ok;
 }
 /// Add a constant to the proto
 static uint32_t sol_kadd(sol_compiler *c, sol_val con) {
     if (con.tt == SOL_TDYN) {
-        size_t size = sizeof(sol_dalloc) + sol_dheader(con)->size;
-        sol_dalloc *ac = malloc(size);
-        memcpy(ac, (char *)con.dyn - sizeof(sol_dalloc), size);
-        con = (sol_val){SOL_TDYN, .dyn=ac + 1};
-        sol_dheader(con)->mark = SOL_DYN_GREEN;
+        sol_val k = sol_dnstatic(sol_dtypeof(con));
+        memcpy(k.dyn, con.dyn, sol_dtsize(sol_dtypeof(con)));
+        sol_dheader(k)->flags = sol_dheader(con)->flags;
+        con = k;
         if (sol_dheader(con)->tt == SOL_DSTR)
             *(sf_str *)con.dyn = sf_str_dup(*(sf_str *)con.dyn);
     }
     sol_valvec_push(&c->proto.constants, con);
+    sol_kindex_set(&c->kindex, con, c->proto.constants.count - 1);
     return c->proto.constants.count - 1;
 }
 
@@ -147,25 +226,488 @@ static uint32_t sol_kadd(sol_compiler *c, sol_val con) {
 #include <sf/containers/expected.h>
 sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg);
 
+/// Stores the result of the compare that was just emitted as a bool, negated for `!`.
+/// The compare skips the first jump when it's true
+static void sol_cbool(sol_compiler *c, sol_node *node, uint32_t reg, bool negate) {
+    uint32_t t = negate ? 0 : 1, f = negate ? 1 : 0; // false and true are always constants 0 and 1
+    sol_cemit(c, sol_ca(SOL_OP_JMP, 2));
+    sol_cemit(c, sol_cab(SOL_OP_LOAD, reg, t));
+    sol_cemit(c, sol_ca(SOL_OP_JMP, 1));
+    sol_cemit(c, sol_cab(SOL_OP_LOAD, reg, f));
+}
+
+/// Reads a global into reg. GUPO only has room for the first 512 constants, past those the
+/// globals obj (always the first upval) is read like any other obj
+static void sol_cgupo(sol_compiler *c, sol_node *node, uint32_t reg, uint32_t name_i) {
+    if (name_i <= MASKI(9U)) {
+        sol_cemit(c, sol_cabc(SOL_OP_GUPO, reg, 0, name_i));
+        return;
+    }
+    uint32_t g = sol_rtemp(c), k = sol_rtemp(c);
+    sol_cemit(c, sol_cab(SOL_OP_GETU, g, 0));
+    sol_cemit(c, sol_cab(SOL_OP_LOAD, k, name_i));
+    sol_cemit(c, sol_cabc(SOL_OP_GET, reg, g, k));
+    sol_ctemps(c, 2);
+}
+/// Sets a global to what's in reg, see sol_cgupo
+static void sol_csupo(sol_compiler *c, sol_node *node, uint32_t name_i, uint32_t reg) {
+    if (name_i <= MASKI(9U)) {
+        sol_cemit(c, sol_cabc(SOL_OP_SUPO, 0, name_i, reg));
+        return;
+    }
+    uint32_t g = sol_rtemp(c), k = sol_rtemp(c);
+    sol_cemit(c, sol_cab(SOL_OP_GETU, g, 0));
+    sol_cemit(c, sol_cab(SOL_OP_LOAD, k, name_i));
+    sol_cemit(c, sol_cabc(SOL_OP_SET, g, k, reg));
+    sol_ctemps(c, 2);
+}
+
+/// Finds the lookup a global or member read was moved out of a loop as, UINT32_MAX if it
+/// wasn't. Names are resolved where the read is, so a local that shadows a global never matches
+static uint32_t sol_choisted(sol_compiler *c, sol_node *node) {
+    if (!c->hoists.count) return UINT32_MAX;
+    sol_local loc;
+    uint32_t tt, base = 0;
+    sf_str key;
+    if (node->tt == SOL_ND_IDENTIFIER) {
+        key = *(sf_str *)node->n_identifier.dyn;
+        if (sol_lexists(c, key, &loc)) return UINT32_MAX;
+        tt = SOL_HOIST_GLOBAL;
+    } else if (node->tt == SOL_ND_MEMBER) {
+        sol_node *expr = node->n_postfix.expr;
+        key = *(sf_str *)node->n_postfix.postfix.dyn;
+        if (expr->tt == SOL_ND_IDENTIFIER && sol_lexists(c, *(sf_str *)expr->n_identifier.dyn, &loc)) {
+            if (loc.upval) return UINT32_MAX;
+            tt = SOL_HOIST_LOCAL;
+            base = loc.reg;
+        } else {
+            tt = SOL_HOIST_MEMBER;
+            base = sol_choisted(c, expr);
+            if (base == UINT32_MAX) return UINT32_MAX;
+        }
+    } else return UINT32_MAX;
+
+    for (uint32_t i = 0; i < c->hoists.count; ++i) {
+        sol_choist *h = c->hoists.data + i;
+        if (h->tt == tt && h->base == base && sf_str_eq(h->key, key))
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+/// Reads the global named by an identifier into reg, from where it was moved out of a loop if it was
+static void sol_cglobal(sol_compiler *c, sol_node *node, uint32_t reg, sol_val name) {
+    uint32_t h = sol_choisted(c, node);
+    if (h != UINT32_MAX) {
+        sol_cemit(c, sol_cab(SOL_OP_MOVE, reg, c->hoists.data[h].reg));
+        return;
+    }
+    uint32_t name_i;
+    if (!sol_kfind(c, name, &name_i))
+        name_i = sol_kadd(c, name);
+    sol_cgupo(c, node, reg, name_i);
+}
+
+/// Whether a condition was folded down to true or false
+static inline bool sol_nisbool(sol_node *node) {
+    return node->tt == SOL_ND_LITERAL && node->n_literal.tt == SOL_TBOOL;
+}
+
+/// Tests an if or while condition, the instruction after the test is skipped when it holds
+static sol_cnode_ex sol_ccond(sol_compiler *c, sol_node *node, sol_node *cond) {
+    uint32_t cr = sol_rtemp(c);
+    uint32_t s = 0;
+    if (cond->tt == SOL_ND_UNARY) {
+        s = 1;
+        cond = cond->n_unary.right;
+    }
+
+    if (cond->tt == SOL_ND_IDENTIFIER) {
+        sol_local loc;
+        sol_cemit(c, sol_cab(SOL_OP_LOAD, cr, 1));
+        if (!sol_lexists(c, *(sf_str *)cond->n_identifier.dyn, &loc)) { // Global
+            uint32_t id_r = sol_rtemp(c);
+            sol_cglobal(c, cond, id_r, cond->n_identifier);
+            sol_cemit(c, sol_cabc(SOL_OP_EQ, s, id_r, cr));
+            sol_ctemps(c, 1);
+        } else { // Local
+            if (loc.upval) { // Reserve temp for upval
+                uint32_t up = sol_rtemp(c);
+                sol_cemit(c, sol_cab(SOL_OP_GETU, up, loc.reg));
+                sol_cemit(c, sol_cabc(SOL_OP_EQ, s, up, cr));
+                sol_ctemps(c, 1);
+            } else
+                sol_cemit(c, sol_cabc(SOL_OP_EQ, s, loc.reg, cr));
+        }
+    } else {
+        sol_cnode_ex ex = sol_cnode(c, cond, cr);
+        if (cond->tt == SOL_ND_CALL || cond->tt == SOL_ND_INDEX || cond->tt == SOL_ND_LITERAL) {
+            uint32_t ttemp = sol_rtemp(c);
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, ttemp, 1));
+            sol_cemit(c, sol_cabc(SOL_OP_EQ, s, cr, ttemp));
+            sol_ctemps(c, 1);
+        }
+        if (!ex.is_ok) return ex;
+    }
+    sol_ctemps(c, 1);
+    return sol_cnode_ex_ok();
+}
+
+/// How big a fun body is, counted in nodes. Bodies that can't be inlined weigh more than
+/// the budget: ones that make funs or name registers in asm, and ones that return the
+/// result of a compare, since that never reaches the return's register
+static uint32_t sol_cweight(sol_node *node) {
+    if (!node) return 0;
+    uint32_t w = 1;
+    switch (node->tt) {
+        case SOL_ND_FUN: case SOL_ND_ASM: case SOL_ND_INS: return SOL_INLINE_BUDGET + 1;
+        case SOL_ND_MEMBER: w += sol_cweight(node->n_postfix.expr); break;
+        case SOL_ND_LET: w += sol_cweight(node->n_let.value); break;
+        case SOL_ND_UNARY: w += sol_cweight(node->n_unary.right); break;
+        case SOL_ND_BINARY: w += sol_cweight(node->n_binary.left) + sol_cweight(node->n_binary.right); break;
+        case SOL_ND_CALL:
+            w += sol_cweight(node->n_call.identifier);
+            for (uint32_t i = 0; i < node->n_call.arg_c; ++i)
+                w += sol_cweight(node->n_call.args[i]);
+            break;
+        case SOL_ND_IF:
+            w += sol_cweight(node->n_if.condition) + sol_cweight(node->n_if.then_node) + sol_cweight(node->n_if.else_node);
+            break;
+        case SOL_ND_WHILE: w += sol_cweight(node->n_while.condition) + sol_cweight(node->n_while.stmt); break;
+        case SOL_ND_FOR: w += sol_cweight(node->n_for.expr) + sol_cweight(node->n_for.stmt); break;
+        case SOL_ND_RETURN:
+            if (node->n_return.expr->tt == SOL_ND_BINARY && sol_niscondition(node->n_return.expr))
+                return SOL_INLINE_BUDGET + 1;
+            w += sol_cweight(node->n_return.expr);
+            break;
+        case SOL_ND_BLOCK:
+            for (uint32_t i = 0; i < node->n_block.count; ++i)
+                w += sol_cweight(node->n_block.stmts[i]);
+            break;
+        case SOL_ND_OBJ:
+            for (uint32_t i = 0; i < node->n_obj.mem_c; ++i)
+                w += sol_cweight(node->n_obj.members[i]->n_binary.right);
+            break;
+        case SOL_ND_ARRAY:
+            for (uint32_t i = 0; i < node->n_array.elem_c; ++i)
+                w += sol_cweight(node->n_array.elems[i]);
+            break;
+        case SOL_ND_INDEX: w += sol_cweight(node->n_index.expr) + sol_cweight(node->n_index.index); break;
+        default: break;
+    }
+    return w > SOL_INLINE_BUDGET ? SOL_INLINE_BUDGET + 1 : w;
+}
+
+/// Whether a call with arg_c args to a fun literal can be compiled as the fun's body.
+/// Funs that capture can't, so the body only ever sees its args, globals and the upvals
+/// every fun shares with the one it's made in. That also keeps them from calling themselves
+static bool sol_cinlinable(sol_node *fun, uint32_t arg_c) {
+    return fun->n_fun.cap_c == 0 && fun->n_fun.arg_c == arg_c && sol_cweight(fun->n_fun.block) <= SOL_INLINE_BUDGET;
+}
+
+/// Compiles a call to a fun literal (see sol_cinlinable) as its body, with the args in fresh
+/// registers the body names as its params. Returns jump past the rest of the body, and
+/// falling off its end leaves nil like a real call would
+static sol_cnode_ex sol_cinline(sol_compiler *c, sol_node *node, sol_node *fun, uint32_t t_reg) {
+    uint32_t arg_c = node->n_call.arg_c, temps = arg_c;
+    uint32_t *regs = malloc((arg_c ? arg_c : 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < arg_c; ++i) {
+        regs[i] = sol_rtemp(c);
+        sol_cnode_ex ex = sol_cnode(c, node->n_call.args[i], regs[i]);
+        if (node->n_call.args[i]->tt == SOL_ND_BINARY && sol_niscondition(node->n_call.args[i])) // Conditions
+            sol_cbool(c, node, regs[i], false);
+        if (!ex.is_ok) {
+            free(regs);
+            return ex;
+        }
+    }
+    if (t_reg == UINT32_MAX) {
+        t_reg = sol_rtemp(c);
+        ++temps;
+    }
+
+    // The body sees what the fun would, its params and the shared upvals
+    sol_scopes outer = c->scopes;
+    c->scopes = sol_scopes_new();
+    sol_scopes_push(&c->scopes, sol_scope_new());
+    for (uint32_t i = 0; i < arg_c; ++i)
+        sol_scope_set(c->scopes.data, *(sf_str *)fun->n_fun.args[i].dyn, (sol_local){regs[i], 0, false, 0, NULL});
+    for (uint32_t i = 0; i < c->proto.up_c; ++i)
+        sol_scope_set(c->scopes.data, c->proto.upvals[i].name, (sol_local){i, 0, true, c->proto.upvals[i].frame, NULL});
+    free(regs);
+
+    uint32_t nil;
+    if (!sol_kfind(c, SOL_NIL, &nil))
+        nil = sol_kadd(c, SOL_NIL);
+    sol_cinl inl = {t_reg, node->line, node->column, NULL, 0}, *prev = c->inl;
+    c->inl = &inl;
+    sol_cemit(c, sol_cab(SOL_OP_LOAD, t_reg, nil));
+    sol_cnode_ex ex = sol_cnode(c, fun->n_fun.block, UINT32_MAX);
+    c->inl = prev;
+    for (uint32_t i = 0; i < inl.exit_c; ++i)
+        c->proto.code[inl.exits[i]] = sol_ins_a(SOL_OP_JMP, c->proto.code_c - (inl.exits[i] + 1));
+    free(inl.exits);
+
+    sol_scopes_free(&c->scopes);
+    c->scopes = outer;
+    sol_ctemps(c, temps);
+    return ex;
+}
+
+#define VEC_NAME sol_cnames
+#define VEC_T sf_str
+#define VSIZE_T uint32_t
+#include <sf/containers/vec.h>
+static bool sol_cnamed(const sol_cnames *names, sf_str name) {
+    for (uint32_t i = 0; i < names->count; ++i)
+        if (sf_str_eq(names->data[i], name)) return true;
+    return false;
+}
+
+/// What a loop reads and writes, see sol_cscan. Strs are owned by the AST
+typedef struct {
+    sol_choists found; // Global and member reads, reg isn't used yet
+    sol_cnames names; // Names assigned or declared
+    sol_cnames keys; // Members assigned
+    sol_cnames calls; // Locals whose calls are inlined
+    bool opaque; // Calls something that could write anything
+    bool any_key; // Assigns an index that could be any member's name
+    uint32_t ret_c; // Returns seen so far
+    sol_node *fun; // Inlined fun whose body is being scanned, NULL in the loop itself
+} sol_cloop;
+
+/// Adds a read to a loop's reads, or finds the same one read before
+static uint32_t sol_cfound(sol_cloop *lp, sol_choist h) {
+    for (uint32_t i = 0; i < lp->found.count; ++i) {
+        sol_choist *f = lp->found.data + i;
+        if (f->tt == h.tt && f->base == h.base && sf_str_eq(f->key, h.key))
+            return i;
+    }
+    sol_choists_push(&lp->found, h);
+    return lp->found.count - 1;
+}
+
+/// Whether a name is a local where the scanned code runs. Inlined bodies only see their
+/// params and the shared upvals, which are never read off
+static bool sol_cscoped(sol_compiler *c, sol_cloop *lp, sf_str name, sol_local *loc) {
+    if (!lp->fun) return sol_lexists(c, name, loc);
+    *loc = (sol_local){0, 0, true, 0, NULL};
+    for (uint32_t i = 0; i < lp->fun->n_fun.arg_c; ++i)
+        if (sf_str_eq(*(sf_str *)lp->fun->n_fun.args[i].dyn, name)) return true;
+    for (uint32_t i = 0; i < c->proto.up_c; ++i)
+        if (sf_str_eq(c->proto.upvals[i].name, name)) return true;
+    return false;
+}
+
+/// Collects the reads and writes of loop code. Members are only read where the code always
+/// runs once the loop does, since reading one off something that isn't an obj is an error,
+/// and reading a global never is. Returns the read a global or member is, or UINT32_MAX
+static uint32_t sol_cscan(sol_compiler *c, sol_cloop *lp, sol_node *node, bool always) {
+    if (!node || lp->opaque) return UINT32_MAX;
+    sol_local loc;
+    switch (node->tt) {
+        case SOL_ND_IDENTIFIER: {
+            sf_str name = *(sf_str *)node->n_identifier.dyn;
+            if (sol_cscoped(c, lp, name, &loc)) return UINT32_MAX;
+            return sol_cfound(lp, (sol_choist){SOL_HOIST_GLOBAL, name, 0, 0, node});
+        }
+        case SOL_ND_MEMBER: {
+            sol_node *expr = node->n_postfix.expr;
+            uint32_t base = sol_cscan(c, lp, expr, always);
+            if (!always || lp->fun) return UINT32_MAX;
+            sf_str key = *(sf_str *)node->n_postfix.postfix.dyn;
+            if (expr->tt == SOL_ND_IDENTIFIER && sol_lexists(c, *(sf_str *)expr->n_identifier.dyn, &loc))
+                return loc.upval ? UINT32_MAX : sol_cfound(lp, (sol_choist){SOL_HOIST_LOCAL, key, loc.reg, 0, node});
+            return base == UINT32_MAX ? UINT32_MAX : sol_cfound(lp, (sol_choist){SOL_HOIST_MEMBER, key, base, 0, node});
+        }
+        case SOL_ND_LITERAL: case SOL_ND_FUN: break; // Making a fun runs none of it
+        case SOL_ND_LET:
+            sol_cnames_push(&lp->names, *(sf_str *)node->n_let.name.dyn);
+            sol_cscan(c, lp, node->n_let.value, always);
+            break;
+        case SOL_ND_UNARY: sol_cscan(c, lp, node->n_unary.right, always); break;
+        case SOL_ND_BINARY: {
+            sol_node *left = node->n_binary.left;
+            bool assign = node->n_binary.op == TK_EQUAL || node->n_binary.op == TK_PLUS_EQUAL || node->n_binary.op == TK_MINUS_EQUAL;
+            if (!assign) sol_cscan(c, lp, left, always);
+            else if (left->tt == SOL_ND_IDENTIFIER) sol_cnames_push(&lp->names, *(sf_str *)left->n_identifier.dyn);
+            else if (left->tt == SOL_ND_MEMBER) {
+                sol_cnames_push(&lp->keys, *(sf_str *)left->n_postfix.postfix.dyn);
+                sol_cscan(c, lp, left->n_postfix.expr, always);
+            } else if (left->tt == SOL_ND_INDEX) { // Strs index objs by member name
+                sol_node *idx = left->n_index.index;
+                if (idx->tt != SOL_ND_LITERAL) lp->any_key = true;
+                else if (sol_isdtype(idx->n_literal, SOL_DSTR))
+                    sol_cnames_push(&lp->keys, *(sf_str *)idx->n_literal.dyn);
+                sol_cscan(c, lp, left->n_index.expr, always);
+                sol_cscan(c, lp, idx, always);
+            }
+            sol_cscan(c, lp, node->n_binary.right, always);
+            break;
+        }
+        case SOL_ND_CALL: {
+            sol_node *id = node->n_call.identifier;
+            for (uint32_t i = 0; i < node->n_call.arg_c; ++i)
+                sol_cscan(c, lp, node->n_call.args[i], always);
+            if (lp->fun || id->tt != SOL_ND_IDENTIFIER || !sol_lexists(c, *(sf_str *)id->n_identifier.dyn, &loc) ||
+                loc.upval || !loc.fun || !sol_cinlinable(loc.fun, node->n_call.arg_c)) {
+                lp->opaque = true;
+                break;
+            }
+            // Inlined, so its body is part of the loop
+            sol_cnames_push(&lp->calls, *(sf_str *)id->n_identifier.dyn);
+            lp->fun = loc.fun;
+            sol_cscan(c, lp, loc.fun->n_fun.block, false);
+            lp->fun = NULL;
+            break;
+        }
+        case SOL_ND_IF:
+            sol_cscan(c, lp, node->n_if.condition, always);
+            sol_cscan(c, lp, node->n_if.then_node, false);
+            sol_cscan(c, lp, node->n_if.else_node, false);
+            break;
+        case SOL_ND_WHILE:
+            sol_cscan(c, lp, node->n_while.condition, always);
+            sol_cscan(c, lp, node->n_while.stmt, false);
+            break;
+        case SOL_ND_FOR:
+            sol_cnames_push(&lp->names, *(sf_str *)node->n_for.key.dyn);
+            if (node->n_for.val.tt != SOL_TNIL)
+                sol_cnames_push(&lp->names, *(sf_str *)node->n_for.val.dyn);
+            sol_cscan(c, lp, node->n_for.expr, always);
+            sol_cscan(c, lp, node->n_for.stmt, false);
+            break;
+        case SOL_ND_RETURN:
+            sol_cscan(c, lp, node->n_return.expr, always);
+            ++lp->ret_c;
+            break;
+        case SOL_ND_BLOCK:
+            for (uint32_t i = 0; i < node->n_block.count; ++i) { // Nothing after a return runs for sure
+                uint32_t ret_c = lp->ret_c;
+                sol_cscan(c, lp, node->n_block.stmts[i], always);
+                always = always && lp->ret_c == ret_c;
+            }
+            break;
+        case SOL_ND_OBJ:
+            for (uint32_t i = 0; i < node->n_obj.mem_c; ++i)
+                sol_cscan(c, lp, node->n_obj.members[i]->n_binary.right, always);
+            break;
+        case SOL_ND_ARRAY:
+            for (uint32_t i = 0; i < node->n_array.elem_c; ++i)
+                sol_cscan(c, lp, node->n_array.elems[i], always);
+            break;
+        case SOL_ND_INDEX:
+            sol_cscan(c, lp, node->n_index.expr, always);
+            sol_cscan(c, lp, node->n_index.index, always);
+            break;
+        default: lp->opaque = true; break; // Asm and the like
+    }
+    return UINT32_MAX;
+}
+
+/// Finds the global and member reads of a while loop that nothing in it can change. Anything
+/// the loop calls could write anything, so a loop that makes real calls has none.
+/// A member stays put if no member of that name is assigned and neither is what it's read
+/// off, and a global is a member of the globals obj, so assigning either name counts for both
+static sol_choists sol_cinvariants(sol_compiler *c, sol_node *node) {
+    sol_cloop lp = {sol_choists_new(), sol_cnames_new(), sol_cnames_new(), sol_cnames_new(), false, false, 0, NULL};
+    sol_cscan(c, &lp, node->n_while.condition, true);
+    sol_cscan(c, &lp, node->n_while.stmt, true);
+    for (uint32_t i = 0; i < lp.calls.count; ++i) // A local declared in the loop might not be the inlined fun
+        lp.opaque = lp.opaque || sol_cnamed(&lp.names, lp.calls.data[i]);
+
+    sol_choists out = sol_choists_new();
+    uint32_t *map = malloc((lp.found.count ? lp.found.count : 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < lp.found.count && !lp.opaque; ++i) {
+        sol_choist h = lp.found.data[i];
+        map[i] = UINT32_MAX;
+        bool kept = !lp.any_key && !sol_cnamed(&lp.keys, h.key) && !sol_cnamed(&lp.names, h.key) && out.count < SOL_HOIST_MAX;
+        if (kept && h.tt == SOL_HOIST_LOCAL) {
+            sol_local loc;
+            for (uint32_t n = 0; n < lp.names.count && kept; ++n)
+                kept = !sol_lexists(c, lp.names.data[n], &loc) || loc.upval || loc.reg != h.base;
+        } else if (kept && h.tt == SOL_HOIST_MEMBER) {
+            kept = map[h.base] != UINT32_MAX;
+            h.base = map[h.base];
+        }
+        if (!kept) continue;
+        map[i] = out.count;
+        sol_choists_push(&out, h);
+    }
+    free(map);
+    sol_choists_free(&lp.found);
+    sol_cnames_free(&lp.names);
+    sol_cnames_free(&lp.keys);
+    sol_cnames_free(&lp.calls);
+    return out;
+}
+
+/// Reads the lookups moved out of a loop into registers of their own before it, and makes them
+/// what reads in the loop use
+static void sol_cpreheader(sol_compiler *c, sol_choists *hoists) {
+    uint32_t first = c->hoists.count;
+    for (uint32_t i = 0; i < hoists->count; ++i) {
+        sol_choist h = hoists->data[i];
+        sol_node *node = h.node;
+        h.reg = sol_rlocal(c);
+        if (h.tt == SOL_HOIST_GLOBAL) {
+            uint32_t name_i;
+            if (!sol_kfind(c, node->n_identifier, &name_i))
+                name_i = sol_kadd(c, node->n_identifier);
+            sol_cgupo(c, node, h.reg, name_i);
+        } else {
+            if (h.tt == SOL_HOIST_MEMBER) h.base += first;
+            uint32_t obj = h.tt == SOL_HOIST_MEMBER ? c->hoists.data[h.base].reg : h.base;
+            uint32_t name_i, name = sol_rtemp(c);
+            if (!sol_kfind(c, node->n_postfix.postfix, &name_i))
+                name_i = sol_kadd(c, node->n_postfix.postfix);
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, name, name_i));
+            sol_cemit(c, sol_cabc(SOL_OP_GET, h.reg, obj, name));
+            sol_ctemps(c, 1);
+        }
+        sol_choists_push(&c->hoists, h);
+    }
+}
+
+/// Gives results that are thrown away (written to UINT32_MAX) a register of their own
+static void sol_cdiscards(sol_compiler *c) {
+    bool used = false;
+    for (uint32_t pc = 0; pc < c->proto.code_c; ++pc) {
+        if (sol_ins_op(c->proto.code[pc]) == SOL_OP_JMP) continue;
+        for (int s = 0; s < 3; ++s)
+            if (c->opa[pc][s] == UINT32_MAX) {
+                c->opa[pc][s] = c->proto.reg_c;
+                used = true;
+            }
+    }
+    if (used) ++c->proto.reg_c;
+}
+
 /// Compile a fun from a block and info
-sol_compile_ex sol_cfun(uint32_t frame, sol_dalloc *alloc, sol_node *ast, uint32_t arg_c, sol_val *args, uint32_t up_c, sol_upvalue *upvals) {
+/// Raw funs (asm) are kept exactly as written, otherwise the bytecode goes through the IR passes and sol_peephole
+sol_compile_ex sol_cfun(uint32_t frame, sol_valvec *statics, sol_node *ast, uint32_t arg_c, sol_val *args, uint32_t up_c, sol_upvalue *upvals, bool raw) {
     sol_compiler c = {
         .proto = sol_fproto_new(),
+        .dbg = NULL,
+        .opa = NULL,
+        .kindex = sol_kindex_new(),
         .ast = ast,
         .scopes = sol_scopes_new(),
         .locals = arg_c,
         .max_locals = arg_c,
         .temps = 0, .max_temps = 0,
-        .alloc = alloc,
+        .statics = statics,
         .obj_r = UINT_MAX,
         .frame = frame,
+        .inl = NULL,
+        .hoists = sol_choists_new(),
     };
     c.proto.arg_c = arg_c;
     sol_scopes_push(&c.scopes, sol_scope_new());
     for (uint32_t i = 0; i < arg_c; ++i)
-        sol_scope_set(c.scopes.data + c.scopes.count - 1, *(sf_str *)args[i].dyn, (sol_local){i, 0, false, 0});
+        sol_scope_set(c.scopes.data + c.scopes.count - 1, *(sf_str *)args[i].dyn, (sol_local){i, 0, false, 0, NULL});
     for (uint32_t i = 0; i < up_c; ++i)
-        sol_scope_set(c.scopes.data + c.scopes.count - 1, upvals[i].name, (sol_local){i, 0, true, upvals[i].frame});
+        sol_scope_set(c.scopes.data + c.scopes.count - 1, upvals[i].name, (sol_local){i, 0, true, upvals[i].frame, NULL});
 
     sol_kadd(&c, (sol_val){.tt = SOL_TBOOL, .boolean = false});
     sol_kadd(&c, (sol_val){.tt = SOL_TBOOL, .boolean = true});
@@ -177,7 +719,22 @@ sol_compile_ex sol_cfun(uint32_t frame, sol_dalloc *alloc, sol_node *ast, uint32
     sol_cnode_ex e = sol_cnode(&c, c.ast, UINT32_MAX);
     c.proto.reg_c = c.max_locals + c.max_temps;
 
+    if (e.is_ok && !raw) {
+        sol_cdiscards(&c);
+        sol_ir ir = sol_irnew(&c.proto, c.dbg, (const uint32_t (*)[3])c.opa, c.frame);
+        sol_irrun(&ir, SOL_IR_PASSES, SOL_IR_PASS_C);
+        sol_iralloc(&ir);
+        bool fits = sol_iremit(&ir);
+        sol_irfree(&ir);
+        if (fits) sol_peephole(&c.proto, c.dbg);
+        else e = sol_cnode_ex_err((sol_compile_err){SOL_ERRC_TOO_MANY_REGISTERS, ast->line, ast->column});
+    }
+    c.proto.dbg = sol_dbgencode(c.dbg, c.proto.code_c, &c.proto.dbg_len);
+    free(c.dbg);
+    free(c.opa);
     sol_scopes_free(&c.scopes);
+    sol_kindex_free(&c.kindex);
+    sol_choists_free(&c.hoists);
     return e.is_ok ? sol_compile_ex_ok(c.proto) : sol_compile_ex_err(e.err);
 }
 
@@ -186,6 +743,11 @@ sol_compile_ex sol_cfun(uint32_t frame, sol_dalloc *alloc, sol_node *ast, uint32
 sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
     switch (node->tt) {
         case SOL_ND_MEMBER: {
+            uint32_t h = sol_choisted(c, node);
+            if (h != UINT32_MAX) { // Moved out of a loop
+                sol_cemit(c, sol_cab(SOL_OP_MOVE, t_reg, c->hoists.data[h].reg));
+                return sol_cnode_ex_ok();
+            }
             uint32_t lhs = sol_rtemp(c);
             sol_cnode_ex lex = sol_cnode(c, node->n_postfix.expr, lhs);
             if (!lex.is_ok) return lex;
@@ -195,8 +757,8 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                 name_i = sol_kadd(c, node->n_postfix.postfix);
 
             uint32_t name = sol_rtemp(c);
-            sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, name, name_i));
-            sol_cemit(c, sol_ins_abc(SOL_OP_GET, t_reg, lhs, name));
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, name, name_i));
+            sol_cemit(c, sol_cabc(SOL_OP_GET, t_reg, lhs, name));
             sol_ctemps(c, 2);
 
             return sol_cnode_ex_ok();
@@ -220,7 +782,7 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                 uint32_t nil;
                 if (!sol_kfind(c, SOL_NIL, &nil))
                     nil = sol_kadd(c, SOL_NIL);
-                sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t_reg, nil));
+                sol_cemit(c, sol_cab(SOL_OP_LOAD, t_reg, nil));
             }
             sol_scope s = sol_scopes_pop(&c->scopes);
             sol_clocals(c, (uint32_t)s.pair_count);
@@ -233,13 +795,10 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                 return sol_cerr(SOL_ERRC_UNUSED_EVALUATION);
 
             sol_local loc;
-            if (!sol_lexists(c, *(sf_str *)node->n_identifier.dyn, &loc)) { // Global
-                uint32_t name_i;
-                if (!sol_kfind(c, node->n_identifier, &name_i))
-                    name_i = sol_kadd(c, node->n_identifier);
-                sol_cemit(c, sol_ins_abc(SOL_OP_GUPO, t_reg, 0, name_i)); // state->global
-            } else // Local/Upval
-                sol_cemit(c, sol_ins_ab(loc.upval ? SOL_OP_GETU : SOL_OP_MOVE, t_reg, loc.reg));
+            if (!sol_lexists(c, *(sf_str *)node->n_identifier.dyn, &loc)) // Global
+                sol_cglobal(c, node, t_reg, node->n_identifier); // state->global
+            else // Local/Upval
+                sol_cemit(c, sol_cab(loc.upval ? SOL_OP_GETU : SOL_OP_MOVE, t_reg, loc.reg));
 
             return sol_cnode_ex_ok();
         }
@@ -250,7 +809,7 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             uint32_t pos;
             if (!sol_kfind(c, node->n_literal, &pos))
                 pos = sol_kadd(c, node->n_literal);
-            sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t_reg, pos));
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, t_reg, pos));
             return sol_cnode_ex_ok();
         }
 
@@ -259,15 +818,14 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             if (exists.is_ok)
                 return sol_cerr(SOL_ERRC_REDEFINED_LOCAL);
             uint32_t rhs = sol_rlocal(c);
-            sol_scope_set(c->scopes.data + c->scopes.count - 1, *(sf_str *)node->n_let.name.dyn, (sol_local){rhs, c->scopes.count - 1, false, 0});
+            sol_node *fun = node->n_let.once && node->n_let.value->tt == SOL_ND_FUN ? node->n_let.value : NULL;
+            sol_scope_set(c->scopes.data + c->scopes.count - 1, *(sf_str *)node->n_let.name.dyn, (sol_local){rhs, c->scopes.count - 1, false, 0, fun});
 
             sol_cnode_ex rv_ex = sol_cnode(c, node->n_let.value, rhs);
             if (!rv_ex.is_ok) return rv_ex;
 
-            if (node->n_let.value->tt == SOL_ND_BINARY && sol_niscondition(node->n_let.value)) { // Conditions
-                sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, rhs, 0));
-                sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, rhs, 1));
-            }
+            if (node->n_let.value->tt == SOL_ND_BINARY && sol_niscondition(node->n_let.value)) // Conditions
+                sol_cbool(c, node, rhs, false);
             return sol_cnode_ex_ok();
         }
 
@@ -275,17 +833,18 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             uint32_t right = sol_rtemp(c);
             sol_cnode_ex right_ex = sol_cnode(c, node->n_unary.right, right);
             if (!right_ex.is_ok) return right_ex;
+            if (node->n_unary.right->tt == SOL_ND_BINARY && sol_niscondition(node->n_unary.right)) // Conditions
+                sol_cbool(c, node, right, false);
 
             switch(node->n_unary.op) {
                 case TK_MINUS:
-                    sol_cemit(c, sol_ins_ab(SOL_OP_NEG, t_reg, right));
+                    sol_cemit(c, sol_cab(SOL_OP_NEG, t_reg, right));
                     break;
                 case TK_BANG: {
                     uint32_t t = sol_rtemp(c);
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t, 1));
-                    sol_cemit(c, sol_ins_abc(SOL_OP_EQ, 0, t, right));
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t_reg, 1));
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t_reg, 0));
+                    sol_cemit(c, sol_cab(SOL_OP_LOAD, t, 1));
+                    sol_cemit(c, sol_cabc(SOL_OP_EQ, 0, t, right));
+                    sol_cbool(c, node, t_reg, true);
                     sol_ctemps(c, 1);
                     break;
                 }
@@ -316,21 +875,35 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                         if (sol_lexists(c, *(sf_str *)node->n_binary.left->n_identifier.dyn, &loc)) { // Local/Upval
                             if (node->n_binary.op != TK_EQUAL) {
                                 ot = sol_rtemp(c);
-                                sol_cemit(c, sol_ins_ab(loc.upval ? SOL_OP_GETU : SOL_OP_MOVE, ot, loc.reg));
-                                sol_cemit(c, sol_ins_abc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
+                                sol_cemit(c, sol_cab(loc.upval ? SOL_OP_GETU : SOL_OP_MOVE, ot, loc.reg));
+                                sol_cemit(c, sol_cabc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
                             }
-                            sol_cemit(c, loc.upval ? sol_ins_ab(SOL_OP_SETU, loc.reg, ot) : sol_ins_ab(SOL_OP_MOVE, loc.reg, ot));
+                            sol_cemit(c, loc.upval ? sol_cab(SOL_OP_SETU, loc.reg, ot) : sol_cab(SOL_OP_MOVE, loc.reg, ot));
                         } else { // Global
                             uint32_t name_i;
                             if (!sol_kfind(c, node->n_binary.left->n_identifier, &name_i))
                                 name_i = sol_kadd(c, node->n_binary.left->n_identifier);
                             if (node->n_binary.op != TK_EQUAL) {
                                 ot = sol_rtemp(c);
-                                sol_cemit(c, sol_ins_abc(SOL_OP_GUPO, ot, 0, name_i));
-                                sol_cemit(c, sol_ins_abc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
+                                sol_cgupo(c, node, ot, name_i);
+                                sol_cemit(c, sol_cabc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
                             }
-                            sol_cemit(c, sol_ins_abc(SOL_OP_SUPO, 0, name_i, ot)); // state->global
+                            sol_csupo(c, node, name_i, ot); // state->global
+                        }
+                    } else if (node->n_binary.left->tt == SOL_ND_INDEX) { // Index Assign
+                        uint32_t arr = sol_rtemp(c), idx = sol_rtemp(c);
+                        sol_cnode_ex ex = sol_cnode(c, node->n_binary.left->n_index.expr, arr);
+                        if (!ex.is_ok) return ex;
+                        ex = sol_cnode(c, node->n_binary.left->n_index.index, idx);
+                        if (!ex.is_ok) return ex;
+
+                        if (node->n_binary.op != TK_EQUAL) {
+                            ot = sol_rtemp(c);
+                            sol_cemit(c, sol_cabc(SOL_OP_IGET, ot, arr, idx));
+                            sol_cemit(c, sol_cabc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
                         }
+                        sol_cemit(c, sol_cabc(SOL_OP_ISET, arr, idx, ot));
+                        sol_ctemps(c, 2);
                     } else if (node->n_binary.left->tt == SOL_ND_MEMBER) { // Member Assign
                         uint32_t obj = sol_rtemp(c), name = sol_rtemp(c);
                         sol_cnode_ex ex = sol_cnode(c, node->n_binary.left->n_postfix.expr, obj);
@@ -341,13 +914,13 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                         if (!sol_kfind(c, node->n_binary.left->n_postfix.postfix, &name_i))
                             name_i = sol_kadd(c, node->n_binary.left->n_postfix.postfix);
 
-                        sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, name, name_i));
+                        sol_cemit(c, sol_cab(SOL_OP_LOAD, name, name_i));
                         if (node->n_binary.op != TK_EQUAL) {
                             ot = sol_rtemp(c);
-                            sol_cemit(c, sol_ins_abc(SOL_OP_GET, ot, obj, name));
-                            sol_cemit(c, sol_ins_abc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
+                            sol_cemit(c, sol_cabc(SOL_OP_GET, ot, obj, name));
+                            sol_cemit(c, sol_cabc(node->n_binary.op == TK_PLUS_EQUAL ? SOL_OP_ADD : SOL_OP_SUB, ot, ot, right));
                         }
-                        sol_cemit(c, sol_ins_abc(SOL_OP_SET, obj, name, ot));
+                        sol_cemit(c, sol_cabc(SOL_OP_SET, obj, name, ot));
                         sol_ctemps(c, 2);
                     } else return sol_cerr(SOL_ERRC_INVALID_ASSIGN);
                     sol_ctemps(c, 2);
@@ -355,18 +928,18 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                     return sol_cnode_ex_ok();
                 }
 
-                case TK_PLUS: sol_cemit(c, sol_ins_abc(SOL_OP_ADD, t_reg, left, right)); break;
-                case TK_MINUS: sol_cemit(c, sol_ins_abc(SOL_OP_SUB, t_reg, left, right)); break;
-                case TK_ASTERISK: sol_cemit(c, sol_ins_abc(SOL_OP_MUL, t_reg, left, right)); break;
-                case TK_SLASH: sol_cemit(c, sol_ins_abc(SOL_OP_DIV, t_reg, left, right)); break;
+                case TK_PLUS: sol_cemit(c, sol_cabc(SOL_OP_ADD, t_reg, left, right)); break;
+                case TK_MINUS: sol_cemit(c, sol_cabc(SOL_OP_SUB, t_reg, left, right)); break;
+                case TK_ASTERISK: sol_cemit(c, sol_cabc(SOL_OP_MUL, t_reg, left, right)); break;
+                case TK_SLASH: sol_cemit(c, sol_cabc(SOL_OP_DIV, t_reg, left, right)); break;
 
-                case TK_DOUBLE_EQUAL: sol_cemit(c, sol_ins_abc(SOL_OP_EQ, 0, left, right)); break;
-                case TK_LESS: sol_cemit(c, sol_ins_abc(SOL_OP_LT, 0, left, right)); break;
-                case TK_LESS_EQUAL: sol_cemit(c, sol_ins_abc(SOL_OP_LE, 0, left, right)); break;
+                case TK_DOUBLE_EQUAL: sol_cemit(c, sol_cabc(SOL_OP_EQ, 0, left, right)); break;
+                case TK_LESS: sol_cemit(c, sol_cabc(SOL_OP_LT, 0, left, right)); break;
+                case TK_LESS_EQUAL: sol_cemit(c, sol_cabc(SOL_OP_LE, 0, left, right)); break;
 
-                case TK_NOT_EQUAL: sol_cemit(c, sol_ins_abc(SOL_OP_EQ, 1, left, right)); break;
-                case TK_GREATER: sol_cemit(c, sol_ins_abc(SOL_OP_LT, 1, left, right)); break;
-                case TK_GREATER_EQUAL: sol_cemit(c, sol_ins_abc(SOL_OP_LE, 1, left, right)); break;
+                case TK_NOT_EQUAL: sol_cemit(c, sol_cabc(SOL_OP_EQ, 1, left, right)); break;
+                case TK_GREATER: sol_cemit(c, sol_cabc(SOL_OP_LT, 0, right, left)); break;
+                case TK_GREATER_EQUAL: sol_cemit(c, sol_cabc(SOL_OP_LE, 0, right, left)); break;
 
                 default:
                     return sol_cerr(SOL_ERRC_UNKNOWN_OPERATION);
@@ -376,14 +949,18 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             return sol_cnode_ex_ok();
         }
         case SOL_ND_CALL: {
+            sol_local loc;
+            if (node->n_call.identifier->tt == SOL_ND_IDENTIFIER &&
+                sol_lexists(c, *(sf_str *)node->n_call.identifier->n_identifier.dyn, &loc) &&
+                !loc.upval && loc.fun && sol_cinlinable(loc.fun, node->n_call.arg_c))
+                return sol_cinline(c, node, loc.fun, t_reg);
+
             uint32_t arg_rs = UINT32_MAX;  // Args temps start
             for (size_t i = 0; i < node->n_call.arg_c; ++i) {
                 uint32_t r = sol_rtemp(c);
                 sol_cnode_ex ex = sol_cnode(c, node->n_call.args[i], r);
-                if (node->n_call.args[i]->tt == SOL_ND_BINARY && sol_niscondition(node->n_call.args[i])) { // Conditions
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, r, 0));
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, r, 1));
-                }
+                if (node->n_call.args[i]->tt == SOL_ND_BINARY && sol_niscondition(node->n_call.args[i])) // Conditions
+                    sol_cbool(c, node, r, false);
 
                 if (!ex.is_ok) return ex;
                 if (arg_rs == UINT32_MAX) arg_rs = r;
@@ -392,7 +969,7 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             uint32_t f_reg = sol_rtemp(c);
             sol_cnode_ex lex = sol_cnode(c, node->n_call.identifier, f_reg);
             if (!lex.is_ok) return lex;
-            sol_cemit(c, sol_ins_abc(SOL_OP_CALL, t_reg == UINT32_MAX ? sol_rtemp(c) : t_reg, f_reg, arg_rs == UINT32_MAX ? 0 : arg_rs));
+            sol_cemit(c, sol_cabc(SOL_OP_CALL, t_reg == UINT32_MAX ? sol_rtemp(c) : t_reg, f_reg, arg_rs == UINT32_MAX ? f_reg : arg_rs)); // Args are the registers from c to b
 
             sol_ctemps(c, t_reg == UINT32_MAX ? node->n_call.arg_c + 2 : node->n_call.arg_c + 1);
             return sol_cnode_ex_ok();
@@ -400,7 +977,8 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
         case SOL_ND_FUN:
         case SOL_ND_ASM: {
             uint32_t r_asm = 0;
-            if (node->tt == SOL_ND_ASM) {
+            bool raw = node->tt == SOL_ND_ASM;
+            if (raw) {
                 r_asm = (uint32_t)node->n_asm.temps;
                 node = node->n_asm.n_fun;
             }
@@ -421,7 +999,7 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                     if (loc.upval)
                         upvals[c->proto.up_c + i] = (sol_upvalue){sf_str_dup(name), SOL_UP_REF, .ref = loc.reg, .frame = loc.frame};
                     else {
-                        sol_cemit(c, sol_ins_a(SOL_OP_REFU, loc.reg));
+                        sol_cemit(c, sol_ca(SOL_OP_REFU, (int32_t)loc.reg));
                         upvals[c->proto.up_c + i] = (sol_upvalue){sf_str_dup(name), SOL_UP_REF, .ref = loc.reg, .frame = c->frame};
                     }
                 }
@@ -429,33 +1007,22 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
 
             sol_compile_ex ex = sol_cfun(
                 c->frame + 1,
-                c->alloc,
+                c->statics,
                 node->n_fun.block,
                 node->n_fun.arg_c, node->n_fun.args,
-                c->proto.up_c + node->n_fun.cap_c, upvals
+                c->proto.up_c + node->n_fun.cap_c, upvals,
+                raw
             );
             free(upvals);
 
             if (!ex.is_ok) return sol_cnode_ex_err(ex.err);
             if (r_asm != 0) ex.ok.reg_c += r_asm;
-            sol_dyn p = calloc(1, sizeof(sol_dalloc) + sizeof(sol_fproto));
-            sol_dalloc *dh = p, *dd = c->alloc;
-            *dh = (sol_dalloc){
-                .next = NULL,
-                .size = sizeof(sol_fproto),
-                .tt = SOL_DFUN,
-                .mark = SOL_DYN_GREEN,
-            };
-            if (dd == NULL) c->alloc = dh;
-            else {
-                while (dd->next) dd = dd->next;
-                dd->next = dh;
-            }
-            sol_val fun = (sol_val){ .tt = SOL_TDYN, .dyn = (char *)p + sizeof(sol_dalloc) };
+            sol_val fun = sol_dnstatic(SOL_DFUN);
             *(sol_fproto *)fun.dyn = ex.ok;
+            sol_valvec_push(c->statics, fun);
 
             sol_kadd(c, fun);
-            sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, t_reg, c->proto.constants.count - 1));
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, t_reg, c->proto.constants.count - 1));
             return sol_cnode_ex_ok();
         }
         case SOL_ND_INS: {
@@ -466,7 +1033,7 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                     (node->n_ins.op == SOL_OP_SUPO && i == 1) ||
                     (node->n_ins.op == SOL_OP_GUPO && i == 2)) {
                     uint32_t pos;
-                    if (!sol_kfind(c, node->n_literal, &pos))
+                    if (!sol_kfind(c, v, &pos))
                         pos = sol_kadd(c, v);
                     opa[i] = pos;
                     continue;
@@ -482,56 +1049,23 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
             }
 
             switch (sol_op_info(node->n_ins.op)->type) {
-                case SOL_INS_A:   sol_cemit(c, sol_ins_a(node->n_ins.op, opa[0])); break;
-                case SOL_INS_AB:  sol_cemit(c, sol_ins_ab((uint32_t)node->n_ins.op, (uint32_t)opa[0], (uint32_t)opa[1])); break;
-                case SOL_INS_ABC: sol_cemit(c, sol_ins_abc((uint32_t)node->n_ins.op, (uint32_t)opa[0], (uint32_t)opa[1], (uint32_t)opa[2])); break;
+                case SOL_INS_A:   sol_cemit(c, sol_ca(node->n_ins.op, (int32_t)opa[0])); break;
+                case SOL_INS_AB:  sol_cemit(c, sol_cab((uint32_t)node->n_ins.op, (uint32_t)opa[0], (uint32_t)opa[1])); break;
+                case SOL_INS_ABC: sol_cemit(c, sol_cabc((uint32_t)node->n_ins.op, (uint32_t)opa[0], (uint32_t)opa[1], (uint32_t)opa[2])); break;
             }
             return sol_cnode_ex_ok();
         }
 
         case SOL_ND_IF: {
-            uint32_t cr = sol_rtemp(c);
-            uint32_t s = 0;
-            sol_node *cond = node->n_if.condition;
-            if (cond->tt == SOL_ND_UNARY) {
-                s = 1;
-                cond = cond->n_unary.right;
-            }
-
-            if (cond->tt == SOL_ND_IDENTIFIER) {
-                sol_local loc;
-                if (!sol_lexists(c, *(sf_str *)cond->n_identifier.dyn, &loc)) { // Global
-                    uint32_t name_i;
-                    if (!sol_kfind(c, cond->n_identifier, &name_i))
-                        name_i = sol_kadd(c, cond->n_identifier);
-
-                    uint32_t id_r = sol_rtemp(c);
-                    sol_cemit(c, sol_ins_abc(SOL_OP_GUPO, id_r, 0, name_i));
-                    sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, id_r, cr));
-                    sol_ctemps(c, 1);
-                } else { // Local
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, cr, 1));
-                    if (loc.upval) { // Reserve temp for upval
-                        uint32_t up = sol_rtemp(c);
-                        sol_cemit(c, sol_ins_ab(SOL_OP_GETU, up, loc.reg));
-                        sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, up, cr));
-                        sol_ctemps(c, 1);
-                    } else
-                        sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, loc.reg, cr));
-                }
-            } else {
-                sol_cnode_ex ex = sol_cnode(c, cond, cr);
-                if (cond->tt == SOL_ND_CALL || cond->tt == SOL_ND_LITERAL) {
-                    uint32_t ttemp = sol_rtemp(c);
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, ttemp, 1));
-                    sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, cr, ttemp));
-                    sol_ctemps(c, 1);
-                }
-                if (!ex.is_ok) return ex;
+            if (sol_nisbool(node->n_if.condition)) { // Folded, only the taken arm is compiled
+                sol_node *taken = node->n_if.condition->n_literal.boolean ? node->n_if.then_node : node->n_if.else_node;
+                return taken ? sol_cnode(c, taken, t_reg) : sol_cnode_ex_ok();
             }
+            sol_cnode_ex cex = sol_ccond(c, node, node->n_if.condition);
+            if (!cex.is_ok) return cex;
 
             uint32_t jmp_false = c->proto.code_c;
-            sol_cemit(c, sol_ins_a(SOL_OP_JMP, 0));
+            sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
 
             // Then
             sol_cnode_ex ex = sol_cnode(c, node->n_if.then_node, t_reg);
@@ -540,69 +1074,93 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
 
             if (node->n_if.else_node) {
                 uint32_t jmp_end = c->proto.code_c;
-                sol_cemit(c, sol_ins_a(SOL_OP_JMP, 0));
+                sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
                 ex = sol_cnode(c, node->n_if.else_node, t_reg);
                 if (!ex.is_ok) return ex;
                 // Patch jump
                 c->proto.code[jmp_false] = sol_ins_a(SOL_OP_JMP, ofs + 1);
                 c->proto.code[jmp_end] = sol_ins_a(SOL_OP_JMP, c->proto.code_c - (jmp_end + 1));
             } else c->proto.code[jmp_false] = sol_ins_a(SOL_OP_JMP, ofs);
-
-            sol_ctemps(c, 1);
             return sol_cnode_ex_ok();
         }
         case SOL_ND_WHILE: {
-            uint32_t jmp_cond = c->proto.code_c - 1;
-            uint32_t cr = sol_rtemp(c);
-            uint32_t s = 0;
-            sol_node *cond = node->n_while.condition;
-            if (cond->tt == SOL_ND_UNARY) {
-                s = 1;
-                cond = cond->n_unary.right;
+            bool forever = sol_nisbool(node->n_while.condition);
+            if (forever && !node->n_while.condition->n_literal.boolean) return sol_cnode_ex_ok(); // Folded, never runs
+            sol_choists hoists = sol_cinvariants(c, node);
+            uint32_t first = c->hoists.count, exits[2], exit_c = 0;
+
+            // With lookups to move out, the condition is tested once first and they're read
+            // only if the loop runs, then it's tested again at the bottom of every pass
+            bool rotate = !forever && hoists.count;
+            sol_cnode_ex ex = sol_cnode_ex_ok();
+            if (rotate) {
+                ex = sol_ccond(c, node, node->n_while.condition);
+                exits[exit_c++] = c->proto.code_c;
+                sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
+            }
+            if (ex.is_ok) sol_cpreheader(c, &hoists);
+            uint32_t loop = c->proto.code_c;
+            if (ex.is_ok && !forever && !rotate) {
+                ex = sol_ccond(c, node, node->n_while.condition);
+                exits[exit_c++] = c->proto.code_c;
+                sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
             }
 
-            if (cond->tt == SOL_ND_IDENTIFIER) {
-                sol_local loc;
-                if (!sol_lexists(c, *(sf_str *)cond->n_identifier.dyn, &loc)) { // Global
-                    uint32_t name_i;
-                    if (!sol_kfind(c, cond->n_identifier, &name_i))
-                        name_i = sol_kadd(c, cond->n_identifier);
-
-                    uint32_t id_r = sol_rtemp(c);
-                    sol_cemit(c, sol_ins_abc(SOL_OP_GUPO, id_r, 0, name_i));
-                    sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, id_r, cr));
-                    sol_ctemps(c, 1);
-                } else { // Local
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, cr, 1));
-                    if (loc.upval) { // Reserve temp for upval
-                        uint32_t up = sol_rtemp(c);
-                        sol_cemit(c, sol_ins_ab(SOL_OP_GETU, up, loc.reg));
-                        sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, up, cr));
-                        sol_ctemps(c, 1);
-                    } else
-                        sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, loc.reg, cr));
-                }
-            } else {
-                sol_cnode_ex ex = sol_cnode(c, cond, cr);
-                if (cond->tt == SOL_ND_CALL || cond->tt == SOL_ND_LITERAL) {
-                    uint32_t ttemp = sol_rtemp(c);
-                    sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, ttemp, 1));
-                    sol_cemit(c, sol_ins_abc(SOL_OP_EQ, s, cr, ttemp));
-                    sol_ctemps(c, 1);
-                }
-                if (!ex.is_ok) return ex;
+            // Do
+            if (ex.is_ok) ex = sol_cnode(c, node->n_while.stmt, UINT32_MAX);
+            if (ex.is_ok && rotate) {
+                ex = sol_ccond(c, node, node->n_while.condition);
+                exits[exit_c++] = c->proto.code_c;
+                sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
             }
+            if (ex.is_ok) {
+                sol_cemit(c, sol_ca(SOL_OP_JMP, (int32_t)loop - 1 - (int32_t)c->proto.code_c));
+                for (uint32_t i = 0; i < exit_c; ++i)
+                    c->proto.code[exits[i]] = sol_ins_a(SOL_OP_JMP, c->proto.code_c - (exits[i] + 1));
+            }
+
+            sol_clocals(c, c->hoists.count - first);
+            c->hoists.count = first;
+            sol_choists_free(&hoists);
+            return ex;
+        }
+        case SOL_ND_FOR: {
+            sf_str key = *(sf_str *)node->n_for.key.dyn;
+            if (node->n_for.val.tt != SOL_TNIL && sf_str_eq(key, *(sf_str *)node->n_for.val.dyn))
+                return sol_cerr(SOL_ERRC_REDEFINED_LOCAL);
+
+            // Unnamed locals keep the iterated value and the cursor, NEXT writes the key
+            // and value into the two locals after the cursor
+            uint32_t it = sol_rlocal(c);
+            sol_cnode_ex ex = sol_cnode(c, node->n_for.expr, it);
+            if (!ex.is_ok) return ex;
+            uint32_t cur = sol_rlocal(c), kr = sol_rlocal(c), vr = sol_rlocal(c);
 
+            sol_scopes_push(&c->scopes, sol_scope_new());
+            sol_scope *sc = c->scopes.data + c->scopes.count - 1;
+            sol_scope_set(sc, key, (sol_local){kr, c->scopes.count - 1, false, 0, NULL});
+            if (node->n_for.val.tt != SOL_TNIL)
+                sol_scope_set(sc, *(sf_str *)node->n_for.val.dyn, (sol_local){vr, c->scopes.count - 1, false, 0, NULL});
+
+            uint32_t zero;
+            sol_val zv = {.tt = SOL_TI64, .i64 = 0};
+            if (!sol_kfind(c, zv, &zero))
+                zero = sol_kadd(c, zv);
+            sol_cemit(c, sol_cab(SOL_OP_LOAD, cur, zero));
+
+            uint32_t loop = c->proto.code_c;
+            sol_cemit(c, sol_cab(SOL_OP_NEXT, cur, it));
             uint32_t jmp_break = c->proto.code_c;
-            sol_cemit(c, sol_ins_a(SOL_OP_JMP, 0));
+            sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
 
-            // Do
-            sol_cnode_ex ex = sol_cnode(c, node->n_while.stmt, UINT32_MAX);
+            ex = sol_cnode(c, node->n_for.stmt, UINT32_MAX);
             if (!ex.is_ok) return ex;
             c->proto.code[jmp_break] = sol_ins_a(SOL_OP_JMP, c->proto.code_c - jmp_break);
-            sol_cemit(c, sol_ins_a(SOL_OP_JMP, jmp_cond - c->proto.code_c));
+            sol_cemit(c, sol_ca(SOL_OP_JMP, (int32_t)loop - 1 - (int32_t)c->proto.code_c));
 
-            sol_ctemps(c, 1);
+            sol_scope s = sol_scopes_pop(&c->scopes);
+            sol_scope_free(&s);
+            sol_clocals(c, 4);
             return sol_cnode_ex_ok();
         }
         case SOL_ND_RETURN: {
@@ -610,15 +1168,23 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                 sol_cnode_ex ex = sol_cnode(c, node->n_return.expr, t_reg);
                 return ex;
             }
+            if (c->inl) { // Leaves an inlined body
+                sol_cnode_ex ex = sol_cnode(c, node->n_return.expr, c->inl->ret);
+                if (!ex.is_ok) return ex;
+                c->inl->exits = realloc(c->inl->exits, (c->inl->exit_c + 1) * sizeof(uint32_t));
+                c->inl->exits[c->inl->exit_c++] = c->proto.code_c;
+                sol_cemit(c, sol_ca(SOL_OP_JMP, 0));
+                return sol_cnode_ex_ok();
+            }
             uint32_t r = sol_rtemp(c);
             sol_cnode_ex ex = sol_cnode(c, node->n_return.expr, r);
             if (!ex.is_ok) return ex;
-            sol_cemit(c, sol_ins_a(SOL_OP_RET, r));
+            sol_cemit(c, sol_ca(SOL_OP_RET, (int32_t)r));
             return sol_cnode_ex_ok();
         }
 
         case SOL_ND_OBJ: {
-            sol_cemit(c, sol_ins_a(SOL_OP_NEW, t_reg));
+            sol_cemit(c, sol_ca(SOL_OP_NEW, (int32_t)t_reg));
             uint32_t nt = sol_rtemp(c), it = sol_rtemp(c);
             uint32_t obj_r = c->obj_r;
             c->obj_r = t_reg;
@@ -629,18 +1195,61 @@ sol_cnode_ex sol_cnode(sol_compiler *c, sol_node *node, uint32_t t_reg) {
                     name_i = sol_kadd(c, nd->n_binary.left->n_identifier);
                 sol_cnode_ex right = sol_cnode(c, nd->n_binary.right, it);
                 if (!right.is_ok) return right;
-                sol_cemit(c, sol_ins_ab(SOL_OP_LOAD, nt, name_i));
-                sol_cemit(c, sol_ins_abc(SOL_OP_SET, t_reg, nt, it));
+                sol_cemit(c, sol_cab(SOL_OP_LOAD, nt, name_i));
+                sol_cemit(c, sol_cabc(SOL_OP_SET, t_reg, nt, it));
             }
             c->obj_r = obj_r;
             sol_ctemps(c, 2);
             return sol_cnode_ex_ok();
         }
 
+        case SOL_ND_ARRAY: {
+            if (t_reg == UINT32_MAX)
+                return sol_cerr(SOL_ERRC_UNUSED_EVALUATION);
+
+            sol_cemit(c, sol_ca(SOL_OP_ARR, (int32_t)t_reg));
+            uint32_t it = sol_rtemp(c);
+            for (uint32_t i = 0; i < node->n_array.elem_c; ++i) {
+                sol_node *nd = node->n_array.elems[i];
+                sol_cnode_ex ex = sol_cnode(c, nd, it);
+                if (!ex.is_ok) return ex;
+                if (nd->tt == SOL_ND_BINARY && sol_niscondition(nd)) { // Conditions
+                    sol_cemit(c, sol_cab(SOL_OP_LOAD, it, 0));
+                    sol_cemit(c, sol_cab(SOL_OP_LOAD, it, 1));
+                }
+                sol_cemit(c, sol_cab(SOL_OP_PUSH, t_reg, it));
+            }
+            sol_ctemps(c, 1);
+            return sol_cnode_ex_ok();
+        }
+        case SOL_ND_INDEX: {
+            if (t_reg == UINT32_MAX)
+                return sol_cerr(SOL_ERRC_UNUSED_EVALUATION);
+
+            uint32_t arr = sol_rtemp(c), idx = sol_rtemp(c);
+            sol_cnode_ex ex = sol_cnode(c, node->n_index.expr, arr);
+            if (!ex.is_ok) return ex;
+            ex = sol_cnode(c, node->n_index.index, idx);
+            if (!ex.is_ok) return ex;
+            sol_cemit(c, sol_cabc(SOL_OP_IGET, t_reg, arr, idx));
+            sol_ctemps(c, 2);
+            return sol_cnode_ex_ok();
+        }
+
         default: return sol_cerr(SOL_ERRC_UNKNOWN);
     }
 }
 
+/// Free the statics made while compiling. Constants are copies, but funs share their
+/// code with the copy in the constant table, so only their headers are freed here
+static void sol_cstatics_free(sol_valvec *statics) {
+    for (sol_val *v = statics->data; v && v < statics->data + statics->count; ++v) {
+        if (sol_isdtype(*v, SOL_DFUN)) free(sol_dheader(*v));
+        else sol_dclean(*v);
+    }
+    sol_valvec_free(statics);
+}
+
 sol_compile_ex sol_cproto(sf_str src, uint32_t arg_c, sol_val *args, uint32_t up_c, sol_upvalue *upvals) {
     sol_scan_ex scan_ex = sol_scan(src);
     if (!scan_ex.is_ok)
@@ -650,24 +1259,18 @@ sol_compile_ex sol_cproto(sf_str src, uint32_t arg_c, sol_val *args, uint32_t up
             .column = scan_ex.err.column,
         });
     sol_parse_ex par_ex = sol_parse(&scan_ex.ok.tv);
-    if (!par_ex.is_ok)
+    if (!par_ex.is_ok) {
+        sol_cstatics_free(&scan_ex.ok.statics);
         return sol_compile_ex_err((sol_compile_err){
             .tt = par_ex.err.tt,
             .line = par_ex.err.line,
             .column = par_ex.err.column,
         });
+    }
 
-    sol_compile_ex ex = sol_cfun(0, scan_ex.ok.alloc, par_ex.ok, arg_c, args, up_c, upvals);
+    sol_fold(par_ex.ok, &scan_ex.ok.statics);
+    sol_compile_ex ex = sol_cfun(0, &scan_ex.ok.statics, par_ex.ok, arg_c, args, up_c, upvals, false);
     sol_node_free(par_ex.ok);
-
-    for (sol_dalloc *ac = scan_ex.ok.alloc; ac; ) {
-        sol_dalloc *next = ac->next;
-        if (ac->tt == SOL_DSTR) {
-            sf_str *str = (sf_str *)((char *)ac + sizeof(sol_dalloc));
-            sf_str_free(*str);
-        }
-        free(ac);
-        ac = next;
-    }
+    sol_cstatics_free(&scan_ex.ok.statics);
     return ex;
 }
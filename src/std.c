@@ -1,4 +1,7 @@
 #include "sol/bytecode.h"
+#include "sol/bytes.h"
+#include "sol/strbuf.h"
+#include "sol/typed.h"
 #include "sol/vm.h"
 #include "sf/math.h"
 #include "sf/str.h"
@@ -51,35 +54,38 @@ double sol_timesec(void) {
     if (!sol_isdtype(val, T)) \
         return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "'%s' expected %s, found %s", #val, SOL_TYPE_NAMES[(int)SOL_TDYN + 1 + T], sol_typename(val).c_str); \
 } while (0);
+#define expect_mutable(val) do { \
+    if (sol_dfrozen(val)) \
+        return sol_serrf(SOL_ERRV_FROZEN, "'%s' is frozen", #val); \
+} while (0);
 
 
-static sol_call_ex builtin_import(sol_state *s) {
+/// import and reload, relative to the file calling them. Failures are returned as errs
+static sol_call_ex builtin_module(sol_state *s, bool reload) {
     sol_val path = sol_get(s, 0);
     expect_dtype(SOL_DSTR, path)
 
     sf_str cwd = sol_cwd(s);
-
-    sf_str p = sf_str_fmt("%s%s", cwd.c_str, ((sf_str *)path.dyn)->c_str);
-    if (!sf_file_exists(p)) {
-        sf_str p2 = sf_str_fmt("%s.sol", p.c_str);
-        sf_str_free(p);
-        p = p2;
-    }
-    if (!sf_file_exists(p)) {
-        sf_str p2 = sf_str_fmt("File '%s' not found", p.c_str);
+    sf_str p = sf_str_fmt("%s%s", cwd.c_str, sol_dcstr(path).c_str);
+    sf_str_free(cwd);
+    sol_call_ex ex = reload ? sol_reload(s, p) : sol_import(s, p);
+    if (!ex.is_ok && ex.err.tt == SOL_ERRC_FILE_NOT_FOUND) {
+        // Paths without the extension were looked for with it too, name the one a user meant
+        bool ext = p.len >= 4 && memcmp(p.c_str + p.len - 4, ".sol", 4) == 0;
+        sf_str msg = sf_str_fmt(ext ? "File '%s' not found" : "File '%s.sol' not found", p.c_str);
         sf_str_free(p);
-        return sol_call_ex_ok(sol_dnerr(s, p2));
+        return sol_call_ex_ok(sol_dnerr(s, msg));
     }
-
-    sol_compile_ex cm_ex = sol_cfile(s, p);
-    if (!cm_ex.is_ok)
-        return sol_call_ex_ok(sol_dnerr(s, sf_str_dup(sol_err_string(cm_ex.err.tt))));
-    sol_call_ex cl_ex = sol_call(s, &cm_ex.ok, NULL, 0);
-    sol_fproto_free(&cm_ex.ok);
-    if (!cl_ex.is_ok)
-            return sol_call_ex_ok(sol_dnerr(s, sf_str_dup(cl_ex.err.panic)
-            ));
-    return cl_ex;
+    sf_str_free(p);
+    if (!ex.is_ok)
+        return sol_call_ex_ok(sol_dnerr(s, sf_isempty(ex.err.panic) ? sf_str_dup(sol_err_string(ex.err.tt)) : ex.err.panic));
+    return ex;
+}
+static sol_call_ex builtin_import(sol_state *s) {
+    return builtin_module(s, false);
+}
+static sol_call_ex builtin_reload(sol_state *s) {
+    return builtin_module(s, true);
 }
 static sol_call_ex builtin_require(sol_state *s) {
     sol_call_ex import = builtin_import(s);
@@ -94,7 +100,7 @@ static sol_call_ex builtin_eval(sol_state *s) {
     sol_val src = sol_get(s, 0);
     expect_dtype(SOL_DSTR, src);
 
-    sol_compile_ex cm_ex = sol_csrc(s, *(sf_str *)src.dyn);
+    sol_compile_ex cm_ex = sol_csrc(s, sol_dcstr(src));
     if (!cm_ex.is_ok)
         return sol_call_ex_ok(sol_dnerr(s, sf_str_dup(sol_err_string(cm_ex.err.tt))));
     sol_call_ex cl_ex = sol_call(s, &cm_ex.ok, NULL, 0);
@@ -126,9 +132,10 @@ static sol_call_ex builtin_catch(sol_state *s) {
         return sol_call_ex_err((sol_call_err){SOL_ERRV_TYPE_MISMATCH,
             sf_str_fmt("Arg 'try' expected fun, found '%s'", sol_typename(try).c_str),
         0});
+    uint32_t depth = s->frames.count;
     sol_call_ex try_ex = sol_call(s, try.dyn, NULL, 0);
     if (!try_ex.is_ok) {
-        sol_popframe(s); // Frame remains after panic!
+        while (s->frames.count > depth) sol_popframe(s); // Frames of every call the panic left remain!
         return sol_call_ex_ok(sol_dnerr(s, sf_str_dup(try_ex.err.panic)));
     }
     return sol_call_ex_ok(try_ex.ok);
@@ -144,9 +151,10 @@ static sol_call_ex builtin_attempt(sol_state *s) {
         return sol_call_ex_err((sol_call_err){SOL_ERRV_TYPE_MISMATCH,
             sf_str_fmt("Arg 'handler' expected fun, found '%s'", sol_typename(handler).c_str),
         0});
+    uint32_t depth = s->frames.count;
     sol_call_ex try_ex = sol_call(s, try.dyn, NULL, 0);
     if (!try_ex.is_ok) {
-        sol_popframe(s); // Frame remains after panic!
+        while (s->frames.count > depth) sol_popframe(s); // Frames of every call the panic left remain!
         sol_val err = sol_dnerr(s, sf_str_dup(try_ex.err.panic));
         sol_call_ex hand_ex = sol_call(s, handler.dyn, (sol_val[]){err}, 1);
         if (!hand_ex.is_ok) return hand_ex;
@@ -177,7 +185,18 @@ static sol_call_ex builtin_assert(sol_state *s) {
     return con.boolean ? sol_call_ex_ok(SOL_NIL) : sol_call_ex_err((sol_call_err){SOL_ERRV_ASSERT, SF_STR_EMPTY, 0});
 }
 static sol_call_ex builtin_type(sol_state *s) {
-    return sol_call_ex_ok(sol_dnstr(s, sol_typename(sol_get(s, 0))));
+    return sol_call_ex_ok(sol_dnstr(s, sf_str_dup(sol_typename(sol_get(s, 0)))));
+}
+
+static sol_call_ex builtin_freeze(sol_state *s) {
+    sol_val val = sol_get(s, 0);
+    sol_freeze_ex ex = sol_dsfreeze(s, val);
+    if (!ex.is_ok)
+        return sol_serr(SOL_ERRV_TYPE_MISMATCH, "Only strs, errs, objs and arrays can be frozen");
+    return sol_call_ex_ok(ex.ok);
+}
+static sol_call_ex builtin_frozen(sol_state *s) {
+    return sol_call_ex_ok((sol_val){.tt = SOL_TBOOL, .boolean = sol_dfrozen(sol_get(s, 0))});
 }
 
 static sol_call_ex builtin_str(sol_state *s) {
@@ -216,7 +235,7 @@ static sol_call_ex io_fread(sol_state *s) {
     sol_val path = sol_get(s, 0);
     expect_dtype(SOL_DSTR, path);
 
-    sf_str p = *(sf_str *)path.dyn;
+    sf_str p = sol_dcstr(path);
     if (!sf_file_exists(p))
         return sol_call_ex_ok(sol_dnerr(s, sf_str_fmt("File '%s' not found", p.c_str)));
     sf_fsb_ex fsb = sf_file_buffer(p);
@@ -236,13 +255,29 @@ static sol_call_ex io_fread(sol_state *s) {
     *(sf_str *)str.dyn = sf_own((char *)fsb.ok.ptr);
     return sol_call_ex_ok(str);
 }
+static sol_call_ex io_freadb(sol_state *s) {
+    sol_val path = sol_get(s, 0);
+    expect_dtype(SOL_DSTR, path);
+
+    sf_str p = sol_dcstr(path);
+    sol_val bytes = sol_byread(s, p.c_str);
+    if (bytes.tt == SOL_TNIL)
+        return sol_call_ex_ok(sol_dnerr(s, sf_str_fmt("File '%s' failed to read", p.c_str)));
+    return sol_call_ex_ok(bytes);
+}
 static sol_call_ex io_fwrite(sol_state *s) {
     sol_val path = sol_get(s, 0);
     expect_dtype(SOL_DSTR, path);
     sol_val content = sol_get(s, 1);
-    expect_dtype(SOL_DSTR, content);
 
-    sf_str p = *(sf_str *)path.dyn;
+    sf_str p = sol_dcstr(path);
+    sol_bytes *b = sol_byof(content);
+    if (b) {
+        if (!sol_bywrite(b, p.c_str))
+            return sol_call_ex_ok(sol_dnerr(s, sf_str_fmt("File '%s' failed to write", p.c_str)));
+        return sol_call_ex_ok(SOL_NIL);
+    }
+    expect_dtype(SOL_DSTR, content);
     sf_str cont = *(sf_str *)content.dyn;
 
     FILE *f = fopen(p.c_str, "w");
@@ -252,6 +287,15 @@ static sol_call_ex io_fwrite(sol_state *s) {
 
     return sol_call_ex_ok(SOL_NIL);
 }
+static sol_call_ex io_fremove(sol_state *s) {
+    sol_val path = sol_get(s, 0);
+    expect_dtype(SOL_DSTR, path);
+
+    sf_str p = sol_dcstr(path);
+    if (remove(p.c_str) != 0)
+        return sol_call_ex_ok(sol_dnerr(s, sf_str_fmt("File '%s' failed to remove", p.c_str)));
+    return sol_call_ex_ok(SOL_NIL);
+}
 
 static sol_call_ex string_sub(sol_state *s) {
     sol_val str = sol_get(s, 0);
@@ -270,11 +314,8 @@ static sol_call_ex string_sub(sol_state *s) {
     start.i64 = max(0, min(start.i64, len > 0 ? len - 1 : 0));
     end.i64 = max(0, min(end.i64, len > 0 ? len - 1 : 0));
 
-    size_t slen = (size_t)(end.i64 - start.i64 + 1);
-    char *buf = malloc(slen + 1);
-    memcpy(buf, sstr->c_str + start.i64, slen - 1);
-    buf[slen] = 0;
-    return sol_call_ex_ok(sol_dnstr(s, sf_own(buf)));
+    // Substrings share the characters of str
+    return sol_call_ex_ok(sol_dnview(s, str, (size_t)start.i64, (size_t)(end.i64 - start.i64 + 1)));
 }
 static sol_call_ex string_len(sol_state *s) {
     sol_val str = sol_get(s, 0);
@@ -288,8 +329,13 @@ static sol_call_ex obj_new(sol_state *s) {
 static sol_call_ex obj_set(sol_state *s) {
     sol_val obj = sol_get(s, 0);
     expect_dtype(SOL_DOBJ, obj);
+    expect_mutable(obj);
     sol_val key = sol_get(s, 1);
     sol_val val = sol_get(s, 2);
+    if (key.tt == SOL_TI64) {
+        sol_dobj_seti(obj.dyn, key.i64, val);
+        return sol_call_ex_ok(SOL_NIL);
+    }
 
     sf_str kstr;
     if (!sol_isdtype(key, SOL_DSTR))
@@ -304,11 +350,17 @@ static sol_call_ex obj_get(sol_state *s) {
     sol_val key = sol_get(s, 1);
 
     sf_str kstr;
-    if (!sol_isdtype(key, SOL_DSTR))
+    sol_dobj_ex ex;
+    if (key.tt == SOL_TI64) {
+        ex = sol_dobj_geti(obj.dyn, key.i64);
+        if (ex.is_ok) return sol_call_ex_ok(ex.ok);
         kstr = sol_tostring(key);
-    else kstr = sf_str_dup(*(sf_str *)key.dyn);
-
-    sol_dobj_ex ex = sol_dobj_get(obj.dyn, kstr);
+    } else {
+        if (!sol_isdtype(key, SOL_DSTR))
+            kstr = sol_tostring(key);
+        else kstr = sf_str_dup(*(sf_str *)key.dyn);
+        ex = sol_dobj_get(obj.dyn, kstr);
+    }
     if (!ex.is_ok) {
         sf_str estr = sf_str_fmt("Object does not contain member '%s'", kstr.c_str);
         sf_str_free(kstr);
@@ -318,44 +370,33 @@ static sol_call_ex obj_get(sol_state *s) {
 }
 
 typedef struct {
-    sf_str *out;
+    sol_strbuf *out;
     bool pretty, commas;
     uint32_t id;
 } _sol_stringify_args;
 static void _stringify_fe(void *u, sf_str key, sol_val val);
-static sf_str _stringify(sol_dobj *obj, bool pretty, bool commas, uint32_t id) {
-    if (obj->pair_count == 0) return sf_lit("{}");
-    sf_str out = sf_str_cdup(pretty ? "{\n" : "{ ");
-    sol_dobj_foreach(obj, _stringify_fe, &(_sol_stringify_args){&out, pretty, commas, id});
-
-    if (pretty && id) {
-        size_t s = sizeof(char) * (id-1) * 2;
-        char *idt = malloc(s + 1);
-        memset(idt, ' ', sizeof(char) * (id-1) * 2);
-        sf_str_append(&out, sf_ref(idt));
-        free(idt);
+static void _stringify(sol_strbuf *out, sol_dobj *obj, bool pretty, bool commas, uint32_t id) {
+    if (sol_dobj_count(obj) == 0) {
+        sol_sbappend(out, sf_lit("{}"));
+        return;
     }
-    sf_str_append(&out, sf_lit("}"));
-    return out;
+    sol_sbappend(out, pretty ? sf_lit("{\n") : sf_lit("{ "));
+    sol_dobj_foreach(obj, _stringify_fe, &(_sol_stringify_args){out, pretty, commas, id});
+
+    if (pretty && id)
+        sol_sbappendc(out, ' ', (size_t)(id-1) * 2);
+    sol_sbappend(out, sf_lit("}"));
 }
 static void _stringify_fe(void *u, sf_str key, sol_val val) {
     _sol_stringify_args *args = u;
-    if (args->pretty && args->id) {
-        size_t s = sizeof(char) * args->id * 2;
-        char *id = malloc(s + 1);
-        memset(id, ' ', sizeof(char) * args->id * 2);
-        sf_str_append(args->out, sf_ref(id));
-        free(id);
-    }
-    sf_str_append(args->out, key);
-    sf_str_append(args->out, sf_lit(" = "));
-    switch (val.tt) {
-        case SOL_TDYN: if (sol_isdtype(val, SOL_DOBJ)) {
-            sf_str_append(args->out, _stringify(val.dyn, args->pretty, args->commas, args->id + 1));
-            break;
-        }
-        default: sf_str_append(args->out, sol_tostring(val)); break;
-    }
+    if (args->pretty && args->id)
+        sol_sbappendc(args->out, ' ', (size_t)args->id * 2);
+    sol_sbappend(args->out, key);
+    sol_sbappend(args->out, sf_lit(" = "));
+    if (sol_isdtype(val, SOL_DOBJ))
+        _stringify(args->out, val.dyn, args->pretty, args->commas, args->id + 1);
+    else sol_sbappendv(args->out, val);
+
     sf_str ec = sf_lit(" ");
     if (args->pretty && args->commas)
         ec = sf_lit(",\n");
@@ -363,7 +404,7 @@ static void _stringify_fe(void *u, sf_str key, sol_val val) {
         ec = sf_lit(",");
     else if (args->pretty)
         ec = sf_lit("\n");
-    sf_str_append(args->out, ec);
+    sol_sbappend(args->out, ec);
 }
 static sol_call_ex obj_stringify(sol_state *s) {
     sol_val obj = sol_get(s, 0);
@@ -371,12 +412,64 @@ static sol_call_ex obj_stringify(sol_state *s) {
     sol_val pretty = sol_get(s, 1);
     sol_val commas = sol_get(s, 2);
 
-    return sol_call_ex_ok(sol_dnstr(s, _stringify(
-        obj.dyn,
+    sol_strbuf out = SOL_STRBUF_EMPTY;
+    _stringify(&out, obj.dyn,
         pretty.tt == SOL_TBOOL ? pretty.boolean : true,
         commas.tt == SOL_TBOOL ? commas.boolean : false,
         1
-    )));
+    );
+    return sol_call_ex_ok(sol_dnstr(s, sol_sbfinish(&out)));
+}
+
+static void strbuf_del(void *ptr) { sol_sbfree(ptr); }
+static sf_str strbuf_tostring(void *ptr) {
+    sol_strbuf *sb = ptr;
+    return sf_str_fmt("strbuf(%zu)", sb->len);
+}
+#define expect_strbuf(val) do { \
+    if (!sol_isdtype(val, SOL_DUSR) || !sol_isutype(val, sf_lit("strbuf"))) \
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "'%s' expected strbuf, found %s", #val, sol_typename(val).c_str); \
+} while (0);
+
+static sol_call_ex strbuf_new(sol_state *s) {
+    sol_val cap = sol_get(s, 0);
+    sol_val sb = sol_dnewusr(s, sizeof(sol_strbuf), sf_lit("strbuf"), NULL, strbuf_del, strbuf_tostring);
+    if (sb.tt == SOL_TNIL)
+        return sol_serr(SOL_ERRV_PANIC, "Failed to allocate strbuf");
+    if (cap.tt == SOL_TI64 && cap.i64 > 0)
+        sol_sbreserve(sol_uptr(sb), (size_t)cap.i64);
+    sol_dusrsize(s, sb, ((sol_strbuf *)sol_uptr(sb))->cap);
+    return sol_call_ex_ok(sb);
+}
+static sol_call_ex strbuf_append(sol_state *s) {
+    sol_val sb = sol_get(s, 0);
+    expect_strbuf(sb);
+    if (!sol_sbappendv(sol_uptr(sb), sol_get(s, 1)))
+        return sol_serr(SOL_ERRV_PANIC, "Failed to grow strbuf");
+    sol_dusrsize(s, sb, ((sol_strbuf *)sol_uptr(sb))->cap);
+    return sol_call_ex_ok(sb);
+}
+static sol_call_ex strbuf_reserve(sol_state *s) {
+    sol_val sb = sol_get(s, 0);
+    expect_strbuf(sb);
+    sol_val n = sol_get(s, 1);
+    expect_type(SOL_TI64, n);
+    if (n.i64 > 0 && !sol_sbreserve(sol_uptr(sb), (size_t)n.i64))
+        return sol_serr(SOL_ERRV_PANIC, "Failed to grow strbuf");
+    sol_dusrsize(s, sb, ((sol_strbuf *)sol_uptr(sb))->cap);
+    return sol_call_ex_ok(sb);
+}
+static sol_call_ex strbuf_len(sol_state *s) {
+    sol_val sb = sol_get(s, 0);
+    expect_strbuf(sb);
+    return sol_call_ex_ok((sol_val){SOL_TI64, .i64 = (sol_i64)((sol_strbuf *)sol_uptr(sb))->len});
+}
+/// Hands the buffer to a new str and empties the builder
+static sol_call_ex strbuf_build(sol_state *s) {
+    sol_val sb = sol_get(s, 0);
+    expect_strbuf(sb);
+    sol_dusrsize(s, sb, 0); // The str owns the buffer now
+    return sol_call_ex_ok(sol_dnstr(s, sol_sbfinish(sol_uptr(sb))));
 }
 
 static sol_call_ex math_mini(sol_state *s) {
@@ -445,6 +538,212 @@ static sol_call_ex gc_collect(sol_state *s) {
     return sol_call_ex_ok(SOL_NIL);
 }
 
+static sol_call_ex array_push(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_dtype(SOL_DARRAY, arr);
+    expect_mutable(arr);
+    sol_valvec_push(arr.dyn, sol_get(s, 1));
+    return sol_call_ex_ok(arr);
+}
+
+static sol_call_ex array_pop(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_dtype(SOL_DARRAY, arr);
+    expect_mutable(arr);
+    if (((sol_valvec *)arr.dyn)->count == 0)
+        return sol_serr(SOL_ERRV_OOB_ACCESS, "Can't pop from an empty array");
+    return sol_call_ex_ok(sol_valvec_pop(arr.dyn));
+}
+
+static sol_call_ex array_len(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_dtype(SOL_DARRAY, arr);
+    return sol_call_ex_ok((sol_val){.tt = SOL_TI64, .i64 = ((sol_valvec *)arr.dyn)->count});
+}
+
+#define expect_typed(val, ta) \
+    sol_tarray *ta = sol_taof(val); \
+    if (!ta) \
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "'%s' expected typed array, found %s", #val, sol_typename(val).c_str);
+
+static sol_call_ex typed_new(sol_state *s, sol_tatype tt) {
+    sol_val count = sol_get(s, 0);
+    expect_type(SOL_TI64, count);
+    if (count.i64 < 0 || count.i64 > UINT32_MAX)
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Invalid typed array length %lld", count.i64);
+    sol_val ta = sol_tanew(s, tt, (uint32_t)count.i64);
+    if (ta.tt == SOL_TNIL)
+        return sol_serr(SOL_ERRV_PANIC, "Failed to allocate typed array");
+    return sol_call_ex_ok(ta);
+}
+static sol_call_ex typed_f64(sol_state *s) { return typed_new(s, SOL_TA_F64); }
+static sol_call_ex typed_i64(sol_state *s) { return typed_new(s, SOL_TA_I64); }
+static sol_call_ex typed_u8(sol_state *s) { return typed_new(s, SOL_TA_U8); }
+
+static sol_call_ex typed_len(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    return sol_call_ex_ok((sol_val){SOL_TI64, .i64 = ta->count});
+}
+static sol_call_ex typed_fill(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    sol_val val = sol_get(s, 1);
+    if (!sol_tafill(ta, val))
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "Can't fill %s with %s", sol_typename(arr).c_str, sol_typename(val).c_str);
+    return sol_call_ex_ok(arr);
+}
+static sol_call_ex typed_sum(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    return sol_call_ex_ok(sol_tasum(ta));
+}
+static sol_call_ex typed_min(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    return sol_call_ex_ok(sol_tamin(ta));
+}
+static sol_call_ex typed_max(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    return sol_call_ex_ok(sol_tamax(ta));
+}
+static sol_call_ex typed_scale(sol_state *s) {
+    sol_val arr = sol_get(s, 0);
+    expect_typed(arr, ta);
+    sol_val k = sol_get(s, 1);
+    if (!sol_tascale(ta, k))
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "Can't scale %s by %s", sol_typename(arr).c_str, sol_typename(k).c_str);
+    return sol_call_ex_ok(arr);
+}
+static sol_call_ex typed_dot(sol_state *s) {
+    sol_val a = sol_get(s, 0);
+    expect_typed(a, ta);
+    sol_val b = sol_get(s, 1);
+    expect_typed(b, tb);
+    if (ta->tt != tb->tt || ta->count != tb->count)
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "Can't dot %s(%u) with %s(%u)",
+            sol_typename(a).c_str, ta->count, sol_typename(b).c_str, tb->count);
+    return sol_call_ex_ok(sol_tadot(ta, tb));
+}
+static sol_call_ex typed_add(sol_state *s) {
+    sol_val a = sol_get(s, 0);
+    expect_typed(a, ta);
+    sol_val b = sol_get(s, 1);
+    expect_typed(b, tb);
+    if (ta->tt != tb->tt || ta->count != tb->count)
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "Can't add %s(%u) to %s(%u)",
+            sol_typename(b).c_str, tb->count, sol_typename(a).c_str, ta->count);
+    sol_taadd(ta, tb);
+    return sol_call_ex_ok(a);
+}
+
+#define expect_bytes(val, b) \
+    sol_bytes *b = sol_byof(val); \
+    if (!b) \
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "'%s' expected bytes, found %s", #val, sol_typename(val).c_str);
+#define expect_bytekind(val, kind) \
+    expect_dtype(SOL_DSTR, val); \
+    sol_bytekind kind; \
+    if (!sol_bykind(*(sf_str *)val.dyn, &kind)) \
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "Unknown byte kind '%s'", sol_dcstr(val).c_str);
+
+static sol_call_ex bytes_new(sol_state *s) {
+    sol_val len = sol_get(s, 0);
+    expect_type(SOL_TI64, len);
+    if (len.i64 < 0)
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Invalid bytes length %lld", len.i64);
+    sol_val b = sol_bynew(s, NULL, (size_t)len.i64);
+    if (b.tt == SOL_TNIL)
+        return sol_serr(SOL_ERRV_PANIC, "Failed to allocate bytes");
+    return sol_call_ex_ok(b);
+}
+static sol_call_ex bytes_from(sol_state *s) {
+    sol_val str = sol_get(s, 0);
+    expect_dtype(SOL_DSTR, str);
+    sf_str cstr = *(sf_str *)str.dyn;
+    return sol_call_ex_ok(sol_bynew(s, cstr.c_str, cstr.len));
+}
+static sol_call_ex bytes_str(sol_state *s) {
+    sol_val bytes = sol_get(s, 0);
+    expect_bytes(bytes, b);
+    char *buf = malloc(b->len + 1);
+    memcpy(buf, b->data, b->len);
+    buf[b->len] = '\0';
+    sf_str str = sf_own(buf);
+    str.len = b->len; // Binary data can hold zeroes
+    return sol_call_ex_ok(sol_dnstr(s, str));
+}
+static sol_call_ex bytes_len(sol_state *s) {
+    sol_val bytes = sol_get(s, 0);
+    expect_bytes(bytes, b);
+    return sol_call_ex_ok((sol_val){SOL_TI64, .i64 = (sol_i64)b->len});
+}
+static sol_call_ex bytes_slice(sol_state *s) {
+    sol_val bytes = sol_get(s, 0);
+    expect_bytes(bytes, b);
+    sol_val start = sol_get(s, 1);
+    expect_type(SOL_TI64, start);
+    sol_val len = sol_get(s, 2);
+    expect_type(SOL_TI64, len);
+    if (start.i64 < 0 || len.i64 < 0 || (uint64_t)start.i64 > b->len || (uint64_t)len.i64 > b->len - (uint64_t)start.i64)
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Slice [%lld, +%lld) is out of bounds for bytes(%zu)", start.i64, len.i64, b->len);
+    // Slices share the bytes they were cut from, writes through either are visible in both
+    return sol_call_ex_ok(sol_byslice(s, bytes, (size_t)start.i64, (size_t)len.i64));
+}
+static sol_call_ex bytes_copy(sol_state *s) {
+    sol_val dst = sol_get(s, 0);
+    expect_bytes(dst, d);
+    sol_val off = sol_get(s, 1);
+    expect_type(SOL_TI64, off);
+    sol_val src = sol_get(s, 2);
+    expect_bytes(src, b);
+    if (off.i64 < 0 || (uint64_t)off.i64 > d->len || b->len > d->len - (uint64_t)off.i64)
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Copying bytes(%zu) to %lld overflows bytes(%zu)", b->len, off.i64, d->len);
+    memmove(d->data + off.i64, b->data, b->len);
+    return sol_call_ex_ok(dst);
+}
+static sol_call_ex bytes_get(sol_state *s) {
+    sol_val bytes = sol_get(s, 0);
+    expect_bytes(bytes, b);
+    sol_val off = sol_get(s, 1);
+    expect_type(SOL_TI64, off);
+    sol_val kname = sol_get(s, 2);
+    expect_bytekind(kname, kind);
+    sol_val out;
+    if (off.i64 < 0 || !sol_byget(b, (size_t)off.i64, kind, &out))
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Reading %zu bytes at %lld overflows bytes(%zu)", sol_bysize(kind), off.i64, b->len);
+    return sol_call_ex_ok(out);
+}
+static sol_call_ex bytes_set(sol_state *s) {
+    sol_val bytes = sol_get(s, 0);
+    expect_bytes(bytes, b);
+    sol_val off = sol_get(s, 1);
+    expect_type(SOL_TI64, off);
+    sol_val kname = sol_get(s, 2);
+    expect_bytekind(kname, kind);
+    sol_val val = sol_get(s, 3);
+    if (val.tt != SOL_TI64 && val.tt != SOL_TF64)
+        return sol_serrf(SOL_ERRV_TYPE_MISMATCH, "'val' expected a number, found %s", sol_typename(val).c_str);
+    if (off.i64 < 0 || !sol_byset(b, (size_t)off.i64, kind, val))
+        return sol_serrf(SOL_ERRV_OOB_ACCESS, "Writing %zu bytes at %lld overflows bytes(%zu)", sol_bysize(kind), off.i64, b->len);
+    return sol_call_ex_ok(SOL_NIL);
+}
+
+static sol_call_ex gc_weak(sol_state *s) {
+    return sol_call_ex_ok(sol_dnweak(s, sol_get(s, 0)));
+}
+
+static sol_call_ex gc_deref(sol_state *s) {
+    sol_val weak = sol_get(s, 0);
+    expect_dtype(SOL_DWEAK, weak);
+    return sol_call_ex_ok(sol_dderef(weak));
+}
+
+static sol_call_ex gc_weakobj(sol_state *s) {
+    return sol_call_ex_ok(sol_dnwobj(s));
+}
+
 void sol_usestd(sol_state *state) {
     sol_val sol = sol_dnew(state, SOL_DOBJ);
     sol_dobj_set(sol.dyn, sf_lit("version"), sol_dnstr(state, sf_str_cdup(SOL_VERSION)));
@@ -455,7 +754,9 @@ void sol_usestd(sol_state *state) {
     sol_dobj_set(io.dyn, sf_lit("println"), sol_wrapcfun(state, io_println, 1, 0));
     sol_dobj_set(io.dyn, sf_lit("time"), sol_wrapcfun(state, io_time, 0, 0));
     sol_dobj_set(io.dyn, sf_lit("fread"), sol_wrapcfun(state, io_fread, 1, 0));
+    sol_dobj_set(io.dyn, sf_lit("freadb"), sol_wrapcfun(state, io_freadb, 1, 0));
     sol_dobj_set(io.dyn, sf_lit("fwrite"), sol_wrapcfun(state, io_fwrite, 2, 0));
+    sol_dobj_set(io.dyn, sf_lit("fremove"), sol_wrapcfun(state, io_fremove, 1, 0));
 
     sol_val string = sol_dnew(state, SOL_DOBJ);
     sol_dobj_set(string.dyn, sf_lit("sub"), sol_wrapcfun(state, string_sub, 3, 0));
@@ -467,6 +768,18 @@ void sol_usestd(sol_state *state) {
     sol_dobj_set(obj.dyn, sf_lit("get"), sol_wrapcfun(state, obj_get, 2, 0));
     sol_dobj_set(obj.dyn, sf_lit("stringify"), sol_wrapcfun(state, obj_stringify, 3, 0));
 
+    sol_val strbuf = sol_dnew(state, SOL_DOBJ);
+    sol_dobj_set(strbuf.dyn, sf_lit("new"), sol_wrapcfun(state, strbuf_new, 1, 0));
+    sol_dobj_set(strbuf.dyn, sf_lit("append"), sol_wrapcfun(state, strbuf_append, 2, 0));
+    sol_dobj_set(strbuf.dyn, sf_lit("reserve"), sol_wrapcfun(state, strbuf_reserve, 2, 0));
+    sol_dobj_set(strbuf.dyn, sf_lit("len"), sol_wrapcfun(state, strbuf_len, 1, 0));
+    sol_dobj_set(strbuf.dyn, sf_lit("build"), sol_wrapcfun(state, strbuf_build, 1, 0));
+
+    sol_val array = sol_dnew(state, SOL_DOBJ);
+    sol_dobj_set(array.dyn, sf_lit("push"), sol_wrapcfun(state, array_push, 2, 0));
+    sol_dobj_set(array.dyn, sf_lit("pop"), sol_wrapcfun(state, array_pop, 1, 0));
+    sol_dobj_set(array.dyn, sf_lit("len"), sol_wrapcfun(state, array_len, 1, 0));
+
     sol_val math = sol_dnew(state, SOL_DOBJ);
     sol_dobj_set(math.dyn, sf_lit("mini"), sol_wrapcfun(state, math_mini, 2, 0));
     sol_dobj_set(math.dyn, sf_lit("maxi"), sol_wrapcfun(state, math_maxi, 2, 0));
@@ -475,12 +788,39 @@ void sol_usestd(sol_state *state) {
     sol_dobj_set(math.dyn, sf_lit("randi"), sol_wrapcfun(state, math_randi, 2, 0));
     sol_dobj_set(math.dyn, sf_lit("randf"), sol_wrapcfun(state, math_randf, 2, 0));
 
+    sol_val typed = sol_dnew(state, SOL_DOBJ);
+    sol_dobj_set(typed.dyn, sf_lit("f64"), sol_wrapcfun(state, typed_f64, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("i64"), sol_wrapcfun(state, typed_i64, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("u8"), sol_wrapcfun(state, typed_u8, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("len"), sol_wrapcfun(state, typed_len, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("fill"), sol_wrapcfun(state, typed_fill, 2, 0));
+    sol_dobj_set(typed.dyn, sf_lit("sum"), sol_wrapcfun(state, typed_sum, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("min"), sol_wrapcfun(state, typed_min, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("max"), sol_wrapcfun(state, typed_max, 1, 0));
+    sol_dobj_set(typed.dyn, sf_lit("scale"), sol_wrapcfun(state, typed_scale, 2, 0));
+    sol_dobj_set(typed.dyn, sf_lit("dot"), sol_wrapcfun(state, typed_dot, 2, 0));
+    sol_dobj_set(typed.dyn, sf_lit("add"), sol_wrapcfun(state, typed_add, 2, 0));
+
+    sol_val bytes = sol_dnew(state, SOL_DOBJ);
+    sol_dobj_set(bytes.dyn, sf_lit("new"), sol_wrapcfun(state, bytes_new, 1, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("from"), sol_wrapcfun(state, bytes_from, 1, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("str"), sol_wrapcfun(state, bytes_str, 1, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("len"), sol_wrapcfun(state, bytes_len, 1, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("slice"), sol_wrapcfun(state, bytes_slice, 3, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("copy"), sol_wrapcfun(state, bytes_copy, 3, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("get"), sol_wrapcfun(state, bytes_get, 3, 0));
+    sol_dobj_set(bytes.dyn, sf_lit("set"), sol_wrapcfun(state, bytes_set, 4, 0));
+
     sol_val gc = sol_dnew(state, SOL_DOBJ);
     sol_dobj_set(gc.dyn, sf_lit("collect"), sol_wrapcfun(state, gc_collect, 0, 0));
+    sol_dobj_set(gc.dyn, sf_lit("weak"), sol_wrapcfun(state, gc_weak, 1, 0));
+    sol_dobj_set(gc.dyn, sf_lit("deref"), sol_wrapcfun(state, gc_deref, 1, 0));
+    sol_dobj_set(gc.dyn, sf_lit("weakobj"), sol_wrapcfun(state, gc_weakobj, 0, 0));
 
     sol_dobj *_g = state->global.dyn;
     sol_dobj_set(_g, sf_lit("import"), sol_wrapcfun(state, builtin_import, 1, 0));
     sol_dobj_set(_g, sf_lit("require"), sol_wrapcfun(state, builtin_require, 1, 0));
+    sol_dobj_set(_g, sf_lit("reload"), sol_wrapcfun(state, builtin_reload, 1, 0));
     sol_dobj_set(_g, sf_lit("eval"), sol_wrapcfun(state, builtin_eval, 1, 0));
     sol_dobj_set(_g, sf_lit("panic"), sol_wrapcfun(state, builtin_panic, 1, 0));
     sol_dobj_set(_g, sf_lit("catch"), sol_wrapcfun(state, builtin_catch, 1, 0));
@@ -489,6 +829,8 @@ void sol_usestd(sol_state *state) {
     sol_dobj_set(_g, sf_lit("unwrap_or"), sol_wrapcfun(state, builtin_unwrap_or, 2, 0));
     sol_dobj_set(_g, sf_lit("assert"), sol_wrapcfun(state, builtin_assert, 1, 0));
     sol_dobj_set(_g, sf_lit("type"), sol_wrapcfun(state, builtin_type, 1, 0));
+    sol_dobj_set(_g, sf_lit("freeze"), sol_wrapcfun(state, builtin_freeze, 1, 0));
+    sol_dobj_set(_g, sf_lit("frozen"), sol_wrapcfun(state, builtin_frozen, 1, 0));
 
     sol_dobj_set(_g, sf_lit("str"), sol_wrapcfun(state, builtin_str, 1, 0));
     sol_dobj_set(_g, sf_lit("err"), sol_wrapcfun(state, builtin_err, 1, 0));
@@ -498,9 +840,14 @@ void sol_usestd(sol_state *state) {
 
     sol_dobj_set(_g, sf_lit("sol"), sol);
     sol_dobj_set(_g, sf_lit("io"), io);
-    sol_dobj_set(_g, sf_lit("string"), sol);
+    sol_dobj_set(_g, sf_lit("string"), string);
     sol_dobj_set(_g, sf_lit("obj"), obj);
+    sol_dobj_set(_g, sf_lit("array"), array);
+    sol_dobj_set(_g, sf_lit("strbuf"), strbuf);
     sol_dobj_set(_g, sf_lit("math"), math);
+    sol_dobj_set(_g, sf_lit("typed"), typed);
+    sol_dobj_set(_g, sf_lit("bytes"), bytes);
+    sol_dobj_set(_g, sf_lit("gc"), gc);
 
     srand((unsigned)time(NULL));
 }
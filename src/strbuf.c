@@ -0,0 +1,59 @@
+#include "sol/strbuf.h"
+#include "sol/vm.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool sol_sbreserve(sol_strbuf *sb, size_t extra) {
+    if (extra > SIZE_MAX - sb->len - 1) return false;
+    size_t need = sb->len + extra + 1;
+    if (need <= sb->cap) return true;
+    size_t cap = sb->cap ? sb->cap : 32;
+    while (cap < need)
+        cap = cap > SIZE_MAX / 2 ? need : cap * 2;
+    char *data = realloc(sb->data, cap);
+    if (!data) return false;
+    if (!sb->data) data[0] = '\0';
+    sb->data = data;
+    sb->cap = cap;
+    return true;
+}
+
+bool sol_sbappend(sol_strbuf *sb, sf_str str) {
+    if (str.len == 0) return true;
+    if (!sol_sbreserve(sb, str.len)) return false;
+    memcpy(sb->data + sb->len, str.c_str, str.len);
+    sb->len += str.len;
+    sb->data[sb->len] = '\0';
+    return true;
+}
+
+bool sol_sbappendc(sol_strbuf *sb, char c, size_t n) {
+    if (n == 0) return true;
+    if (!sol_sbreserve(sb, n)) return false;
+    memset(sb->data + sb->len, c, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+    return true;
+}
+
+bool sol_sbappendv(sol_strbuf *sb, sol_val val) {
+    val = sol_dval(val);
+    if (sol_isdtype(val, SOL_DSTR) || sol_isdtype(val, SOL_DERR))
+        return sol_sbappend(sb, *(sf_str *)val.dyn);
+    sf_str str = sol_tostring(val);
+    bool ok = sol_sbappend(sb, str);
+    sf_str_free(str);
+    return ok;
+}
+
+sf_str sol_sbfinish(sol_strbuf *sb) {
+    if (!sb->data) return sf_str_cdup("");
+    sf_str str = {.c_str = sb->data, .len = sb->len, .owned = true}; // len already counts embedded NULs
+    *sb = SOL_STRBUF_EMPTY;
+    return str;
+}
+
+void sol_sbfree(sol_strbuf *sb) {
+    free(sb->data);
+    *sb = SOL_STRBUF_EMPTY;
+}
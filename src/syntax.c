@@ -14,27 +14,14 @@ typedef struct {
     sol_token current;
     size_t cc;
     sol_keywords keywords;
-    sol_dalloc *alloc;
+    sol_valvec statics;
 } sol_scanner;
 
 static sol_val sol_scan_str(sol_scanner *s, const sf_str str) {
-    sol_dyn p = calloc(1, sizeof(sol_dalloc) + sizeof(sf_str));
-    sol_dalloc *dh = p;
-    *dh = (sol_dalloc){
-        .next = NULL,
-        .size = sizeof(sf_str),
-        .tt = SOL_DSTR,
-        .mark = SOL_DYN_WHITE,
-    };
-    p = (char *)p + sizeof(sol_dalloc);
-    *(sf_str *)p = sf_str_dup(str);
-    sol_dalloc *dd = s->alloc;
-    if (dd == NULL) s->alloc = dh;
-    else {
-        while (dd->next) dd = dd->next;
-        dd->next = dh;
-    }
-    return (sol_val){ .tt = SOL_TDYN, .dyn = p };
+    sol_val v = sol_dnstatic(SOL_DSTR);
+    *(sf_str *)v.dyn = sf_str_dup(str);
+    sol_valvec_push(&s->statics, v);
+    return v;
 }
 
 #define sol_scancase(_c, _tt) case _c: s.current.tt = _tt; break
@@ -157,7 +144,7 @@ sol_token sol_scanidentifier(sol_scanner *s) {
             value = SOL_FALSE;
         if (ex.ok == TK_OPCODE) {
             for (sol_opcode o = 0; o < SOL_OP_COUNT; ++o)
-                value = sf_str_eq(sf_lit(sol_op_info(o)->mnemonic), sf_ref(str)) ?
+                value = sf_str_eq(sf_ref(sol_op_info(o)->mnemonic), sf_ref(str)) ?
                     (sol_val){.tt = SOL_TI64, .i64 = o} : value;
         }
         free(str);
@@ -186,6 +173,7 @@ sol_scan_ex sol_scan(sf_str src) {
         .current = {TK_EOF, SOL_NIL, 1, 1},
         .cc = 0,
         .keywords = sol_keywords_new(),
+        .statics = sol_valvec_new(),
     };
     sol_error eval = SOL_ERRP_UNEXPECTED_TOKEN;
 
@@ -203,6 +191,7 @@ sol_scan_ex sol_scan(sf_str src) {
     sol_keywords_set(&s.keywords, sf_lit("let"), TK_LET);
     sol_keywords_set(&s.keywords, sf_lit("for"), TK_FOR);
     sol_keywords_set(&s.keywords, sf_lit("while"), TK_WHILE);
+    sol_keywords_set(&s.keywords, sf_lit("in"), TK_IN);
     sol_keywords_set(&s.keywords, sf_lit("true"), TK_TRUE);
     sol_keywords_set(&s.keywords, sf_lit("false"), TK_FALSE);
 
@@ -281,6 +270,9 @@ sol_scan_ex sol_scan(sf_str src) {
             err: {
                 sol_tokenvec_free(&tks);
                 sol_keywords_free(&s.keywords);
+                for (sol_val *v = s.statics.data; v && v < s.statics.data + s.statics.count; ++v)
+                    sol_dclean(*v);
+                sol_valvec_free(&s.statics);
                 size_t tk_len = s.cc - pcc + 1;
                 for (size_t cc2 = s.cc; cc2 < s.src.len; ++cc2) {
                     char ws = s.src.c_str[cc2];
@@ -298,7 +290,7 @@ sol_scan_ex sol_scan(sf_str src) {
 
     sol_keywords_free(&s.keywords);
     sol_tokenvec_push(&tks, (sol_token){TK_EOF, SOL_NIL, s.current.line, s.current.column});
-    return sol_scan_ex_ok((sol_scan_ok){tks, s.alloc});
+    return sol_scan_ex_ok((sol_scan_ok){tks, s.statics});
 }
 
 typedef struct {
@@ -368,11 +360,24 @@ void sol_node_free(sol_node *tree) {
             sol_node_free(tree->n_while.condition);
             sol_node_free(tree->n_while.stmt);
             break;
+        case SOL_ND_FOR:
+            sol_node_free(tree->n_for.expr);
+            sol_node_free(tree->n_for.stmt);
+            break;
         case SOL_ND_OBJ:
             for (uint32_t i = 0; i < tree->n_obj.mem_c; ++i)
                 sol_node_free(tree->n_obj.members[i]);
             free(tree->n_obj.members);
             break;
+        case SOL_ND_ARRAY:
+            for (uint32_t i = 0; i < tree->n_array.elem_c; ++i)
+                sol_node_free(tree->n_array.elems[i]);
+            free(tree->n_array.elems);
+            break;
+        case SOL_ND_INDEX:
+            sol_node_free(tree->n_index.expr);
+            sol_node_free(tree->n_index.index);
+            break;
     }
     free(tree);
 }
@@ -394,6 +399,7 @@ size_t sol_precedence(sol_tokentype tt) {
 bool sol_niscondition(sol_node *node) {
     if (node->tt == SOL_ND_IDENTIFIER ||
         node->tt == SOL_ND_CALL ||
+        node->tt == SOL_ND_INDEX ||
         (node->tt == SOL_ND_UNARY && node->n_unary.op == TK_BANG) ||
        (node->tt == SOL_ND_LITERAL && node->n_literal.tt == SOL_TBOOL))
         return true;
@@ -428,7 +434,9 @@ sol_parse_ex sol_pfun(sol_parser *p);
 sol_parse_ex sol_pasm(sol_parser *p);
 sol_parse_ex sol_pins(sol_parser *p);
 sol_parse_ex sol_pobj(sol_parser *p);
+sol_parse_ex sol_parray(sol_parser *p);
 sol_parse_ex sol_pwhile(sol_parser *p);
+sol_parse_ex sol_pfor(sol_parser *p);
 sol_parse_ex sol_preturn(sol_parser *p);
 sol_parse_ex sol_pstmt(sol_parser *p);
 
@@ -455,7 +463,16 @@ sol_parse_ex sol_pprimary(sol_parser *p) {
         case TK_BANG:
         case TK_MINUS:
             return sol_punary(p);
-        case TK_LEFT_BRACKET: return sol_pfun(p);
+        case TK_LEFT_BRACKET: { // [captures](args) is a fun, anything else is an array
+            sol_token *t = p->tok + 1;
+            for (uint32_t depth = 1; t->tt != TK_EOF; ++t) {
+                if (t->tt == TK_LEFT_BRACKET) ++depth;
+                else if (t->tt == TK_RIGHT_BRACKET && --depth == 0) break;
+            }
+            if (t->tt == TK_RIGHT_BRACKET && (t + 1)->tt == TK_LEFT_PAREN)
+                return sol_pfun(p);
+            return sol_parray(p);
+        }
         case TK_ASM: return sol_pasm(p);
         case TK_LEFT_BRACE: return sol_pobj(p);
         case TK_IDENTIFIER: {
@@ -535,13 +552,13 @@ sol_parse_ex sol_pif(sol_parser *p) {
     sol_parse_ex cex = sol_pexpr(p, 0);
     if (!cex.is_ok) return cex;
     if (!sol_niscondition(cex.ok)) {
-        uint16_t line = cex.ok->line;
+        uint32_t line = cex.ok->line;
         uint16_t column = cex.ok->column;
         sol_node_free(cex.ok);
         return sol_parse_ex_err((sol_parse_err){SOL_ERRP_EXPECTED_CONDITION, line, column});
     }
     if (p->tok->tt != TK_COLON) {
-        uint16_t line = cex.ok->line;
+        uint32_t line = cex.ok->line;
         uint16_t column = cex.ok->column;
         sol_node_free(cex.ok);
         return sol_parse_ex_err((sol_parse_err){SOL_ERRP_EXPECTED_COLON, line, column});
@@ -558,7 +575,7 @@ sol_parse_ex sol_pif(sol_parser *p) {
     if (p->tok->tt == TK_ELSE) {
         ++p->tok;
         if (p->tok->tt != TK_COLON) {
-            uint16_t line = (p->tok-1)->line;
+            uint32_t line = (p->tok-1)->line;
             uint16_t column = (p->tok-1)->column;
             sol_node_free(cex.ok);
             sol_node_free(eex.ok);
@@ -625,7 +642,8 @@ sol_parse_ex sol_plet(sol_parser *p) {
 }
 
 sol_parse_ex sol_ppostfix(sol_parser *p) {
-    uint16_t line = p->tok->line, column = p->tok->column;
+    uint32_t line = p->tok->line;
+    uint16_t column = p->tok->column;
     sol_parse_ex ex = sol_pprimary(p);
     if (!ex.is_ok) return ex;
     sol_node *node = ex.ok;
@@ -665,6 +683,35 @@ sol_parse_ex sol_ppostfix(sol_parser *p) {
             continue;
         }
 
+        // Only index on the same line, so a fun on the next line isn't taken as an index
+        if (p->tok->tt == TK_LEFT_BRACKET && p->tok->line == (p->tok - 1)->line) {
+            ++p->tok;
+            sol_parse_ex iex = sol_pexpr(p, 0);
+            if (!iex.is_ok) {
+                sol_node_free(node);
+                return iex;
+            }
+            if (p->tok->tt != TK_RIGHT_BRACKET) {
+                sol_node_free(node);
+                sol_node_free(iex.ok);
+                return sol_perr(SOL_ERRP_EXPECTED_RBRACKET);
+            }
+            ++p->tok;
+
+            sol_node *index = malloc(sizeof(sol_node));
+            *index = (sol_node){
+                .tt = SOL_ND_INDEX,
+                .line = line,
+                .column = column,
+                .n_index = {
+                    .expr = node,
+                    .index = iex.ok,
+                }
+            };
+            node = index;
+            continue;
+        }
+
         if (p->tok->tt == TK_PERIOD) {
             ++p->tok;
             if (p->tok->tt != TK_IDENTIFIER)
@@ -711,7 +758,8 @@ sol_parse_ex sol_pblock(sol_parser *p) {
         if (sex.ok->tt == SOL_ND_RETURN && p->tok->tt != TK_RIGHT_BRACE && p->tok->tt != TK_EOF) {
             sol_node_free(n_block);
             sol_error e = sex.ok->n_return.implicit ? SOL_ERRP_UNEXPECTED_IMPL_RETURN : SOL_ERRP_UNREACHABLE_CODE;
-            uint16_t line = sex.ok->line, column = sex.ok->column;
+            uint32_t line = sex.ok->line;
+            uint16_t column = sex.ok->column;
             if (p->tok->tt == TK_SEMICOLON) {
                 line = p->tok->line; column = p->tok->column;
                 e = SOL_ERRP_UNEXPECTED_SEMICOLON;
@@ -918,6 +966,37 @@ sol_parse_ex sol_pobj(sol_parser *p) {
     return sol_parse_ex_ok(n_obj);
 }
 
+sol_parse_ex sol_parray(sol_parser *p) {
+    sol_node *n_array = malloc(sizeof(sol_node));
+    *n_array = (sol_node){
+        .tt = SOL_ND_ARRAY,
+        .line = p->tok->line, .column = p->tok->column,
+        .n_array = {
+            .elems = NULL,
+            .elem_c = 0,
+        },
+    };
+    ++p->tok; // [
+
+    while (p->tok->tt != TK_RIGHT_BRACKET && p->tok->tt != TK_EOF) {
+        sol_parse_ex elem = sol_pexpr(p, 0);
+        if (!elem.is_ok) {
+            sol_node_free(n_array);
+            return elem;
+        }
+        n_array->n_array.elems = realloc(n_array->n_array.elems, ++n_array->n_array.elem_c * sizeof(sol_node *));
+        n_array->n_array.elems[n_array->n_array.elem_c - 1] = elem.ok;
+        if (p->tok->tt == TK_COMMA) ++p->tok;
+        else break;
+    }
+    if (p->tok->tt != TK_RIGHT_BRACKET) {
+        sol_node_free(n_array);
+        return sol_perr(SOL_ERRP_EXPECTED_RBRACKET);
+    }
+    ++p->tok; // ]
+    return sol_parse_ex_ok(n_array);
+}
+
 sol_parse_ex sol_pwhile(sol_parser *p) {
     ++p->tok;
 
@@ -925,13 +1004,13 @@ sol_parse_ex sol_pwhile(sol_parser *p) {
     if (!cond.is_ok)
         return cond;
     if (!sol_niscondition(cond.ok)) {
-        uint16_t line = cond.ok->line;
+        uint32_t line = cond.ok->line;
         uint16_t column = cond.ok->column;
         sol_node_free(cond.ok);
         return sol_parse_ex_err((sol_parse_err){SOL_ERRP_EXPECTED_CONDITION, line, column});
     }
     if (p->tok->tt != TK_COLON) {
-        uint16_t line = cond.ok->line;
+        uint32_t line = cond.ok->line;
         uint16_t column = cond.ok->column;
         sol_node_free(cond.ok);
         return sol_parse_ex_err((sol_parse_err){SOL_ERRP_EXPECTED_COLON, line, column});
@@ -957,8 +1036,55 @@ sol_parse_ex sol_pwhile(sol_parser *p) {
     return sol_parse_ex_ok(n_while);
 }
 
+sol_parse_ex sol_pfor(sol_parser *p) {
+    sol_token *kw = p->tok++;
+
+    if (p->tok->tt != TK_IDENTIFIER)
+        return sol_perr(SOL_ERRP_EXPECTED_IDENTIFIER);
+    sol_val key = (p->tok++)->value, val = SOL_NIL;
+    if (p->tok->tt == TK_COMMA) {
+        ++p->tok;
+        if (p->tok->tt != TK_IDENTIFIER)
+            return sol_perr(SOL_ERRP_EXPECTED_IDENTIFIER);
+        val = (p->tok++)->value;
+    }
+    if (p->tok->tt != TK_IN)
+        return sol_perr(SOL_ERRP_EXPECTED_IN);
+    ++p->tok;
+
+    sol_parse_ex expr = sol_pexpr(p, 0);
+    if (!expr.is_ok)
+        return expr;
+    if (p->tok->tt != TK_COLON) {
+        uint32_t line = expr.ok->line;
+        uint16_t column = expr.ok->column;
+        sol_node_free(expr.ok);
+        return sol_parse_ex_err((sol_parse_err){SOL_ERRP_EXPECTED_COLON, line, column});
+    }
+    ++p->tok;
+
+    sol_parse_ex stmt = p->tok->tt == TK_LEFT_BRACE ? sol_pblock(p) : sol_pstmt(p);
+    if (!stmt.is_ok) {
+        sol_node_free(expr.ok);
+        return stmt;
+    }
+
+    sol_node *n_for = malloc(sizeof(sol_node));
+    *n_for = (sol_node){
+        .tt = SOL_ND_FOR,
+        .line = kw->line, .column = kw->column,
+        .n_for = {
+            .key = key, .val = val,
+            .expr = expr.ok,
+            .stmt = stmt.ok,
+        },
+    };
+    return sol_parse_ex_ok(n_for);
+}
+
 sol_parse_ex sol_preturn(sol_parser *p) {
-    uint16_t line = p->tok->line, column = p->tok->column;
+    uint32_t line = p->tok->line;
+    uint16_t column = p->tok->column;
     ++p->tok;
     sol_parse_ex expr = sol_pexpr(p, 0);
     if (!expr.is_ok) return expr;
@@ -991,6 +1117,7 @@ sol_parse_ex sol_pstmt(sol_parser *p) {
         case TK_IF: return sol_pif(p);
         case TK_LET: return sol_plet(p);
         case TK_WHILE: return sol_pwhile(p);
+        case TK_FOR: return sol_pfor(p);
         case TK_RETURN: return sol_preturn(p);
 
         case TK_DO: ++p->tok;
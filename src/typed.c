@@ -0,0 +1,435 @@
+#include "sol/typed.h"
+#include "sol/vm.h"
+#include <string.h>
+
+// Vector paths are picked at compile time, build with -mavx2 (or /arch:AVX2) to get the wide ones.
+// Every kernel finishes with a scalar loop, which also covers the tail of the vector loop
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SOL_TA_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOL_TA_SSE2
+#endif
+
+const char *SOL_TA_NAMES[SOL_TA_COUNT] = {
+    "f64array",
+    "i64array",
+    "u8array",
+};
+static const size_t SOL_TA_SIZES[SOL_TA_COUNT] = {sizeof(sol_f64), sizeof(sol_i64), sizeof(uint8_t)};
+
+#define F64(ta) ((sol_f64 *)(ta)->data)
+#define I64(ta) ((sol_i64 *)(ta)->data)
+#define U8(ta) ((uint8_t *)(ta)->data)
+
+static sf_str sol_tatostring(void *ptr) {
+    sol_tarray *ta = ptr;
+    return sf_str_fmt("%s(%u)", SOL_TA_NAMES[ta->tt], ta->count);
+}
+
+sol_val sol_tanew(sol_state *state, sol_tatype tt, uint32_t count) {
+    if ((uint64_t)count * SOL_TA_SIZES[tt] > (uint64_t)SIZE_MAX - sizeof(sol_tarray))
+        return SOL_NIL;
+    size_t size = sizeof(sol_tarray) + (size_t)count * SOL_TA_SIZES[tt];
+    sol_val usr = sol_dnewusr(state, size, sf_ref(SOL_TA_NAMES[tt]), NULL, NULL, sol_tatostring);
+    if (usr.tt == SOL_TNIL) return usr;
+    sol_tarray *ta = sol_uptr(usr);
+    ta->tt = tt;
+    ta->count = count;
+    return usr;
+}
+
+sol_tarray *sol_taof(sol_val val) {
+    if (!sol_isdtype(val, SOL_DUSR) || sol_uheader(val)->tostring != sol_tatostring)
+        return NULL;
+    return sol_uptr(val);
+}
+
+sol_val sol_taget(sol_tarray *ta, uint32_t i) {
+    switch (ta->tt) {
+        case SOL_TA_F64: return (sol_val){SOL_TF64, .f64 = F64(ta)[i]};
+        case SOL_TA_I64: return (sol_val){SOL_TI64, .i64 = I64(ta)[i]};
+        case SOL_TA_U8: return (sol_val){SOL_TI64, .i64 = U8(ta)[i]};
+        default: return SOL_NIL;
+    }
+}
+
+/// Converts a value to an element of ta. f64 arrays take either number,
+/// integer arrays only take i64 and u8 keeps the low byte
+static bool sol_taconv(sol_tarray *ta, sol_val val, sol_f64 *f, sol_i64 *i) {
+    if (ta->tt == SOL_TA_F64) {
+        if (val.tt == SOL_TF64) *f = val.f64;
+        else if (val.tt == SOL_TI64) *f = (sol_f64)val.i64;
+        else return false;
+        return true;
+    }
+    if (val.tt != SOL_TI64) return false;
+    *i = val.i64;
+    return true;
+}
+
+bool sol_taset(sol_tarray *ta, uint32_t i, sol_val val) {
+    sol_f64 f; sol_i64 n;
+    if (!sol_taconv(ta, val, &f, &n)) return false;
+    switch (ta->tt) {
+        case SOL_TA_F64: F64(ta)[i] = f; break;
+        case SOL_TA_I64: I64(ta)[i] = n; break;
+        case SOL_TA_U8: U8(ta)[i] = (uint8_t)n; break;
+        default: return false;
+    }
+    return true;
+}
+
+bool sol_tafill(sol_tarray *ta, sol_val val) {
+    sol_f64 f; sol_i64 n;
+    if (!sol_taconv(ta, val, &f, &n)) return false;
+    uint32_t i = 0, c = ta->count;
+    switch (ta->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *d = F64(ta);
+#if defined(SOL_TA_AVX2)
+            __m256d v = _mm256_set1_pd(f);
+            for (; i + 4 <= c; i += 4) _mm256_storeu_pd(d + i, v);
+#elif defined(SOL_TA_SSE2)
+            __m128d v = _mm_set1_pd(f);
+            for (; i + 2 <= c; i += 2) _mm_storeu_pd(d + i, v);
+#endif
+            for (; i < c; ++i) d[i] = f;
+            break;
+        }
+        case SOL_TA_I64: {
+            sol_i64 *d = I64(ta);
+#if defined(SOL_TA_AVX2)
+            __m256i v = _mm256_set1_epi64x(n);
+            for (; i + 4 <= c; i += 4) _mm256_storeu_si256((__m256i *)(d + i), v);
+#endif
+            for (; i < c; ++i) d[i] = n;
+            break;
+        }
+        case SOL_TA_U8: memset(ta->data, (uint8_t)n, c); break;
+        default: return false;
+    }
+    return true;
+}
+
+sol_val sol_tasum(sol_tarray *ta) {
+    uint32_t i = 0, c = ta->count;
+    switch (ta->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *d = F64(ta), sum = 0;
+#if defined(SOL_TA_AVX2)
+            __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+            for (; i + 8 <= c; i += 8) {
+                a0 = _mm256_add_pd(a0, _mm256_loadu_pd(d + i));
+                a1 = _mm256_add_pd(a1, _mm256_loadu_pd(d + i + 4));
+            }
+            double lanes[4];
+            _mm256_storeu_pd(lanes, _mm256_add_pd(a0, a1));
+            sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SOL_TA_SSE2)
+            __m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+            for (; i + 4 <= c; i += 4) {
+                a0 = _mm_add_pd(a0, _mm_loadu_pd(d + i));
+                a1 = _mm_add_pd(a1, _mm_loadu_pd(d + i + 2));
+            }
+            double lanes[2];
+            _mm_storeu_pd(lanes, _mm_add_pd(a0, a1));
+            sum = lanes[0] + lanes[1];
+#endif
+            for (; i < c; ++i) sum += d[i];
+            return (sol_val){SOL_TF64, .f64 = sum};
+        }
+        case SOL_TA_I64: {
+            sol_i64 *d = I64(ta);
+            uint64_t sum = 0;
+#if defined(SOL_TA_AVX2)
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 4 <= c; i += 4)
+                acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i *)(d + i)));
+            uint64_t lanes[4];
+            _mm256_storeu_si256((__m256i *)lanes, acc);
+            sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SOL_TA_SSE2)
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 2 <= c; i += 2)
+                acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i *)(d + i)));
+            uint64_t lanes[2];
+            _mm_storeu_si128((__m128i *)lanes, acc);
+            sum = lanes[0] + lanes[1];
+#endif
+            for (; i < c; ++i) sum += (uint64_t)d[i];
+            return (sol_val){SOL_TI64, .i64 = (sol_i64)sum};
+        }
+        case SOL_TA_U8: {
+            uint8_t *d = U8(ta);
+            uint64_t sum = 0;
+            // psadbw against zero sums each group of 8 bytes into a 64 bit lane
+#if defined(SOL_TA_AVX2)
+            __m256i acc = _mm256_setzero_si256(), zero = _mm256_setzero_si256();
+            for (; i + 32 <= c; i += 32)
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *)(d + i)), zero));
+            uint64_t lanes[4];
+            _mm256_storeu_si256((__m256i *)lanes, acc);
+            sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SOL_TA_SSE2)
+            __m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+            for (; i + 16 <= c; i += 16)
+                acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(d + i)), zero));
+            uint64_t lanes[2];
+            _mm_storeu_si128((__m128i *)lanes, acc);
+            sum = lanes[0] + lanes[1];
+#endif
+            for (; i < c; ++i) sum += d[i];
+            return (sol_val){SOL_TI64, .i64 = (sol_i64)sum};
+        }
+        default: return SOL_NIL;
+    }
+}
+
+/// Shared body of min and max, less picks which one
+static sol_val sol_taextreme(sol_tarray *ta, bool less) {
+    uint32_t i = 1, c = ta->count;
+    if (c == 0) return SOL_NIL;
+    switch (ta->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *d = F64(ta), m = d[0];
+            i = 0;
+#if defined(SOL_TA_AVX2)
+            if (c >= 4) {
+                __m256d acc = _mm256_loadu_pd(d);
+                for (i = 4; i + 4 <= c; i += 4) {
+                    __m256d v = _mm256_loadu_pd(d + i);
+                    acc = less ? _mm256_min_pd(acc, v) : _mm256_max_pd(acc, v);
+                }
+                double lanes[4];
+                _mm256_storeu_pd(lanes, acc);
+                for (int l = 0; l < 4; ++l)
+                    if (less ? lanes[l] < m : lanes[l] > m) m = lanes[l];
+            }
+#elif defined(SOL_TA_SSE2)
+            if (c >= 2) {
+                __m128d acc = _mm_loadu_pd(d);
+                for (i = 2; i + 2 <= c; i += 2) {
+                    __m128d v = _mm_loadu_pd(d + i);
+                    acc = less ? _mm_min_pd(acc, v) : _mm_max_pd(acc, v);
+                }
+                double lanes[2];
+                _mm_storeu_pd(lanes, acc);
+                for (int l = 0; l < 2; ++l)
+                    if (less ? lanes[l] < m : lanes[l] > m) m = lanes[l];
+            }
+#endif
+            for (; i < c; ++i)
+                if (less ? d[i] < m : d[i] > m) m = d[i];
+            return (sol_val){SOL_TF64, .f64 = m};
+        }
+        case SOL_TA_I64: {
+            sol_i64 *d = I64(ta), m = d[0];
+            i = 0;
+#if defined(SOL_TA_AVX2)
+            // No 64 bit min/max before AVX-512, so compare and blend
+            if (c >= 4) {
+                __m256i acc = _mm256_loadu_si256((const __m256i *)d);
+                for (i = 4; i + 4 <= c; i += 4) {
+                    __m256i v = _mm256_loadu_si256((const __m256i *)(d + i));
+                    __m256i gt = _mm256_cmpgt_epi64(acc, v);
+                    acc = less ? _mm256_blendv_epi8(acc, v, gt) : _mm256_blendv_epi8(v, acc, gt);
+                }
+                sol_i64 lanes[4];
+                _mm256_storeu_si256((__m256i *)lanes, acc);
+                for (int l = 0; l < 4; ++l)
+                    if (less ? lanes[l] < m : lanes[l] > m) m = lanes[l];
+            }
+#endif
+            for (; i < c; ++i)
+                if (less ? d[i] < m : d[i] > m) m = d[i];
+            return (sol_val){SOL_TI64, .i64 = m};
+        }
+        case SOL_TA_U8: {
+            uint8_t *d = U8(ta), m = d[0];
+            i = 0;
+#if defined(SOL_TA_AVX2)
+            if (c >= 32) {
+                __m256i acc = _mm256_loadu_si256((const __m256i *)d);
+                for (i = 32; i + 32 <= c; i += 32) {
+                    __m256i v = _mm256_loadu_si256((const __m256i *)(d + i));
+                    acc = less ? _mm256_min_epu8(acc, v) : _mm256_max_epu8(acc, v);
+                }
+                uint8_t lanes[32];
+                _mm256_storeu_si256((__m256i *)lanes, acc);
+                for (int l = 0; l < 32; ++l)
+                    if (less ? lanes[l] < m : lanes[l] > m) m = lanes[l];
+            }
+#elif defined(SOL_TA_SSE2)
+            if (c >= 16) {
+                __m128i acc = _mm_loadu_si128((const __m128i *)d);
+                for (i = 16; i + 16 <= c; i += 16) {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(d + i));
+                    acc = less ? _mm_min_epu8(acc, v) : _mm_max_epu8(acc, v);
+                }
+                uint8_t lanes[16];
+                _mm_storeu_si128((__m128i *)lanes, acc);
+                for (int l = 0; l < 16; ++l)
+                    if (less ? lanes[l] < m : lanes[l] > m) m = lanes[l];
+            }
+#endif
+            for (; i < c; ++i)
+                if (less ? d[i] < m : d[i] > m) m = d[i];
+            return (sol_val){SOL_TI64, .i64 = m};
+        }
+        default: return SOL_NIL;
+    }
+}
+sol_val sol_tamin(sol_tarray *ta) { return sol_taextreme(ta, true); }
+sol_val sol_tamax(sol_tarray *ta) { return sol_taextreme(ta, false); }
+
+bool sol_tascale(sol_tarray *ta, sol_val k) {
+    sol_f64 f; sol_i64 n;
+    if (!sol_taconv(ta, k, &f, &n)) return false;
+    uint32_t i = 0, c = ta->count;
+    switch (ta->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *d = F64(ta);
+#if defined(SOL_TA_AVX2)
+            __m256d v = _mm256_set1_pd(f);
+            for (; i + 4 <= c; i += 4) _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(d + i), v));
+#elif defined(SOL_TA_SSE2)
+            __m128d v = _mm_set1_pd(f);
+            for (; i + 2 <= c; i += 2) _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(d + i), v));
+#endif
+            for (; i < c; ++i) d[i] *= f;
+            break;
+        }
+        // Neither SSE2 nor AVX2 has a 64 bit multiply, leave these to the compiler
+        case SOL_TA_I64: {
+            sol_i64 *d = I64(ta);
+            for (; i < c; ++i) d[i] = (sol_i64)((uint64_t)d[i] * (uint64_t)n);
+            break;
+        }
+        case SOL_TA_U8: {
+            uint8_t *d = U8(ta);
+            for (; i < c; ++i) d[i] = (uint8_t)(d[i] * (uint8_t)n);
+            break;
+        }
+        default: return false;
+    }
+    return true;
+}
+
+sol_val sol_tadot(sol_tarray *a, sol_tarray *b) {
+    uint32_t i = 0, c = a->count;
+    switch (a->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *x = F64(a), *y = F64(b), sum = 0;
+#if defined(SOL_TA_AVX2)
+            __m256d acc = _mm256_setzero_pd();
+            for (; i + 4 <= c; i += 4)
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+            double lanes[4];
+            _mm256_storeu_pd(lanes, acc);
+            sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SOL_TA_SSE2)
+            __m128d acc = _mm_setzero_pd();
+            for (; i + 2 <= c; i += 2)
+                acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+            double lanes[2];
+            _mm_storeu_pd(lanes, acc);
+            sum = lanes[0] + lanes[1];
+#endif
+            for (; i < c; ++i) sum += x[i] * y[i];
+            return (sol_val){SOL_TF64, .f64 = sum};
+        }
+        case SOL_TA_I64: {
+            sol_i64 *x = I64(a), *y = I64(b);
+            uint64_t sum = 0;
+            for (; i < c; ++i) sum += (uint64_t)x[i] * (uint64_t)y[i];
+            return (sol_val){SOL_TI64, .i64 = (sol_i64)sum};
+        }
+        case SOL_TA_U8: {
+            uint8_t *x = U8(a), *y = U8(b);
+            uint64_t sum = 0;
+            // Widen to 16 bits, pmaddwd gives 32 bit pair sums that are widened again before adding
+#if defined(SOL_TA_AVX2)
+            __m256i acc = _mm256_setzero_si256(), zero = _mm256_setzero_si256();
+            for (; i + 32 <= c; i += 32) {
+                __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+                __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+                __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(vx, zero), _mm256_unpacklo_epi8(vy, zero));
+                __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(vx, zero), _mm256_unpackhi_epi8(vy, zero));
+                __m256i p = _mm256_add_epi32(lo, hi);
+                acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(p, zero));
+                acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(p, zero));
+            }
+            uint64_t lanes[4];
+            _mm256_storeu_si256((__m256i *)lanes, acc);
+            sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SOL_TA_SSE2)
+            __m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+            for (; i + 16 <= c; i += 16) {
+                __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+                __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+                __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(vx, zero), _mm_unpacklo_epi8(vy, zero));
+                __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(vx, zero), _mm_unpackhi_epi8(vy, zero));
+                __m128i p = _mm_add_epi32(lo, hi);
+                acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(p, zero));
+                acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(p, zero));
+            }
+            uint64_t lanes[2];
+            _mm_storeu_si128((__m128i *)lanes, acc);
+            sum = lanes[0] + lanes[1];
+#endif
+            for (; i < c; ++i) sum += (uint64_t)x[i] * y[i];
+            return (sol_val){SOL_TI64, .i64 = (sol_i64)sum};
+        }
+        default: return SOL_NIL;
+    }
+}
+
+void sol_taadd(sol_tarray *a, sol_tarray *b) {
+    uint32_t i = 0, c = a->count;
+    switch (a->tt) {
+        case SOL_TA_F64: {
+            sol_f64 *x = F64(a), *y = F64(b);
+#if defined(SOL_TA_AVX2)
+            for (; i + 4 <= c; i += 4)
+                _mm256_storeu_pd(x + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+#elif defined(SOL_TA_SSE2)
+            for (; i + 2 <= c; i += 2)
+                _mm_storeu_pd(x + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+#endif
+            for (; i < c; ++i) x[i] += y[i];
+            break;
+        }
+        case SOL_TA_I64: {
+            sol_i64 *x = I64(a), *y = I64(b);
+#if defined(SOL_TA_AVX2)
+            for (; i + 4 <= c; i += 4)
+                _mm256_storeu_si256((__m256i *)(x + i), _mm256_add_epi64(
+                    _mm256_loadu_si256((const __m256i *)(x + i)), _mm256_loadu_si256((const __m256i *)(y + i))));
+#elif defined(SOL_TA_SSE2)
+            for (; i + 2 <= c; i += 2)
+                _mm_storeu_si128((__m128i *)(x + i), _mm_add_epi64(
+                    _mm_loadu_si128((const __m128i *)(x + i)), _mm_loadu_si128((const __m128i *)(y + i))));
+#endif
+            for (; i < c; ++i) x[i] = (sol_i64)((uint64_t)x[i] + (uint64_t)y[i]);
+            break;
+        }
+        case SOL_TA_U8: {
+            uint8_t *x = U8(a), *y = U8(b);
+#if defined(SOL_TA_AVX2)
+            for (; i + 32 <= c; i += 32)
+                _mm256_storeu_si256((__m256i *)(x + i), _mm256_add_epi8(
+                    _mm256_loadu_si256((const __m256i *)(x + i)), _mm256_loadu_si256((const __m256i *)(y + i))));
+#elif defined(SOL_TA_SSE2)
+            for (; i + 16 <= c; i += 16)
+                _mm_storeu_si128((__m128i *)(x + i), _mm_add_epi8(
+                    _mm_loadu_si128((const __m128i *)(x + i)), _mm_loadu_si128((const __m128i *)(y + i))));
+#endif
+            for (; i < c; ++i) x[i] = (uint8_t)(x[i] + y[i]);
+            break;
+        }
+        default: break;
+    }
+}
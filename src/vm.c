@@ -1,5 +1,11 @@
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700 // mkdir, getpid, mmap, realpath
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include "sol/bytes.h"
+#include "sol/image.h"
+#include "sol/typed.h"
 #include "sol/vm.h"
 #include "sf/containers/buffer.h"
 #include "sf/fs.h"
@@ -7,18 +13,85 @@
 #include "sol/solc.h"
 #include "sf/str.h"
 
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define sol_mkdir(path) _mkdir(path)
+#define sol_getpid() _getpid()
+#define sol_realpath(path) _fullpath(NULL, path, 0)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define sol_mkdir(path) mkdir(path, 0755)
+#define sol_getpid() getpid()
+#define sol_realpath(path) realpath(path, NULL)
+#endif
+
+/// Maps an image file privately, so sol_link's patches copy the pages they touch and never
+/// reach the file. Where files can't be mapped it's read instead
+static bool sol_immap(sf_str path, sol_image *out) {
+#ifdef _WIN32
+    FILE *f = fopen(path.c_str, "rb");
+    if (!f) return false;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    void *data = size > 0 && fseek(f, 0, SEEK_SET) == 0 ? malloc((size_t)size) : NULL;
+    bool ok = data && fread(data, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+    if (!ok) {
+        free(data);
+        return false;
+    }
+    *out = (sol_image){data, (size_t)size, false};
+    return true;
+#else
+    int fd = open(path.c_str, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    *out = (sol_image){data, (size_t)st.st_size, true};
+    return true;
+#endif
+}
+static void sol_imunmap(sol_image image) {
+#ifndef _WIN32
+    if (image.mapped) {
+        munmap(image.data, image.len);
+        return;
+    }
+#endif
+    free(image.data);
+}
+
 sol_state *sol_state_new(void) {
-    sol_dyn p = calloc(1, sizeof(sol_dalloc) + sizeof(sol_dobj));
-    *(sol_dalloc *)p = (sol_dalloc){NULL, sizeof(sol_dobj), SOL_DOBJ, SOL_DYN_GREEN};
-    p = (char *)p + sizeof(sol_dalloc);
-    *(sol_dobj *)p = sol_dobj_new();
+    sol_val global = sol_dnstatic(SOL_DOBJ);
+    *(sol_dobj *)global.dyn = sol_dobj_new();
 
     sol_state *s = malloc(sizeof(sol_state));
     *s = (sol_state){
         .stack = sol_valvec_new(),
         .files = sol_filenames_new(),
-        .global = {SOL_TDYN, .dyn = p},
-        .lb = 1<<20, .cb = 0,
+        .cache = SF_STR_EMPTY,
+        .images = sol_images_new(),
+        .frozen = sol_fgraphs_new(),
+        .global = global,
+        .gslots = sol_gslots_new(),
+        .gdir = sol_gdir_new(),
+        .modules = sol_modules_new(),
+        .moddir = sol_moddir_new(),
+        .roots = sol_valvec_new(),
+        .holds = sol_valvec_new(),
+        .hfree = sol_slots_new(),
+        .weak = sol_valvec_new(),
+        .views = sol_valvec_new(),
+        .lb = SOL_GCMIN, .cb = 0,
     };
     sol_filenames_push(&s->files, sf_lit("./"));
     return s;
@@ -27,41 +100,332 @@ sol_state *sol_state_new(void) {
 void sol_state_free(sol_state *state) {
     sol_valvec_free(&state->stack);
     sol_filenames_free(&state->files);
+    sf_str_free(state->cache);
+    sol_gslots_free(&state->gslots);
+    sol_gdir_free(&state->gdir);
+    sol_modules_free(&state->modules);
+    sol_moddir_free(&state->moddir);
+    sol_valvec_free(&state->roots);
+    sol_valvec_free(&state->holds);
+    sol_slots_free(&state->hfree);
+    sol_valvec_free(&state->weak);
+    sol_valvec_free(&state->views);
+    sol_hfree(&state->heap);
+    for (uint32_t i = 0; i < state->frozen.count; ++i)
+        sol_dunfreeze(state->frozen.data[i]->made.data[0]);
+    sol_fgraphs_free(&state->frozen);
     sol_dclean(state->global);
+    for (uint32_t i = 0; i < state->images.count; ++i)
+        sol_imunmap(state->images.data[i]);
+    sol_images_free(&state->images);
     free(state);
 }
 
-sol_compile_ex sol_csrc(sol_state *state, sf_str src) {
-    sol_compile_ex ex = sol_cproto(src, 0, NULL, 1, (sol_upvalue[]){
+/// Slot of a global name, given a new one if the name hasn't been linked before
+static uint32_t sol_gslot_of(sol_state *state, sf_str name) {
+    sol_gdir_ex ex = sol_gdir_get(&state->gdir, name);
+    if (ex.is_ok) return ex.ok;
+    sf_str key = sf_str_dup(name);
+    sol_gdir_set(&state->gdir, key, state->gslots.count);
+    // A shape the table isn't at, so the first use looks the name up
+    sol_gslots_push(&state->gslots, (sol_gslot){key, NULL, ((sol_dobj *)state->global.dyn)->shape - 1});
+    return state->gslots.count - 1;
+}
+
+void sol_link(sol_state *state, sol_fproto *proto) {
+    if (proto->tt != SOL_FPROTO_BC) return;
+    for (uint32_t pc = 0; pc < proto->code_c; ++pc) {
+        sol_instruction ins = proto->code[pc];
+        uint32_t up, k, reg;
+        switch (sol_ins_op(ins)) {
+            case SOL_OP_GUPO: reg = sol_iabc_a(ins); up = sol_iabc_b(ins); k = sol_iabc_c(ins); break;
+            case SOL_OP_SUPO: up = sol_iabc_a(ins); k = sol_iabc_b(ins); reg = sol_iabc_c(ins); break;
+            default: continue;
+        }
+        // Only the global table goes through slots, other upval objs keep their names
+        sol_upvalue *upv = proto->upvals + up;
+        if (up >= proto->up_c || upv->tt != SOL_UP_VAL || upv->value.tt != SOL_TDYN || upv->value.dyn != state->global.dyn)
+            continue;
+        sol_val name = sol_valvec_get(&proto->constants, k);
+        if (!sol_isdtype(name, SOL_DSTR)) continue;
+        uint32_t slot = sol_gslot_of(state, *(sf_str *)name.dyn);
+        if (slot > MASKI(18U)) continue;
+        proto->code[pc] = sol_ins_ab(sol_ins_op(ins) == SOL_OP_GUPO ? SOL_OP_GGET : SOL_OP_GSET, reg, slot);
+    }
+    for (uint32_t i = 0; i < proto->constants.count; ++i) {
+        sol_val k = proto->constants.data[i];
+        if (sol_isdtype(k, SOL_DFUN)) sol_link(state, k.dyn);
+    }
+}
+
+/// Compiles source the way every file is, as a fun whose only upval is the global table
+static sol_compile_ex sol_cunlinked(sol_state *state, sf_str src) {
+    return sol_cproto(src, 0, NULL, 1, (sol_upvalue[]){
         (sol_upvalue){sf_lit("_g"), SOL_UP_VAL, .value = state->global}
     });
-    ex.ok.line_c = 1;
+}
+/// Lines in a source, what the debugger steps through
+static uint32_t sol_lines(sf_str src) {
+    uint32_t line_c = 1;
     for (char *c = src.c_str; *c != '\0'; ++c)
-        if (*c == '\n') ++ex.ok.line_c;
+        if (*c == '\n') ++line_c;
+    return line_c;
+}
+/// Readies a compiled or loaded file to run in the state
+static void sol_cready(sol_state *state, sol_fproto *proto, sf_str src) {
+    sol_link(state, proto);
+    proto->line_c = sol_lines(src);
+}
+
+sol_compile_ex sol_csrc(sol_state *state, sf_str src) {
+    sol_compile_ex ex = sol_cunlinked(state, src);
+    if (ex.is_ok) sol_cready(state, &ex.ok, src);
     return ex;
 }
 
-sol_compile_ex sol_cfile(sol_state *state, sf_str path) {
+/// Loads the cached image of a source, if it has one that's current and intact
+static bool sol_cacheload(sol_state *state, sf_str path, uint64_t hash, sol_fproto *out) {
+    FILE *f = fopen(path.c_str, "rb");
+    if (!f) return false;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    uint8_t *data = size > 0 && fseek(f, 0, SEEK_SET) == 0 ? malloc((size_t)size) : NULL;
+    bool ok = data && fread(data, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+
+    sol_imheader h;
+    ok = ok && (size_t)size >= sizeof(h);
+    if (ok) memcpy(&h, data, sizeof(h));
+    if (ok && h.src_hash == hash) {
+        sol_compile_ex ex = sol_imload(data, (size_t)size, state->global);
+        ok = ex.is_ok;
+        if (ok) *out = ex.ok;
+    } else ok = false;
+    free(data);
+    return ok;
+}
+/// Makes a directory and any of its parents that are missing
+static void sol_mkdirs(sf_str dir) {
+    sf_str owned = sf_str_dup(dir);
+    char *path = owned.c_str;
+    for (char *c = path + 1; *c; ++c) {
+        if (*c != '/' && *c != '\\') continue;
+        char sep = *c;
+        *c = '\0';
+        sol_mkdir(path);
+        *c = sep;
+    }
+    sol_mkdir(path);
+    sf_str_free(owned);
+}
+/// Writes an image next to its final name and moves it over it, so other processes starting
+/// at the same time never read half of one. dir is made if it's missing, unless it's empty
+static bool sol_imwrite(sf_str path, const sol_strbuf *img, sf_str dir) {
+    sf_str tmp = sf_str_fmt("%s.%ld.tmp", path.c_str, (long)sol_getpid());
+    FILE *f = fopen(tmp.c_str, "wb");
+    if (!f && !sf_isempty(dir)) {
+        sol_mkdirs(dir);
+        f = fopen(tmp.c_str, "wb");
+    }
+    bool ok = f && fwrite(img->data, 1, img->len, f) == img->len;
+    if (f) ok = fclose(f) == 0 && ok;
+    if (ok && rename(tmp.c_str, path.c_str) != 0) { // Windows won't rename over a file
+        remove(path.c_str);
+        ok = rename(tmp.c_str, path.c_str) == 0;
+    }
+    if (!ok) remove(tmp.c_str);
+    sf_str_free(tmp);
+    return ok;
+}
+/// Caches the image of a freshly compiled source
+static void sol_cachestore(sol_state *state, sf_str path, const sol_fproto *proto, uint64_t hash) {
+    sol_strbuf img = SOL_STRBUF_EMPTY;
+    if (sol_imdump(proto, state->global, hash, &img))
+        sol_imwrite(path, &img, state->cache);
+    sol_sbfree(&img);
+}
+
+/// Loads an image file in place, see sol_imview. The state keeps its memory
+static sol_compile_ex sol_cmapped(sol_state *state, sf_str path) {
+    sol_image image;
+    if (!sol_immap(path, &image))
+        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_FILE_UNREADABLE, 0, 0});
+    sol_compile_ex ex = sol_imview(image.data, image.len, state->global);
+    if (!ex.is_ok) {
+        sol_imunmap(image);
+        return ex;
+    }
+    sol_link(state, &ex.ok);
+    sol_images_push(&state->images, image);
+    return ex;
+}
+
+/// Reads a source file, null terminated
+static sol_error sol_readsrc(sf_str path, sf_buffer *out) {
     if (!sf_file_exists(path))
-        return sol_compile_ex_err((sol_compile_err){SOL_ERRC_FILE_NOT_FOUND, 0, 0});
+        return SOL_ERRC_FILE_NOT_FOUND;
     sf_fsb_ex fsb = sf_file_buffer(path);
     if (!fsb.is_ok) {
         switch (fsb.err) {
-            case SF_FILE_NOT_FOUND: return sol_compile_ex_err((sol_compile_err){SOL_ERRC_FILE_NOT_FOUND, 0, 0}); break;
+            case SF_FILE_NOT_FOUND: return SOL_ERRC_FILE_NOT_FOUND; break;
             case SF_OPEN_FAILURE:
-            case SF_READ_FAILURE: return sol_compile_ex_err((sol_compile_err){SOL_ERRC_FILE_UNREADABLE, 0, 0}); break;
+            case SF_READ_FAILURE: return SOL_ERRC_FILE_UNREADABLE; break;
         }
     }
     fsb.ok.flags = SF_BUFFER_GROW;
     sf_buffer_autoins(&fsb.ok, ""); // [\0]
+    *out = fsb.ok;
+    return SOL_ERRC_NONE;
+}
 
-    sol_compile_ex ex = sol_csrc(state, sf_ref((char *)fsb.ok.ptr));
-    sf_buffer_clear(&fsb.ok);
+static bool sol_isimage(sf_str path) {
+    sf_str ext = sf_lit(SOL_IMAGE_EXT);
+    return path.len > ext.len && sf_str_eq(sf_ref(path.c_str + path.len - ext.len), ext);
+}
+
+/// Canonical path of a file, empty if there's no file there
+static sf_str sol_canonical(sf_str path) {
+    char *full = sol_realpath(path.c_str);
+    if (!full) return SF_STR_EMPTY;
+    sf_str canon = sf_own(full);
+#ifdef _WIN32
+    if (!sf_file_exists(canon)) { // _fullpath doesn't look for the file
+        sf_str_free(canon);
+        return SF_STR_EMPTY;
+    }
+#endif
+    return canon;
+}
+
+sol_compile_ex sol_cfile(sol_state *state, sf_str path) {
+    sol_compile_ex ex;
+    if (sol_isimage(path)) {
+        if (!sf_file_exists(path))
+            return sol_compile_ex_err((sol_compile_err){SOL_ERRC_FILE_NOT_FOUND, 0, 0});
+        ex = sol_cmapped(state, path);
+        if (!ex.is_ok) return ex;
+        ex.ok.file_name = sf_str_dup(path);
+        return ex;
+    }
+
+    sf_buffer buf;
+    sol_error err = sol_readsrc(path, &buf);
+    if (err != SOL_ERRC_NONE)
+        return sol_compile_ex_err((sol_compile_err){err, 0, 0});
+    sf_str src = sf_ref((char *)buf.ptr);
+
+    if (sf_isempty(state->cache))
+        ex = sol_csrc(state, src);
+    else { // One entry per source file. Edits and other builds miss on its header and overwrite it
+        uint64_t hash = sol_imhash(src.c_str, src.len);
+        sf_str canon = sol_canonical(path);
+        sf_str key = sf_isempty(canon) ? path : canon;
+        sf_str cpath = sf_str_fmt("%s/%016llx.soli", state->cache.c_str, (unsigned long long)sol_imhash(key.c_str, key.len));
+        sf_str_free(canon);
+        sol_fproto cached;
+        if (sol_cacheload(state, cpath, hash, &cached))
+            ex = sol_compile_ex_ok(cached);
+        else {
+            ex = sol_cunlinked(state, src);
+            if (ex.is_ok) sol_cachestore(state, cpath, &ex.ok, hash);
+        }
+        if (ex.is_ok) sol_cready(state, &ex.ok, src);
+        sf_str_free(cpath);
+    }
+    sf_buffer_clear(&buf);
     if (!ex.is_ok) return ex;
     ex.ok.file_name = sf_str_dup(path);
     return ex;
 }
 
+sol_compile_err sol_cimage(sol_state *state, sf_str path, sf_str out) {
+    sf_buffer buf;
+    sol_error err = sol_readsrc(path, &buf);
+    if (err != SOL_ERRC_NONE)
+        return (sol_compile_err){err, 0, 0};
+    sf_str src = sf_ref((char *)buf.ptr);
+
+    sol_compile_ex ex = sol_cunlinked(state, src);
+    if (!ex.is_ok) {
+        sf_buffer_clear(&buf);
+        return ex.err;
+    }
+    ex.ok.line_c = sol_lines(src); // Nothing recounts it on load
+    sol_strbuf img = SOL_STRBUF_EMPTY;
+    if (!sol_imdump(&ex.ok, state->global, sol_imhash(src.c_str, src.len), &img))
+        err = SOL_ERRC_IMAGE_UNSUPPORTED;
+    else if (!sol_imwrite(out, &img, SF_STR_EMPTY))
+        err = SOL_ERRC_FILE_UNWRITABLE;
+    sol_sbfree(&img);
+    sol_fproto_free(&ex.ok);
+    sf_buffer_clear(&buf);
+    return (sol_compile_err){err, 0, 0};
+}
+
+/// Module a path names, registered if it's new. Outputs its index in state->modules
+static bool sol_modof(sol_state *state, sf_str path, uint32_t *out) {
+    sol_moddir_ex ex = sol_moddir_get(&state->moddir, path);
+    if (ex.is_ok) {
+        *out = ex.ok;
+        return true;
+    }
+    sf_str canon = sol_canonical(path);
+    if (sf_isempty(canon)) {
+        sf_str src = sf_str_fmt("%s.sol", path.c_str);
+        canon = sol_canonical(src);
+        sf_str_free(src);
+    }
+    if (sf_isempty(canon)) return false;
+
+    ex = sol_moddir_get(&state->moddir, canon);
+    if (!ex.is_ok) {
+        ex.ok = state->modules.count;
+        sol_modules_push(&state->modules, (sol_module){canon, sol_dhold(state, SOL_NIL), SOL_MOD_UNRUN});
+        sol_moddir_set(&state->moddir, canon, ex.ok);
+    }
+    if (!sf_str_eq(path, state->modules.data[ex.ok].path)) // Later imports by this path skip resolving it
+        sol_moddir_set(&state->moddir, sf_str_dup(path), ex.ok);
+    if (state->modules.data[ex.ok].path.c_str != canon.c_str)
+        sf_str_free(canon);
+    *out = ex.ok;
+    return true;
+}
+/// Runs a module and keeps what it returns. The proto is freed right after, the module's value
+/// is all that's kept of it
+static sol_call_ex sol_modrun(sol_state *state, uint32_t m) {
+    sol_module *mod = state->modules.data + m;
+    if (mod->tt == SOL_MOD_RUNNING)
+        return sol_call_ex_ok(sol_dheld(state, mod->val));
+    sol_compile_ex cm = sol_cfile(state, mod->path);
+    if (!cm.is_ok)
+        return sol_call_ex_err((sol_call_err){cm.err.tt, SF_STR_EMPTY, 0});
+
+    mod->tt = SOL_MOD_RUNNING;
+    sol_call_ex cl = sol_call(state, &cm.ok, NULL, 0);
+    sol_fproto_free(&cm.ok);
+    mod = state->modules.data + m; // Modules it imported may have moved it
+    mod->tt = cl.is_ok ? SOL_MOD_DONE : SOL_MOD_UNRUN;
+    if (cl.is_ok) sol_valvec_set(&state->holds, mod->val, cl.ok);
+    return cl;
+}
+
+sol_call_ex sol_import(sol_state *state, sf_str path) {
+    uint32_t m;
+    if (!sol_modof(state, path, &m))
+        return sol_call_ex_err((sol_call_err){SOL_ERRC_FILE_NOT_FOUND, SF_STR_EMPTY, 0});
+    if (state->modules.data[m].tt != SOL_MOD_UNRUN)
+        return sol_call_ex_ok(sol_dheld(state, state->modules.data[m].val));
+    return sol_modrun(state, m);
+}
+
+sol_call_ex sol_reload(sol_state *state, sf_str path) {
+    uint32_t m;
+    if (!sol_modof(state, path, &m))
+        return sol_call_ex_err((sol_call_err){SOL_ERRC_FILE_NOT_FOUND, SF_STR_EMPTY, 0});
+    return sol_modrun(state, m);
+}
+
 sf_str sol_tostring(sol_val val) {
     switch (val.tt) {
         case SOL_TNIL: return sf_lit("nil");
@@ -77,6 +441,7 @@ sf_str sol_tostring(sol_val val) {
                 case SOL_DARRAY:
                 case SOL_DFUN: return sf_str_fmt("%p", val.dyn);
                 case SOL_DREF: return sol_tostring(*(sol_val *)val.dyn);
+                case SOL_DWEAK: return sf_str_fmt("weak %p", ((sol_val *)val.dyn)->dyn);
 
                 case SOL_DUSR: {
                     sol_usrwrap *w = sol_uheader(val);
@@ -106,39 +471,20 @@ sf_str sol_stackdump(sol_state *state) {
     return out;
 }
 
-void sol_dpush(sol_state *s, sol_dalloc *ac) {
-    sol_dalloc *dd = s->alloc;
-    if (dd == NULL) s->alloc = ac;
-    else {
-        while (dd->next) dd = dd->next;
-        dd->next = ac;
-    }
-    s->cb += ac->size;
+/// Allocate a value owned by the collector and count it towards the next collection
+static sol_dalloc *sol_dgcnew(sol_state *s, sol_dtype tt, size_t size) {
+    sol_dalloc *dh = sol_halloc(&s->heap, tt, size);
+    if (dh) s->cb += size;
+    return dh;
 }
 
 sol_val sol_dnew(sol_state *s, sol_dtype tt) {
-    size_t size = 0;
-    switch (tt) {
-        case SOL_DSTR: size = sizeof(sf_str); break;
-        case SOL_DERR: size = sizeof(sf_str); break;
-        case SOL_DOBJ: size = sizeof(sol_dobj); break;
-        case SOL_DARRAY: size = sizeof(sol_valvec); break;
-        case SOL_DFUN: size = sizeof(sol_fproto); break;
-        case SOL_DREF: size = sizeof(sol_val); break;
-
-        case SOL_DUSR:
-        case SOL_DCOUNT: return SOL_NIL;
-    }
-
-    sol_dyn p = calloc(1, sizeof(sol_dalloc) + size);
-    sol_dalloc *dh = p;
-    *dh = (sol_dalloc){
-        .next = NULL,
-        .size = size,
-        .tt = tt,
-        .mark = SOL_DYN_WHITE,
-    };
-    p = (char *)p + sizeof(sol_dalloc);
+    if (tt == SOL_DUSR || tt == SOL_DCOUNT)
+        return SOL_NIL;
+
+    sol_dalloc *dh = sol_dgcnew(s, tt, sol_dtsize(tt));
+    if (!dh) return SOL_NIL;
+    sol_dyn p = dh + 1;
 
     switch (tt) {
         case SOL_DSTR:
@@ -146,33 +492,87 @@ sol_val sol_dnew(sol_state *s, sol_dtype tt) {
         case SOL_DOBJ: *(sol_dobj *)p = sol_dobj_new(); break;
         case SOL_DARRAY: *(sol_valvec *)p = sol_valvec_new(); break;
         case SOL_DFUN: *(sol_fproto *)p = sol_fproto_new(); break;
-        case SOL_DREF: *(sol_val *)p = SOL_NIL; break;
+        case SOL_DREF:
+        case SOL_DWEAK: *(sol_val *)p = SOL_NIL; break;
+        default: break;
+    }
+    return (sol_val){ .tt = SOL_TDYN, .dyn = p };
+}
 
-        case SOL_DUSR:
-        case SOL_DCOUNT: {
-            free(dh);
-            return SOL_NIL;
-        }
+sol_val sol_dnewusr(sol_state *state, size_t size, sf_str name, void *value, sol_usrdel del, sol_usrtostring tostring) {
+    sol_dalloc *dh = sol_dgcnew(state, SOL_DUSR, sizeof(sol_usrwrap) + size);
+    if (!dh) return SOL_NIL;
+    sol_val usr = {SOL_TDYN, .dyn = dh + 1};
+    *sol_uheader(usr) = (sol_usrwrap){sf_str_dup(name), del, tostring, 0};
+    if (value) memcpy(sol_uptr(usr), value, size);
+    return usr;
+}
+
+sol_val sol_dnview(sol_state *state, sol_val str, size_t start, size_t len) {
+    sol_dstr *ds = str.dyn;
+    if (len == 0) return sol_dnew(state, SOL_DSTR);
+    if (start == 0 && len == ds->str.len) return str;
+
+    void *parent = ds->parent ? ds->parent : str.dyn;
+    if (((sol_dalloc *)parent - 1)->sc == SOL_SC_STATIC) { // Constants die with their proto
+        char *buf = malloc(len + 1);
+        memcpy(buf, ds->str.c_str + start, len);
+        buf[len] = '\0';
+        return sol_dnstr(state, sf_own(buf));
     }
 
-    sol_dpush(s, dh);
-    return (sol_val){ .tt = SOL_TDYN, .dyn = p };
+    sol_val view = sol_dnew(state, SOL_DSTR);
+    sol_dstr *dv = view.dyn;
+    dv->str = ds->str;
+    dv->str.c_str += start;
+    dv->str.len = len;
+    dv->parent = parent;
+    return view;
+}
+
+void sol_dusrsize(sol_state *state, sol_val usr, size_t extra) {
+    sol_usrwrap *w = sol_uheader(usr);
+    if (extra > w->extra) state->cb += extra - w->extra;
+    w->extra = extra;
+}
+
+/// Stops counting memory the finalizer queue no longer holds toward the next collection
+static void sol_dgcfreed(sol_state *state, size_t bytes) {
+    state->cb = state->cb > bytes ? state->cb - bytes : 0;
+}
+
+uint32_t sol_runfinalizers(sol_state *state, uint32_t max) {
+    size_t held = state->heap.fin.bytes;
+    uint32_t ran = sol_finq_run(&state->heap.fin, max);
+    sol_dgcfreed(state, held - state->heap.fin.bytes);
+    return ran;
+}
+
+sol_finq sol_takefinalizers(sol_state *state) {
+    sol_finq batch = state->heap.fin;
+    state->heap.fin = (sol_finq){NULL, NULL, 0, 0};
+    sol_dgcfreed(state, batch.bytes);
+    return batch;
 }
 
 sol_val sol_dscopy(sol_state *state, sol_val val, bool kconst) {
     if (val.tt != SOL_TDYN)
         return val; // This function only needs to copy dynamic constants
 
-    sol_dalloc *ac = malloc(sizeof(sol_dalloc) + sol_dheader(val)->size);
-    *ac = *(sol_dheader(val));
-    ac->size = sol_dheader(val)->size;
-    ac->mark = SOL_DYN_WHITE;
-    ac->next = NULL;
-    sol_val nv = (sol_val){SOL_TDYN, .dyn=(char*)ac + sizeof(sol_dalloc)};
-    ac->mark = SOL_DYN_WHITE;
-    ac->next = NULL;
+    sol_dtype tt = sol_dtypeof(val);
+    if (tt != SOL_DSTR && tt != SOL_DFUN)
+        return SOL_NIL;
 
-    switch (sol_dheader(nv)->tt) {
+    sol_val nv;
+    if (kconst) nv = sol_dnstatic(tt); // Owned by the enclosing proto
+    else {
+        sol_dalloc *ac = sol_dgcnew(state, tt, sol_dtsize(tt));
+        if (!ac) return SOL_NIL;
+        nv = (sol_val){SOL_TDYN, .dyn = ac + 1};
+    }
+    sol_dheader(nv)->flags = sol_dheader(val)->flags & (uint16_t)~(SOL_DFLAG_FROZEN | SOL_DFLAG_FROOT); // Copies are mutable
+
+    switch (tt) {
         case SOL_DSTR:
             *(sf_str *)nv.dyn = sf_str_dup(*(sf_str *)val.dyn);
             break;
@@ -182,7 +582,9 @@ sol_val sol_dscopy(sol_state *state, sol_val val, bool kconst) {
             nfp->file_name = sf_str_dup(fp->file_name);
             nfp->constants = sol_valvec_new();
             nfp->code = malloc(sizeof(sol_instruction) * fp->code_c);
-            nfp->dbg = malloc(sizeof(sol_dbg) * fp->code_c);
+            nfp->dbg = malloc(fp->dbg_len ? fp->dbg_len : 1);
+            nfp->dbg_lines = NULL;
+            nfp->borrowed = false;
 
             // Deref Upvals
             nfp->upvals = malloc(sizeof(sol_upvalue) * nfp->up_c);
@@ -199,7 +601,7 @@ sol_val sol_dscopy(sol_state *state, sol_val val, bool kconst) {
             }
 
             memcpy(nfp->code, fp->code, sizeof(sol_instruction) * fp->code_c);
-            memcpy(nfp->dbg, fp->dbg, sizeof(sol_dbg) * fp->code_c);
+            memcpy(nfp->dbg, fp->dbg, fp->dbg_len);
             for (sol_val *v = fp->constants.data; v < fp->constants.data + fp->constants.count; ++v)
                 sol_valvec_push(&nfp->constants, sol_dscopy(state, *v, true));
             break;
@@ -210,75 +612,236 @@ sol_val sol_dscopy(sol_state *state, sol_val val, bool kconst) {
 }
 
 sol_val sol_dcopy(sol_state *state, sol_val val) {
-    if (val.tt == SOL_TDYN) {
-        val = sol_dscopy(state, val, false);
-        sol_dpush(state, sol_dheader(val));
-    }
-    return val;
+    return sol_dscopy(state, val, false);
 }
 
-void sol_dmarkfun(sol_fproto *fp) {
-    for (sol_upvalue *v = fp->upvals; v && v < fp->upvals + fp->up_c; ++v) {
-        if (v->tt == SOL_UP_VAL)
-            sol_dheader(v->value)->mark = SOL_DYN_WHITE;
+sol_hold sol_dhold(sol_state *state, sol_val val) {
+    if (state->hfree.count > 0) {
+        sol_hold h = sol_slots_pop(&state->hfree);
+        sol_valvec_set(&state->holds, h, val);
+        return h;
     }
+    sol_valvec_push(&state->holds, val);
+    return state->holds.count - 1;
 }
 
-void sol_dcollect_obj(void *ud, sf_str _k, sol_val member) {
-    (void)_k;
-    if (member.tt != SOL_TDYN || sol_dheader(member)->mark != SOL_DYN_WHITE) return;
-    sol_dheader(member)->mark = SOL_DYN_BLACK;
-    if (sol_dtypeof(member) == SOL_DOBJ)
-        sol_dobj_foreach(member.dyn, sol_dcollect_obj, ud);
-    else if (sol_dtypeof(member) == SOL_DFUN)
-        sol_dmarkfun(member.dyn);
+void sol_drelease(sol_state *state, sol_hold hold) {
+    sol_valvec_set(&state->holds, hold, SOL_NIL);
+    sol_slots_push(&state->hfree, hold);
 }
 
-void sol_dmarkref(sol_val *r) {
-    sol_val inner = sol_dval(*r);
-    while (inner.tt == SOL_TDYN) {
-        if (sol_dtypeof(inner) == SOL_DOBJ)
-            sol_dobj_foreach(inner.dyn, sol_dcollect_obj, NULL);
-        else if (sol_dtypeof(inner) == SOL_DFUN)
-            sol_dmarkfun(inner.dyn);
-        else if (sol_dtypeof(inner) == SOL_DREF)
-            inner = sol_dval(inner);
-        else {
-            sol_dheader(inner)->mark = SOL_DYN_BLACK;
+void sol_dmark(sol_state *state, sol_val val);
+void sol_dmarkobj(void *state, sol_val member) {
+    sol_dmark(state, member);
+}
+
+/// Strings and frozen values are treated as plain values in weak objects, like numbers are
+void sol_dmarkstr(void *state, sol_val member) {
+    if (sol_isdtype(member, SOL_DSTR) || sol_isdtype(member, SOL_DERR) || sol_dfrozen(member))
+        sol_dmark(state, member);
+}
+
+/// Mark a value and everything reachable from it. Static values aren't owned by the
+/// collector and are skipped, the roots that need them traced do so explicitly.
+/// Weak refs, weak objects and str views are queued instead of traced, see sol_dclearweak
+/// and sol_dkeepviews
+void sol_dmark(sol_state *state, sol_val val) {
+    sol_dalloc *ac = sol_dheader(val);
+    if (ac && ac->sc == SOL_SC_STATIC && ac->slot && ac->slot <= state->frozen.count) {
+        // A frozen value keeps its whole graph alive, and the graphs it shares values with
+        sol_fgraph *g = state->frozen.data[ac->slot - 1];
+        if (g->mark) return;
+        g->mark = true;
+        for (uint32_t i = 0; i < g->shared.count; ++i)
+            sol_dmark(state, g->shared.data[i]);
+        return;
+    }
+    if (!ac || sol_hmarked(ac)) return;
+    sol_hmark(ac);
+
+    switch (ac->tt) {
+        case SOL_DSTR:
+            if (((sol_dstr *)val.dyn)->parent)
+                sol_valvec_push(&state->views, val);
+            break;
+        case SOL_DOBJ:
+            if (ac->flags & SOL_DFLAG_WEAKV) {
+                sol_dobj_foreachv(val.dyn, sol_dmarkstr, state);
+                sol_valvec_push(&state->weak, val);
+            } else sol_dobj_foreachv(val.dyn, sol_dmarkobj, state);
+            sol_dobj_foreachks(val.dyn, sol_dmarkobj, state);
+            break;
+        case SOL_DREF: sol_dmark(state, *(sol_val *)val.dyn); break;
+        case SOL_DARRAY: {
+            sol_valvec *arr = val.dyn;
+            for (sol_val *v = arr->data; v && v < arr->data + arr->count; ++v)
+                sol_dmark(state, *v);
+            break;
+        }
+        case SOL_DWEAK:
+            if (sol_dfrozen(*(sol_val *)val.dyn)) // Frozen graphs aren't held weakly
+                sol_dmark(state, *(sol_val *)val.dyn);
+            sol_valvec_push(&state->weak, val);
+            break;
+        case SOL_DFUN: {
+            sol_fproto *fp = val.dyn;
+            for (sol_upvalue *v = fp->upvals; v && v < fp->upvals + fp->up_c; ++v)
+                if (v->tt == SOL_UP_VAL)
+                    sol_dmark(state, v->value);
             break;
         }
+        case SOL_DUSR: {
+            sol_bytes *b = sol_byof(val); // Slices keep the bytes they point into alive
+            if (b) sol_dmark(state, b->owner);
+            break;
+        }
+        default: break;
     }
 }
 
-void sol_dcollect(sol_state *state) {
-    state->lb = 0;
-    for (sol_val *r = state->stack.data; r < state->stack.data + state->stack.count; ++r) {
-        if (r->tt == SOL_TDYN) {
-            sol_dalloc *ac = sol_dheader(*r);
-            ac->mark = SOL_DYN_BLACK;
-
-            if (ac->tt == SOL_DOBJ)
-                sol_dobj_foreach(r->dyn, sol_dcollect_obj, NULL);
-            if (ac->tt == SOL_DFUN)
-                sol_dmarkfun((sol_fproto *)((char *)ac + sizeof(sol_dalloc)));
-            if (ac->tt == SOL_DREF)
-                sol_dmarkref(r);
-        }
-    }
-    sol_dobj_foreach(state->global.dyn, sol_dcollect_obj, NULL);
-
-    sol_dalloc **ac = &state->alloc;
-    while (*ac) {
-        if ((*ac)->mark == SOL_DYN_WHITE) {
-            sol_dalloc *dead = *ac;
-            *ac = dead->next;
-            sol_dclean((sol_val){SOL_TDYN, .dyn = dead + 1});
+static inline bool sol_ddying(sol_val val) {
+    sol_dalloc *ac = sol_dheader(val);
+    return ac && !sol_hmarked(ac);
+}
+
+void sol_dkeepobj(void *live, sf_str k, sol_val member) {
+    if (!sol_ddying(member))
+        sol_dobj_set(live, sf_str_dup(k), member);
+}
+
+static inline sol_dalloc *sol_dparent(sol_dstr *view) {
+    return (sol_dalloc *)view->parent - 1;
+}
+
+/// Keep the parents of marked views alive. A parent only reachable through views that
+/// are much smaller than it is left to die, and those views get their own copy
+static void sol_dkeepviews(sol_state *state) {
+    sol_val *views = state->views.data;
+    uint32_t count = state->views.count;
+    for (uint32_t i = 0; i < count; ++i) {
+        sol_dstr *v = views[i].dyn;
+        if (v->str.len * SOL_VIEWMIN >= ((sol_dstr *)v->parent)->str.len)
+            sol_hmark(sol_dparent(v));
+    }
+    for (uint32_t i = 0; i < count; ++i)
+        if (!sol_hmarked(sol_dparent(views[i].dyn)))
+            sol_dunview(views[i]);
+    state->views.count = 0;
+}
+
+/// Clear every weak ref and weak object member whose value wasn't marked.
+/// Runs after marking and before the sweep, so nothing it reads has been freed yet
+static void sol_dclearweak(sol_state *state) {
+    for (sol_val *w = state->weak.data; w < state->weak.data + state->weak.count; ++w) {
+        if (sol_isdtype(*w, SOL_DWEAK)) {
+            if (sol_ddying(*(sol_val *)w->dyn))
+                *(sol_val *)w->dyn = SOL_NIL;
             continue;
         }
-        state->lb += (*ac)->size;
-        (*ac)->mark = SOL_DYN_WHITE;
-        ac = &(*ac)->next;
+
+        sol_dobj live = sol_dobj_new();
+        sol_dobj_foreach(w->dyn, sol_dkeepobj, &live);
+        if (sol_dobj_count(&live) == sol_dobj_count(w->dyn)) {
+            sol_dobj_free(&live);
+            continue;
+        }
+        sol_dobj_free(w->dyn);
+        *(sol_dobj *)w->dyn = live;
+    }
+    state->weak.count = 0;
+}
+
+/// Points the values of a graph at its index in the state's frozen list
+static void sol_dgraphtag(sol_fgraph *g, uint32_t index) {
+    for (uint32_t i = 0; i < g->made.count; ++i)
+        sol_dheader(g->made.data[i])->slot = index + 1;
+}
+
+/// Rough bytes a graph holds, so freezing paces collections like allocating does
+static size_t sol_dgraphsize(sol_fgraph *g) {
+    size_t size = 0;
+    for (uint32_t i = 0; i < g->made.count; ++i) {
+        sol_val v = g->made.data[i];
+        size += sizeof(sol_dalloc) + sol_dtsize(sol_dtypeof(v));
+        if (sol_isdtype(v, SOL_DSTR) || sol_isdtype(v, SOL_DERR)) size += ((sf_str *)v.dyn)->len;
+    }
+    return size;
+}
+
+sol_freeze_ex sol_dsfreeze(sol_state *state, sol_val val) {
+    sol_freeze_ex ex = sol_dfreeze(val);
+    if (!ex.is_ok || ex.ok.dyn == val.dyn) return ex; // Already frozen, it stays with its owner
+    sol_fgraph *g = sol_dgraph(ex.ok);
+    sol_dgraphtag(g, state->frozen.count);
+    sol_fgraphs_push(&state->frozen, g);
+    g->bytes = sol_dgraphsize(g);
+    state->cb += g->bytes;
+    return ex;
+}
+
+/// Frees the state's graphs that marking didn't reach. Returns the bytes still alive
+static size_t sol_dsweepgraphs(sol_state *state) {
+    size_t alive = 0;
+    for (uint32_t i = 0; i < state->frozen.count;) {
+        sol_fgraph *g = state->frozen.data[i];
+        if (g->mark) {
+            g->mark = false;
+            alive += g->bytes;
+            ++i;
+            continue;
+        }
+        sol_fgraph *last = sol_fgraphs_pop(&state->frozen);
+        if (last != g) {
+            state->frozen.data[i] = last;
+            sol_dgraphtag(last, i);
+        }
+        sol_dunfreeze(g->made.data[0]);
     }
+    return alive;
+}
+
+void sol_dcollect(sol_state *state) {
+    for (sol_val *r = state->stack.data; r < state->stack.data + state->stack.count; ++r)
+        sol_dmark(state, *r);
+    for (sol_val *r = state->roots.data; r < state->roots.data + state->roots.count; ++r)
+        sol_dmark(state, *r);
+    for (sol_val *r = state->holds.data; r < state->holds.data + state->holds.count; ++r)
+        sol_dmark(state, *r);
+    sol_dobj_foreachv(state->global.dyn, sol_dmarkobj, state);
+    sol_dkeepviews(state);
+    sol_dclearweak(state);
+
+    size_t live = sol_hsweep(&state->heap) + sol_dsweepgraphs(state);
+    state->cb = live + state->heap.fin.bytes; // Queued garbage still paces until it's finalized
+    state->lb = live > SOL_GCMIN ? live : SOL_GCMIN;
+}
+
+/// Runs at the VM's safe points once allocation passes the pace. Queued destructors are
+/// drained a batch at a time before collecting again, so no single pause runs them all
+static void sol_dgcstep(sol_state *state) {
+    if (state->heap.fin.head) sol_runfinalizers(state, SOL_FINBATCH);
+    else sol_dcollect(state);
+}
+
+/// Orders strs bytewise within their lengths, so views compare without being copied out
+static int sol_strcmp(sf_str a, sf_str b) {
+    size_t n = a.len < b.len ? a.len : b.len;
+    int c = n ? memcmp(a.c_str, b.c_str, n) : 0;
+    return c ? c : (a.len > b.len) - (a.len < b.len);
+}
+
+/// The str NEXT yields for a hash member's key. The first time, a collected str takes
+/// over the key's characters and the slot keeps it, so later passes reuse it. Static and
+/// frozen objs aren't written to, their keys are copied every time
+static sol_val sol_dkeystr(sol_state *state, sol_val obj, sol_dobj_slot *slot) {
+    if (slot->keystr) return (sol_val){SOL_TDYN, .dyn = slot->keystr};
+    sol_dalloc *dh = sol_dheader(obj);
+    if (dh->sc == SOL_SC_STATIC || (dh->flags & SOL_DFLAG_FROZEN))
+        return sol_dnstr(state, sf_str_dup(slot->key));
+    sol_val str = sol_dnstr(state, slot->key);
+    slot->key = (sf_str){.c_str = slot->key.c_str, .len = slot->key.len};
+    slot->keystr = str.dyn;
+    return str;
 }
 
 void sol_log_op(sol_instruction ins) {
@@ -302,18 +865,18 @@ void sol_log_op(sol_instruction ins) {
 #   define DISPATCH() do { \
         if (pc >= proto->code_c) goto ret; \
         ins = proto->code[pc]; \
-        if (bps && SOL_DBG_LINE(proto->dbg[pc]) > proto->dbg_ll) { \
-            proto->dbg_ll = SOL_DBG_LINE(proto->dbg[pc]); \
-            if (bps[proto->dbg_ll - 1]) { \
+        if (lines) { \
+            if (lines[pc] > proto->dbg_ll && bps[lines[pc] - 1]) { \
+                proto->dbg_ll = lines[pc]; \
                 proto->dbg_res = pc; \
                 ++bpc; while (!*bpc) ++bpc; \
                 return sol_call_ex_err((sol_call_err){SOL_ERRV_BREAK, SF_STR_EMPTY, pc}); \
             } \
+            proto->dbg_ll = lines[pc]; \
         } \
-        proto->dbg_ll = SOL_DBG_LINE(proto->dbg[pc]); \
         ++pc; \
         if (s->cb > (size_t)((double)s->lb * SOL_GCSTEP)) \
-            sol_dcollect(s); \
+            sol_dgcstep(s); \
         goto *computed[sol_ins_op(ins)]; \
     } while (0)
 #   pragma GCC diagnostic push
@@ -363,6 +926,12 @@ sol_call_ex sol_call_cfun(sol_state *state, sol_fproto *proto, const sol_val *ar
     return ex;
 }
 
+/// Finds a global slot's member again, after the global table changed shape
+static void sol_gfind(sol_dobj *global, sol_gslot *g) {
+    g->val = sol_dobj_ref(global, g->name);
+    g->shape = global->shape;
+}
+
 sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, uint32_t arg_c, bool *bps) {
     if (proto->tt == SOL_FPROTO_BC && !sf_isempty(proto->file_name))
         sol_filenames_push(&s->files, sol_dirname(proto->file_name));
@@ -394,6 +963,14 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
 
         LABEL(SOL_OP_SUPO),
         LABEL(SOL_OP_GUPO),
+        LABEL(SOL_OP_GSET),
+        LABEL(SOL_OP_GGET),
+
+        LABEL(SOL_OP_ARR),
+        LABEL(SOL_OP_PUSH),
+        LABEL(SOL_OP_IGET),
+        LABEL(SOL_OP_ISET),
+        LABEL(SOL_OP_NEXT),
 
         LABEL(SOL_OP_UNKNOWN),
     };
@@ -409,24 +986,25 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
     proto->dbg_res = 0;
     sol_val return_val = SOL_NIL;
     bool *bpc = bps;
+    const uint32_t *lines = bps ? sol_dbglines(proto) : NULL; // Breakpoints are per line
 
     #ifdef COMPUTE_GOTOS
     DISPATCH();
     #else
     while (pc < proto->code_c) {
         ins = proto->code[pc];
-        if (bps && SOL_DBG_LINE(proto->dbg[pc]) > proto->dbg_ll) {
-            proto->dbg_ll = SOL_DBG_LINE(proto->dbg[pc]);
-            if (bps[proto->dbg_ll - 1]) {
+        if (lines) {
+            if (lines[pc] > proto->dbg_ll && bps[lines[pc] - 1]) {
+                proto->dbg_ll = lines[pc];
                 proto->dbg_res = pc;
                 ++bpc; while (!*bpc) ++bpc;
                 return sol_call_ex_err((sol_call_err){SOL_ERRV_BREAK, SF_STR_EMPTY, pc});
             }
+            proto->dbg_ll = lines[pc];
         }
-        proto->dbg_ll = SOL_DBG_LINE(proto->dbg[pc]);
         ++pc;
         if (s->cb > (size_t)((double)s->lb * SOL_GCSTEP))
-            sol_dcollect(s);
+            sol_dgcstep(s);
         switch (sol_ins_op(ins)) {
     #endif
         CASE(SOL_OP_LOAD) {
@@ -570,6 +1148,9 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
                     sol_set(s, sol_iabc_a(ins), (sol_val){.tt = SOL_TF64, .f64 = lhs.f64 / rhs.f64});
                     break;
                 case SOL_TI64:
+                    if (rhs.i64 == 0) return sol_callerr(SOL_ERRV_PANIC, "Integer division by zero.", NULL);
+                    if (lhs.i64 == INT64_MIN && rhs.i64 == -1)
+                        return sol_callerr(SOL_ERRV_PANIC, "Integer division overflows.", NULL);
                     sol_set(s, sol_iabc_a(ins), (sol_val){.tt = SOL_TI64, .i64 = lhs.i64 / rhs.i64});
                     break;
                 default: return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Cannot perform arithmetic on nil.", NULL); break;
@@ -707,7 +1288,7 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
                         break;
                     }
                     switch (h1->tt) {
-                        case SOL_DSTR: e = sf_str_cmp(*(sf_str *)lhs.dyn, *(sf_str *)rhs.dyn); break;
+                        case SOL_DSTR: e = sol_strcmp(*(sf_str *)lhs.dyn, *(sf_str *)rhs.dyn) <= 0; break;
                         case SOL_DOBJ: e = lhs.dyn == rhs.dyn; break;
                         case SOL_DFUN: e = *(void **)lhs.dyn == *(void **)rhs.dyn; break;
                         default: return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Unknown Type", NULL);
@@ -758,6 +1339,8 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
                 return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Expected obj at r[%d], found %s.", sol_iabc_a(ins), sol_typename(obj).c_str);
             if (!sol_isdtype(key, SOL_DSTR))
                 return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Expected str at r[%d], found %s.", sol_iabc_b(ins), sol_typename(key).c_str);
+            if (sol_dfrozen(obj))
+                return sol_callerr(SOL_ERRV_FROZEN, "Can't set member '%s' of frozen obj r[%d].", sol_dcstr(key).c_str, sol_iabc_a(ins));
             sol_dobj_set((sol_dobj *)obj.dyn, sf_str_dup(*(sf_str *)key.dyn), val);
             DISPATCH();
         }
@@ -785,6 +1368,8 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
             sol_val kkey = sol_valvec_get(&proto->constants, sol_iabc_b(ins));
             if (!sol_isdtype(kkey, SOL_DSTR))
                 return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Expected str at k[%d], found %s.", sol_iabc_b(ins), sol_typename(kkey).c_str);
+            if (sol_dfrozen(upo))
+                return sol_callerr(SOL_ERRV_FROZEN, "Can't set member '%s' of frozen obj u[%d].", ((sf_str *)kkey.dyn)->c_str, sol_iabc_a(ins));
             sol_val val = sol_get(s, sol_iabc_c(ins));
             sol_dobj_set((sol_dobj *)upo.dyn, sf_str_dup(*(sf_str *)kkey.dyn), val);
             DISPATCH();
@@ -808,6 +1393,156 @@ sol_call_ex sol_call_bc(sol_state *s, sol_fproto *proto, const sol_val *args, ui
             DISPATCH();
         }
 
+        CASE(SOL_OP_GSET) {
+            if (sol_iab_b(ins) >= s->gslots.count)
+                return sol_callerr(SOL_ERRV_OOB_ACCESS, "Global slot g[%u] out of range, %u linked.", sol_iab_b(ins), s->gslots.count);
+            sol_gslot *g = s->gslots.data + sol_iab_b(ins);
+            sol_dobj *gl = s->global.dyn;
+            if (g->shape != gl->shape) sol_gfind(gl, g);
+            sol_val val = sol_get(s, sol_iab_a(ins));
+            if (g->val) *g->val = val;
+            else sol_dobj_set(gl, sf_str_dup(g->name), val);
+            DISPATCH();
+        }
+        CASE(SOL_OP_GGET) {
+            if (sol_iab_b(ins) >= s->gslots.count)
+                return sol_callerr(SOL_ERRV_OOB_ACCESS, "Global slot g[%u] out of range, %u linked.", sol_iab_b(ins), s->gslots.count);
+            sol_gslot *g = s->gslots.data + sol_iab_b(ins);
+            sol_dobj *gl = s->global.dyn;
+            if (g->shape != gl->shape) sol_gfind(gl, g);
+            if (!g->val) {
+                sol_set(s, sol_iab_a(ins), sol_dnerr(s, sf_str_fmt("obj u[0], does not contain member '%s'.", g->name.c_str)));
+                DISPATCH();
+            }
+            sol_set(s, sol_iab_a(ins), *g->val);
+            DISPATCH();
+        }
+
+        CASE(SOL_OP_ARR) {
+            sol_set(s, (uint32_t)sol_ia_a(ins), sol_dnew(s, SOL_DARRAY));
+            DISPATCH();
+        }
+        CASE(SOL_OP_PUSH) {
+            sol_val arr = sol_get(s, sol_iab_a(ins));
+            if (!sol_isdtype(arr, SOL_DARRAY))
+                return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Expected array at r[%d], found %s.", sol_iab_a(ins), sol_typename(arr).c_str);
+            if (sol_dfrozen(arr))
+                return sol_callerr(SOL_ERRV_FROZEN, "Can't push to frozen array r[%d].", sol_iab_a(ins));
+            sol_valvec_push((sol_valvec *)arr.dyn, sol_get(s, sol_iab_b(ins)));
+            DISPATCH();
+        }
+        CASE(SOL_OP_IGET) {
+            sol_val arr = sol_get(s, sol_iabc_b(ins));
+            sol_val idx = sol_get(s, sol_iabc_c(ins));
+            if (sol_isdtype(arr, SOL_DARRAY) && idx.tt == SOL_TI64) {
+                sol_valvec *v = arr.dyn;
+                if (idx.i64 < 0 || idx.i64 >= (sol_i64)v->count)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for array of length %u.", idx.i64, v->count);
+                sol_set(s, sol_iabc_a(ins), v->data[idx.i64]);
+                DISPATCH();
+            }
+            sol_tarray *ta = sol_taof(arr);
+            if (ta && idx.tt == SOL_TI64) {
+                if (idx.i64 < 0 || idx.i64 >= (sol_i64)ta->count)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for array of length %u.", idx.i64, ta->count);
+                sol_set(s, sol_iabc_a(ins), sol_taget(ta, (uint32_t)idx.i64));
+                DISPATCH();
+            }
+            sol_bytes *by = sol_byof(arr);
+            if (by && idx.tt == SOL_TI64) {
+                if (idx.i64 < 0 || (uint64_t)idx.i64 >= by->len)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for bytes of length %zu.", idx.i64, by->len);
+                sol_set(s, sol_iabc_a(ins), (sol_val){.tt = SOL_TI64, .i64 = by->data[idx.i64]});
+                DISPATCH();
+            }
+            if (sol_isdtype(arr, SOL_DOBJ) && idx.tt == SOL_TI64) {
+                sol_dobj_ex ex = sol_dobj_geti((sol_dobj *)arr.dyn, idx.i64);
+                sol_set(s, sol_iabc_a(ins), ex.is_ok ? ex.ok :
+                    sol_dnerr(s, sf_str_fmt("obj r[%d], does not contain member '%lld'.", sol_iabc_b(ins), idx.i64)));
+                DISPATCH();
+            }
+            if (sol_isdtype(arr, SOL_DOBJ) && sol_isdtype(idx, SOL_DSTR)) {
+                sol_dobj_ex ex = sol_dobj_get((sol_dobj *)arr.dyn, *(sf_str *)idx.dyn);
+                sol_set(s, sol_iabc_a(ins), ex.is_ok ? ex.ok :
+                    sol_dnerr(s, sf_str_fmt("obj r[%d], does not contain member '%s'.", sol_iabc_b(ins), sol_dcstr(idx).c_str)));
+                DISPATCH();
+            }
+            return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Can't index %s with %s.", sol_typename(arr).c_str, sol_typename(idx).c_str);
+        }
+        CASE(SOL_OP_ISET) {
+            sol_val arr = sol_get(s, sol_iabc_a(ins));
+            sol_val idx = sol_get(s, sol_iabc_b(ins));
+            sol_val val = sol_get(s, sol_iabc_c(ins));
+            if (sol_dfrozen(arr))
+                return sol_callerr(SOL_ERRV_FROZEN, "Can't index assign frozen %s r[%d].", sol_typename(arr).c_str, sol_iabc_a(ins));
+            if (sol_isdtype(arr, SOL_DARRAY) && idx.tt == SOL_TI64) {
+                sol_valvec *v = arr.dyn;
+                if (idx.i64 < 0 || idx.i64 >= (sol_i64)v->count)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for array of length %u.", idx.i64, v->count);
+                v->data[idx.i64] = val;
+                DISPATCH();
+            }
+            sol_tarray *ta = sol_taof(arr);
+            if (ta && idx.tt == SOL_TI64) {
+                if (idx.i64 < 0 || idx.i64 >= (sol_i64)ta->count)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for array of length %u.", idx.i64, ta->count);
+                if (!sol_taset(ta, (uint32_t)idx.i64, val))
+                    return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Can't store %s in %s.", sol_typename(val).c_str, sol_typename(arr).c_str);
+                DISPATCH();
+            }
+            sol_bytes *by = sol_byof(arr);
+            if (by && idx.tt == SOL_TI64) {
+                if (idx.i64 < 0 || (uint64_t)idx.i64 >= by->len)
+                    return sol_callerr(SOL_ERRV_OOB_ACCESS, "Index %lld is out of bounds for bytes of length %zu.", idx.i64, by->len);
+                if (!sol_byset(by, (size_t)idx.i64, SOL_BK_U8, val))
+                    return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Can't store %s in bytes.", sol_typename(val).c_str);
+                DISPATCH();
+            }
+            if (sol_isdtype(arr, SOL_DOBJ) && idx.tt == SOL_TI64) {
+                sol_dobj_seti((sol_dobj *)arr.dyn, idx.i64, val);
+                DISPATCH();
+            }
+            if (sol_isdtype(arr, SOL_DOBJ) && sol_isdtype(idx, SOL_DSTR)) {
+                sol_dobj_set((sol_dobj *)arr.dyn, sf_str_dup(*(sf_str *)idx.dyn), val);
+                DISPATCH();
+            }
+            return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Can't index %s with %s.", sol_typename(arr).c_str, sol_typename(idx).c_str);
+        }
+
+        CASE(SOL_OP_NEXT) {
+            // r[a] is the cursor, the key and value go to r[a+1] and r[a+2].
+            // Skips the next instruction (the loop exit) when there's another member
+            uint32_t cur = sol_iab_a(ins);
+            sol_val it = sol_get(s, sol_iab_b(ins));
+            sol_i64 i = sol_get(s, cur).i64;
+            if (sol_isdtype(it, SOL_DOBJ)) {
+                sol_dobj_it dit = {(uint32_t)i, -1, SF_STR_EMPTY, SOL_NIL, NULL};
+                if (sol_dobj_next((sol_dobj *)it.dyn, &dit)) {
+                    sol_set(s, cur + 1, dit.index >= 0 ? (sol_val){.tt = SOL_TI64, .i64 = dit.index} :
+                        sol_dkeystr(s, it, dit.slot));
+                    sol_set(s, cur + 2, dit.val);
+                    ++pc;
+                }
+                sol_set(s, cur, (sol_val){.tt = SOL_TI64, .i64 = dit.cursor});
+                DISPATCH();
+            }
+            sol_tarray *ta = sol_taof(it);
+            sol_bytes *by = sol_byof(it);
+            size_t count;
+            if (sol_isdtype(it, SOL_DARRAY)) count = ((sol_valvec *)it.dyn)->count;
+            else if (ta) count = ta->count;
+            else if (by) count = by->len;
+            else return sol_callerr(SOL_ERRV_TYPE_MISMATCH, "Can't iterate %s.", sol_typename(it).c_str);
+            if ((size_t)i < count) {
+                sol_set(s, cur + 1, (sol_val){.tt = SOL_TI64, .i64 = i});
+                sol_set(s, cur + 2, ta ? sol_taget(ta, (uint32_t)i) : by ? (sol_val){.tt = SOL_TI64, .i64 = by->data[i]} :
+                    ((sol_valvec *)it.dyn)->data[i]);
+                sol_set(s, cur, (sol_val){.tt = SOL_TI64, .i64 = i + 1});
+                ++pc;
+            }
+            DISPATCH();
+        }
+
         CASE(SOL_OP_UNKNOWN) { DISPATCH(); }
     #ifndef COMPUTE_GOTOS
         }
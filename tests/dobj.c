@@ -0,0 +1,119 @@
+#include "sol/bytecode.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEYS 2000
+
+static int check(bool ok, const char *what) {
+    if (!ok) fprintf(stderr, "%s\n", what);
+    return ok ? 0 : 1;
+}
+
+static sol_val num(sol_i64 n) { return (sol_val){.tt = SOL_TI64, .i64 = n}; }
+static sf_str key(char buf[16], uint32_t i) {
+    snprintf(buf, 16, "k%u", i);
+    return sf_ref(buf);
+}
+static bool has(sol_dobj *obj, sf_str k, sol_i64 n) {
+    sol_dobj_ex ex = sol_dobj_get(obj, k);
+    return ex.is_ok && ex.ok.tt == SOL_TI64 && ex.ok.i64 == n;
+}
+
+/// What sol_dobj_foreach visited
+typedef struct {
+    uint32_t count, arr_seen, out_of_order;
+    bool hash_started;
+    uint8_t seen[KEYS];
+} visit;
+static void visit_member(void *user, sf_str k, sol_val val) {
+    visit *v = user;
+    ++v->count;
+    if (k.len > 0 && k.c_str[0] == 'k') {
+        v->hash_started = true;
+        if (val.i64 >= 0 && val.i64 < KEYS) ++v->seen[val.i64];
+    } else if (v->hash_started || val.i64 != v->arr_seen++) ++v->out_of_order; // Array part first, by index
+}
+
+int main(void) {
+    int rc = 0;
+    char buf[16];
+
+    // Members deleted before a resize can be inserted again after it
+    sol_dobj obj = sol_dobj_new();
+    bool live[KEYS] = {0};
+    for (uint32_t i = 0; i < 64; ++i) {
+        sol_dobj_set(&obj, sf_str_dup(key(buf, i)), num(i));
+        live[i] = true;
+    }
+    for (uint32_t i = 0; i < 64; i += 2) {
+        rc |= check(sol_dobj_remove(&obj, key(buf, i)), "remove missed a member");
+        live[i] = false;
+    }
+    uint32_t cap = obj.cap;
+    for (uint32_t i = 64; i < KEYS; ++i) {
+        sol_dobj_set(&obj, sf_str_dup(key(buf, i)), num(i));
+        live[i] = true;
+    }
+    rc |= check(obj.cap > cap, "table never grew");
+    for (uint32_t i = 0; i < 64; i += 4) {
+        sol_dobj_set(&obj, sf_str_dup(key(buf, i)), num(i));
+        live[i] = true;
+    }
+    // Churn at a fixed size, so tombstones pile up and get rehashed away
+    for (uint32_t round = 0; round < 8; ++round)
+        for (uint32_t i = round; i < KEYS; i += 7) {
+            if (live[i]) sol_dobj_remove(&obj, key(buf, i));
+            else sol_dobj_set(&obj, sf_str_dup(key(buf, i)), num(i));
+            live[i] = !live[i];
+        }
+    uint32_t live_c = 0, wrong = 0;
+    for (uint32_t i = 0; i < KEYS; ++i) {
+        live_c += live[i];
+        if (live[i] != has(&obj, key(buf, i), i)) ++wrong;
+    }
+    rc |= check(wrong == 0, "members don't match after deletes and resizes");
+    rc |= check(sol_dobj_count(&obj) == live_c, "count doesn't match after deletes and resizes");
+    rc |= check(!sol_dobj_remove(&obj, sf_lit("missing")), "removed a missing member");
+
+    // Index keys move from the hash part to the array part once it reaches them...
+    sol_dobj_seti(&obj, 5, num(5));
+    sol_dobj_set(&obj, sf_str_cdup("4"), num(4));
+    sol_dobj_seti(&obj, -1, num(-1));
+    sol_dobj_set(&obj, sf_str_cdup("012"), num(12));
+    rc |= check(obj.arr_c == 0 && obj.idx_c == 2, "index keys ahead of the array part aren't counted");
+    for (sol_i64 i = 0; i < 4; ++i)
+        sol_dobj_seti(&obj, i, num(i));
+    rc |= check(obj.arr_c == 6 && obj.idx_c == 0, "array part didn't take the members it reached");
+    rc |= check(has(&obj, sf_lit("4"), 4) && has(&obj, sf_lit("5"), 5), "joined members lost their values");
+    rc |= check(has(&obj, sf_lit("-1"), -1) && has(&obj, sf_lit("012"), 12), "non index keys moved");
+    rc |= check(sol_dobj_ref(&obj, sf_lit("5")) == NULL, "array member still in the hash part");
+
+    // ...and back when a hole opens in it
+    rc |= check(sol_dobj_removei(&obj, 2), "array member wasn't removed");
+    rc |= check(obj.arr_c == 2 && obj.idx_c == 3, "members after the hole didn't move to the hash part");
+    rc |= check(!sol_dobj_geti(&obj, 2).is_ok, "removed array member is still there");
+    rc |= check(has(&obj, sf_lit("3"), 3) && has(&obj, sf_lit("5"), 5), "moved members lost their values");
+    rc |= check(sol_dobj_remove(&obj, sf_lit("4")) && obj.idx_c == 2, "removing a hash index didn't count down");
+    sol_dobj_seti(&obj, 2, num(2));
+    rc |= check(obj.arr_c == 4 && obj.idx_c == 1, "array part didn't stop at the missing index");
+    sol_dobj_seti(&obj, 4, num(4));
+    rc |= check(obj.arr_c == 6 && obj.idx_c == 0, "array part didn't take the rest back");
+
+    rc |= check(sol_dobj_removei(&obj, -1) && sol_dobj_remove(&obj, sf_lit("012")) && obj.idx_c == 0,
+        "removing non index keys counted down");
+
+    // foreach visits the array part in order, then every hash member once
+    visit v = {0};
+    sol_dobj_foreach(&obj, visit_member, &v);
+    uint32_t twice = 0, missed = 0;
+    for (uint32_t i = 0; i < KEYS; ++i) {
+        twice += v.seen[i] > 1;
+        missed += live[i] && !v.seen[i];
+    }
+    rc |= check(v.count == sol_dobj_count(&obj), "foreach count doesn't match");
+    rc |= check(v.arr_seen == obj.arr_c && v.out_of_order == 0, "array part visited out of order");
+    rc |= check(twice == 0 && missed == 0, "hash members visited twice or missed");
+
+    sol_dobj_free(&obj);
+    return rc;
+}
@@ -0,0 +1,64 @@
+#include "sol/vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Usertypes that own 4 KiB outside the heap, like a strbuf made with strbuf.new(4096)
+#define BUF_SIZE 4096
+#define ALLOCS 300000
+#define MAX_PENDING 4096 // 16 MiB of buffers waiting on a collection or a destructor
+
+static size_t created = 0, destroyed = 0, peak = 0;
+
+static void buf_del(void *ptr) {
+    free(*(void **)ptr);
+    ++destroyed;
+}
+
+static sol_call_ex buf_new(sol_state *s) {
+    void *buf = malloc(BUF_SIZE);
+    sol_val usr = sol_dnewusr(s, sizeof(void *), sf_lit("buf"), &buf, buf_del, NULL);
+    if (usr.tt == SOL_TNIL) {
+        free(buf);
+        return sol_call_ex_err((sol_call_err){SOL_ERRV_PANIC, sf_lit("Failed to allocate buf"), 0});
+    }
+    sol_dusrsize(s, usr, BUF_SIZE);
+    ++created;
+    if (created - destroyed > peak) peak = created - destroyed;
+    return sol_call_ex_ok(usr);
+}
+
+int main(void) {
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    sol_dobj_set(s->global.dyn, sf_lit("newbuf"), sol_wrapcfun(s, buf_new, 0, 0));
+
+    sol_compile_ex comp_ex = sol_csrc(s, sf_lit(
+        "let i = 0;\n"
+        "while i < 300000: {\n"
+        "    let b = newbuf();\n"
+        "    i = i + 1;\n"
+        "}\n"
+    ));
+    if (!comp_ex.is_ok) {
+        fprintf(stderr, "compile failed: %s\n", sol_err_string(comp_ex.err.tt).c_str);
+        return 1;
+    }
+    sol_call_ex call_ex = sol_call(s, &comp_ex.ok, NULL, 0);
+    sol_fproto_free(&comp_ex.ok);
+    if (!call_ex.is_ok) {
+        fprintf(stderr, "call failed: %s\n", sol_err_string(call_ex.err.tt).c_str);
+        return 1;
+    }
+
+    printf("created %zu, peak pending %zu\n", created, peak);
+    if (created != ALLOCS || peak > MAX_PENDING) {
+        fprintf(stderr, "finalizers fell behind: %zu usertypes pending at once\n", peak);
+        return 1;
+    }
+    sol_state_free(s);
+    if (destroyed != created) {
+        fprintf(stderr, "%zu usertypes never finalized\n", created - destroyed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "sol/vm.h"
+#include <stdio.h>
+
+#define FREEZES 20000
+#define MAX_LIVE 2048 // Graphs the state may still hold once the loop is done
+
+static int check(bool ok, const char *what) {
+    if (!ok) fprintf(stderr, "%s\n", what);
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    int rc = 0;
+
+    // Frozen values inside a graph are shared, and freeing the outer graph leaves them alone
+    sol_val inner = sol_dnstr(s, sf_str_cdup("inner"));
+    sol_val arr = sol_dnew(s, SOL_DARRAY);
+    sol_freeze_ex fin = sol_dfreeze(inner);
+    sol_valvec_push(arr.dyn, fin.ok);
+    sol_freeze_ex fout = sol_dfreeze(arr);
+    rc |= check(fin.is_ok && fout.is_ok, "freezing failed");
+    rc |= check(((sol_valvec *)fout.ok.dyn)->data[0].dyn == fin.ok.dyn, "frozen member was copied");
+    sol_dunfreeze(fout.ok);
+    rc |= check(sf_str_eq(*(sf_str *)fin.ok.dyn, sf_lit("inner")), "shared member was freed");
+    sol_dunfreeze(fin.ok);
+
+    // Graphs frozen by scripts are freed once they're unreachable
+    sol_compile_ex comp_ex = sol_csrc(s, sf_lit(
+        "let kept = freeze({ s = \"kept\" });\n"
+        "let i = 0;\n"
+        "while i < 20000: {\n"
+        "    let f = freeze({ n = i s = \"abc\" arr = [1, 2] });\n"
+        "    i += 1;\n"
+        "}\n"
+        "return kept;\n"
+    ));
+    if (!comp_ex.is_ok) {
+        fprintf(stderr, "compile failed: %s\n", sol_err_string(comp_ex.err.tt).c_str);
+        return 1;
+    }
+    sol_call_ex call_ex = sol_call(s, &comp_ex.ok, NULL, 0);
+    sol_fproto_free(&comp_ex.ok);
+    rc |= check(call_ex.is_ok, "call failed");
+    if (call_ex.is_ok) {
+        sol_hold kept = sol_dhold(s, call_ex.ok);
+        sol_dcollect(s);
+        printf("%u of %u graphs alive\n", s->frozen.count, FREEZES + 1);
+        rc |= check(s->frozen.count <= MAX_LIVE, "unreachable graphs weren't freed");
+        sol_dobj_ex str = sol_dobj_get(call_ex.ok.dyn, sf_lit("s"));
+        rc |= check(str.is_ok && sf_str_eq(*(sf_str *)str.ok.dyn, sf_lit("kept")), "reachable graph was freed");
+        sol_drelease(s, kept);
+    }
+
+    sol_state_free(s);
+    return rc;
+}
@@ -0,0 +1,123 @@
+#include "sol/heap.h"
+#include "sol/vm.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PER_SIZE 3000 // Enough for the small classes to span several slabs
+#define KEEP 3 // Every KEEPth value survives
+
+static int check(bool ok, const char *what) {
+    if (!ok) fprintf(stderr, "%s\n", what);
+    return ok ? 0 : 1;
+}
+
+/// What a value costs once it's alive: its slot, or its payload if it's big
+static size_t footprint(sol_dalloc *dh) {
+    return dh->sc < SOL_SC_COUNT ? sol_slabof(dh)->stride : sol_bigof(dh)->size;
+}
+static bool intact(sol_dalloc *dh, size_t size, uint8_t fill) {
+    const uint8_t *p = (const uint8_t *)(dh + 1);
+    for (size_t i = 0; i < size; ++i)
+        if (p[i] != fill) return false;
+    return true;
+}
+
+static const size_t SIZES[] = {1, 16, 17, 32, 40, 64, 65, 128, 200, 256, 257, 4000};
+#define SIZE_C (sizeof(SIZES) / sizeof(SIZES[0]))
+
+int main(void) {
+    int rc = 0;
+
+    // Sweeping frees exactly the unmarked values of every size class and of big ones
+    static sol_dalloc *vals[SIZE_C][PER_SIZE];
+    sol_heap heap = {0};
+    size_t expect = 0;
+    uint32_t bad_class = 0, bad_slot = 0;
+    for (size_t s = 0; s < SIZE_C; ++s)
+        for (uint32_t i = 0; i < PER_SIZE; ++i) {
+            sol_dalloc *dh = vals[s][i] = sol_halloc(&heap, SOL_DREF, SIZES[s]);
+            memset(dh + 1, (uint8_t)(i + s), SIZES[s]);
+            if ((dh->sc == SOL_SC_BIG) != (SIZES[s] > 256)) ++bad_class;
+            if (dh->sc < SOL_SC_COUNT) {
+                sol_slab *sl = sol_slabof(dh);
+                if ((size_t)((char *)dh - (char *)sl) != SOL_SLAB_HDR + (size_t)dh->slot * sl->stride || dh->slot >= sl->cap)
+                    ++bad_slot;
+            }
+            if (i % KEEP == 0) {
+                sol_hmark(dh);
+                expect += footprint(dh);
+            }
+        }
+    rc |= check(bad_class == 0, "values got the wrong size class");
+    rc |= check(bad_slot == 0, "slot index doesn't match the slot's address");
+    size_t alive = sol_hsweep(&heap);
+    rc |= check(alive == expect, "sweep counted the wrong live bytes");
+
+    uint32_t corrupt = 0, marked = 0;
+    for (size_t s = 0; s < SIZE_C; ++s)
+        for (uint32_t i = 0; i < PER_SIZE; i += KEEP) {
+            corrupt += !intact(vals[s][i], SIZES[s], (uint8_t)(i + s));
+            marked += sol_hmarked(vals[s][i]);
+        }
+    rc |= check(corrupt == 0, "survivors were overwritten by the sweep");
+    rc |= check(marked == 0, "sweep left marks behind");
+
+    // Freed slots are reused without touching survivors. They're marked again first, so a
+    // new value in a live slot would show up marked
+    for (size_t s = 0; s < SIZE_C; ++s)
+        for (uint32_t i = 0; i < PER_SIZE; i += KEEP)
+            sol_hmark(vals[s][i]);
+    uint32_t reused_live = 0;
+    for (size_t s = 0; s < SIZE_C; ++s)
+        for (uint32_t i = 0; i < PER_SIZE; ++i) {
+            if (i % KEEP == 0) continue;
+            sol_dalloc *dh = sol_halloc(&heap, SOL_DREF, SIZES[s]);
+            reused_live += sol_hmarked(dh);
+            memset(dh + 1, 0xEE, SIZES[s]);
+        }
+    rc |= check(reused_live == 0, "allocation handed out a live slot");
+    corrupt = 0;
+    for (size_t s = 0; s < SIZE_C; ++s)
+        for (uint32_t i = 0; i < PER_SIZE; i += KEEP)
+            corrupt += !intact(vals[s][i], SIZES[s], (uint8_t)(i + s));
+    rc |= check(corrupt == 0, "survivors were overwritten by new values");
+    rc |= check(sol_hsweep(&heap) == expect, "second sweep counted the wrong live bytes");
+
+    // With nothing marked everything goes, slabs included
+    rc |= check(sol_hsweep(&heap) == 0, "unmarked values survived");
+    bool empty = !heap.big && !heap.bigtail;
+    for (uint32_t sc = 0; sc < SOL_SC_COUNT; ++sc)
+        empty = empty && !heap.slabs[sc] && !heap.full[sc];
+    rc |= check(empty, "empty slabs or big values were kept");
+    sol_hfree(&heap);
+
+    // The state's byte counts: cb grows by each payload, and a collection resets it to
+    // what's alive, counted the way the sweep counts it
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    sol_dcollect(s);
+    sol_dcollect(s);
+    size_t base = s->cb, allocated = 0, held = 0;
+    static const sol_dtype TYPES[] = {SOL_DSTR, SOL_DOBJ, SOL_DARRAY, SOL_DREF};
+    static sol_hold holds[4 * 1000 + 100];
+    uint32_t hold_c = 0;
+    for (uint32_t i = 0; i < 4 * 1000 + 100; ++i) {
+        sol_val v = i < 4000 ? sol_dnew(s, TYPES[i % 4]) :
+            sol_dnewusr(s, 64, sf_lit("blob"), NULL, NULL, NULL);
+        allocated += i < 4000 ? sol_dtsize(TYPES[i % 4]) : sizeof(sol_usrwrap) + 64;
+        if (i % KEEP == 0) {
+            holds[hold_c++] = sol_dhold(s, v);
+            held += footprint(sol_dheader(v));
+        }
+    }
+    rc |= check(s->cb == base + allocated, "cb didn't count every allocation");
+    sol_dcollect(s);
+    rc |= check(s->cb == base + held, "cb after collecting isn't what's alive");
+    rc |= check(s->lb >= s->cb, "live baseline is below what's alive");
+    for (uint32_t i = 0; i < hold_c; ++i)
+        sol_drelease(s, holds[i]);
+    sol_dcollect(s);
+    rc |= check(s->cb == base, "released values are still counted");
+    sol_state_free(s);
+    return rc;
+}
@@ -0,0 +1,128 @@
+#include "sol/image.h"
+#include "sol/vm.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int check(bool ok, const char *what) {
+    if (!ok) fprintf(stderr, "%s\n", what);
+    return ok ? 0 : 1;
+}
+
+/// Loads a copy of the image with size bytes at off replaced, resealed so only the checks
+/// past the sum can turn it away
+static bool load_patched(sol_state *s, const sol_strbuf *img, size_t off, const void *bytes, size_t size) {
+    uint8_t *data = malloc(img->len);
+    memcpy(data, img->data, img->len);
+    memcpy(data + off, bytes, size);
+    sol_imheader h;
+    memcpy(&h, data, sizeof(h));
+    h.sum = sol_imhash(data + sizeof(h), img->len - sizeof(h));
+    memcpy(data, &h, sizeof(h));
+
+    sol_compile_ex ex = sol_imload(data, img->len, s->global);
+    free(data);
+    if (ex.is_ok) sol_fproto_free(&ex.ok);
+    return ex.is_ok;
+}
+/// The table entry of an image's proto
+static sol_improto improto(const sol_strbuf *img, uint32_t idx) {
+    sol_improto ip;
+    memcpy(&ip, img->data + sizeof(sol_imheader) + idx * sizeof(ip), sizeof(ip));
+    return ip;
+}
+static size_t improto_at(uint32_t idx, size_t field) { return sizeof(sol_imheader) + idx * sizeof(sol_improto) + field; }
+/// Loads the image with the root's instruction at pc replaced
+static bool load_ins(sol_state *s, const sol_strbuf *img, uint32_t pc, sol_instruction ins) {
+    return load_patched(s, img, improto(img, 0).code + (size_t)pc * sizeof(ins), &ins, sizeof(ins));
+}
+static sol_strbuf dump(sol_state *s, sf_str src, sol_fproto *out) {
+    sol_strbuf img = SOL_STRBUF_EMPTY;
+    sol_compile_ex comp_ex = sol_cproto(src, 0, NULL, 1, (sol_upvalue[]){
+        (sol_upvalue){sf_lit("_g"), SOL_UP_VAL, .value = s->global}
+    });
+    if (!comp_ex.is_ok) {
+        fprintf(stderr, "compile failed: %s\n", sol_err_string(comp_ex.err.tt).c_str);
+        return img;
+    }
+    comp_ex.ok.line_c = 1; // As sol_cimage counts them
+    for (size_t i = 0; i < src.len; ++i)
+        if (src.c_str[i] == '\n') ++comp_ex.ok.line_c;
+    if (!sol_imdump(&comp_ex.ok, s->global, sol_imhash(src.c_str, src.len), &img))
+        fprintf(stderr, "dump failed\n");
+    *out = comp_ex.ok;
+    return img;
+}
+
+int main(void) {
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    int rc = 0;
+
+    sf_str src = sf_lit("let a = 1;\nlet b = a + 2;\nreturn b;\n");
+    sol_fproto proto = sol_fproto_new();
+    sol_strbuf img = dump(s, src, &proto);
+    if (!img.len) return 1;
+    uint32_t reg_c = proto.reg_c, const_c = proto.constants.count, code_c = proto.code_c;
+    uint32_t load = 0;
+    while (load < code_c && sol_ins_op(proto.code[load]) != SOL_OP_LOAD) ++load;
+    rc |= check(load < code_c, "no LOAD to patch");
+    sol_fproto_free(&proto);
+
+    // Instructions whose operands are out of their proto's bounds are turned away
+    sol_compile_ex intact = sol_imload(img.data, img.len, s->global);
+    rc |= check(intact.is_ok, "intact image refused");
+    if (intact.is_ok) sol_fproto_free(&intact.ok);
+    rc |= check(load_ins(s, &img, 0, sol_ins_a(SOL_OP_JMP, (int32_t)code_c - 1)), "jump to the end refused");
+    rc |= check(!load_ins(s, &img, load, sol_ins_ab(SOL_OP_LOAD, 0U, const_c)), "constant out of range loaded");
+    rc |= check(!load_ins(s, &img, load, sol_ins_ab(SOL_OP_LOAD, reg_c, 0U)), "register out of range loaded");
+    rc |= check(!load_ins(s, &img, 0, sol_ins_a(SOL_OP_JMP, (int32_t)code_c)), "jump past the code loaded");
+    rc |= check(!load_ins(s, &img, 0, sol_ins_a(SOL_OP_JMP, -2)), "jump before the code loaded");
+    rc |= check(!load_ins(s, &img, 0, sol_ins_ab(SOL_OP_GGET, 0U, 0U)), "linked GGET loaded");
+    rc |= check(!load_ins(s, &img, 0, sol_ins_abc(SOL_OP_ADD, 0U, 0U, reg_c)), "ADD register out of range loaded");
+
+    // Line tables have to decode, cover the code and stay within the source
+    sol_improto ip = improto(&img, 0);
+    uint32_t cut = ip.dbg_len - 1, no_lines = 0, trunc = 0x80;
+    rc |= check(!load_patched(s, &img, improto_at(0, offsetof(sol_improto, dbg_len)), &cut, sizeof(cut)), "short line table loaded");
+    rc |= check(!load_patched(s, &img, ip.dbg + ip.dbg_len - 1, &trunc, 1), "cut off varint loaded");
+    rc |= check(!load_patched(s, &img, improto_at(0, offsetof(sol_improto, line_c)), &no_lines, sizeof(no_lines)), "line past the source loaded");
+    sol_sbfree(&img);
+
+    // Ref upvals point into a register of an enclosing proto
+    img = dump(s, sf_lit("let a = 1;\nlet f = [a]() { return a; };\nreturn f();\n"), &proto);
+    if (!img.len) return 1;
+    sol_fproto_free(&proto);
+    intact = sol_imload(img.data, img.len, s->global);
+    rc |= check(intact.is_ok, "intact closure image refused");
+    if (intact.is_ok) sol_fproto_free(&intact.ok);
+    sol_improto fun = improto(&img, 1);
+    sol_imupval iu;
+    uint32_t u = 0;
+    for (; u < fun.up_c; ++u) {
+        memcpy(&iu, img.data + fun.upvals + u * sizeof(iu), sizeof(iu));
+        if (iu.tt == SOL_UP_REF) break;
+    }
+    rc |= check(u < fun.up_c, "no ref upval to patch");
+    size_t up_at = fun.upvals + u * sizeof(iu);
+    uint32_t bad_frame = 1, bad_ref = improto(&img, 0).reg_c, ref = SOL_UP_REF;
+    rc |= check(!load_patched(s, &img, up_at + offsetof(sol_imupval, frame), &bad_frame, sizeof(bad_frame)), "ref to its own frame loaded");
+    rc |= check(!load_patched(s, &img, up_at + offsetof(sol_imupval, ref), &bad_ref, sizeof(bad_ref)), "ref past the registers loaded");
+    rc |= check(!load_patched(s, &img, improto(&img, 0).upvals + offsetof(sol_imupval, tt), &ref, sizeof(ref)), "ref in the root loaded");
+    sol_sbfree(&img);
+
+    // Linked code only reads the global slots the state has
+    sol_compile_ex comp_ex = sol_csrc(s, src);
+    rc |= check(comp_ex.is_ok, "compile failed");
+    if (comp_ex.is_ok) {
+        comp_ex.ok.code[0] = sol_ins_ab(SOL_OP_GGET, 0U, (s->gslots.count + 7U));
+        sol_call_ex call_ex = sol_call(s, &comp_ex.ok, NULL, 0);
+        rc |= check(!call_ex.is_ok && call_ex.err.tt == SOL_ERRV_OOB_ACCESS, "global slot out of range read");
+        if (!call_ex.is_ok) sf_str_free(call_ex.err.panic);
+        sol_fproto_free(&comp_ex.ok);
+    }
+
+    sol_state_free(s);
+    return rc;
+}
@@ -0,0 +1,96 @@
+#include "sol/vm.h"
+#include <stdio.h>
+#include <string.h>
+
+static int check(bool ok, const char *what) {
+    if (!ok) fprintf(stderr, "%s\n", what);
+    return ok ? 0 : 1;
+}
+
+static void put(const char *path, const char *src) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return;
+    fputs(src, f);
+    fclose(f);
+}
+
+static sol_i64 geti(sol_state *s, const char *name) {
+    sol_val v = sol_getg(s, sf_ref(name));
+    return v.tt == SOL_TI64 ? v.i64 : -1;
+}
+
+/// The registry entry of a module, by the end of its path
+static sol_module *module(sol_state *s, const char *file) {
+    size_t len = strlen(file);
+    for (uint32_t i = 0; i < s->modules.count; ++i) {
+        sf_str path = s->modules.data[i].path;
+        if (path.len >= len && memcmp(path.c_str + path.len - len, file, len) == 0)
+            return s->modules.data + i;
+    }
+    return NULL;
+}
+
+int main(void) {
+    put("modtest_m.sol", "m_runs += 1;\nreturn { n = m_runs };\n");
+    put("modtest_a.sol", "a_runs += 1;\nlet b = import(\"modtest_b.sol\");\nreturn { b = b };\n");
+    put("modtest_b.sol", "let a = import(\"modtest_a.sol\");\nreturn { a = a };\n");
+    put("modtest_bad.sol", "bad_runs += 1;\nassert(false);\n");
+
+    sol_state *s = sol_state_new();
+    sol_usestd(s);
+    sol_setg(s, sf_lit("m_runs"), (sol_val){.tt = SOL_TI64, .i64 = 0});
+    sol_setg(s, sf_lit("a_runs"), (sol_val){.tt = SOL_TI64, .i64 = 0});
+    sol_setg(s, sf_lit("bad_runs"), (sol_val){.tt = SOL_TI64, .i64 = 0});
+    int rc = 0;
+
+    // One file by any path that names it runs once and gives the same value
+    sol_call_ex m1 = sol_import(s, sf_lit("modtest_m"));
+    sol_call_ex m2 = sol_import(s, sf_lit("modtest_m.sol"));
+    sol_call_ex m3 = sol_import(s, sf_lit("./modtest_m"));
+    rc |= check(m1.is_ok && m2.is_ok && m3.is_ok, "import failed");
+    if (m1.is_ok && m2.is_ok && m3.is_ok)
+        rc |= check(m1.ok.dyn == m2.ok.dyn && m2.ok.dyn == m3.ok.dyn, "paths to one file gave different values");
+    rc |= check(geti(s, "m_runs") == 1, "module ran more than once");
+
+    // Reloading runs it again and keeps the new value
+    sol_call_ex r = sol_reload(s, sf_lit("modtest_m.sol"));
+    rc |= check(r.is_ok && geti(s, "m_runs") == 2, "reload didn't run the module");
+    sol_call_ex m4 = sol_import(s, sf_lit("modtest_m"));
+    if (r.is_ok && m4.is_ok && m1.is_ok) {
+        rc |= check(m4.ok.dyn == r.ok.dyn && m4.ok.dyn != m1.ok.dyn, "reload didn't replace the value");
+        sol_dobj_ex n = sol_dobj_get(m4.ok.dyn, sf_lit("n"));
+        rc |= check(n.is_ok && n.ok.tt == SOL_TI64 && n.ok.i64 == 2, "stored value is from the first run");
+    }
+    rc |= check(geti(s, "m_runs") == 2, "import after reload ran the module");
+
+    // A cycle gets the in progress value of the module being run instead of running it again
+    sol_call_ex a = sol_import(s, sf_lit("modtest_a"));
+    rc |= check(a.is_ok && geti(s, "a_runs") == 1, "cyclic import ran the module again");
+    if (a.is_ok) {
+        sol_dobj_ex b = sol_dobj_get(a.ok.dyn, sf_lit("b"));
+        rc |= check(b.is_ok && sol_isdtype(b.ok, SOL_DOBJ), "cyclic import lost the inner module");
+        if (b.is_ok && sol_isdtype(b.ok, SOL_DOBJ)) {
+            sol_dobj_ex inner = sol_dobj_get(b.ok.dyn, sf_lit("a"));
+            rc |= check(inner.is_ok && inner.ok.tt == SOL_TNIL, "cycle didn't get the unfinished value");
+        }
+    }
+    sol_module *ma = module(s, "modtest_a.sol");
+    rc |= check(ma && ma->tt == SOL_MOD_DONE, "cyclic module isn't done");
+
+    // A failed run leaves the module to run again
+    sol_call_ex bad = sol_import(s, sf_lit("modtest_bad"));
+    rc |= check(!bad.is_ok, "failing module succeeded");
+    if (!bad.is_ok) sf_str_free(bad.err.panic);
+    sol_module *mb = module(s, "modtest_bad.sol");
+    rc |= check(mb && mb->tt == SOL_MOD_UNRUN, "failed module isn't unrun");
+    bad = sol_import(s, sf_lit("modtest_bad"));
+    if (!bad.is_ok) sf_str_free(bad.err.panic);
+    rc |= check(geti(s, "bad_runs") == 2, "failed module wasn't run again");
+
+    sol_state_free(s);
+    remove("modtest_m.sol");
+    remove("modtest_a.sol");
+    remove("modtest_b.sol");
+    remove("modtest_bad.sol");
+    return rc;
+}
@@ -0,0 +1,30 @@
+#include "sol/strbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(void) {
+    sol_strbuf sb = SOL_STRBUF_EMPTY;
+    sol_sbappend(&sb, sf_lit("ab\0cd"));
+    sol_sbappendc(&sb, '\0', 2);
+    sol_sbappend(&sb, sf_lit("ef"));
+
+    sf_str str = sol_sbfinish(&sb);
+    int rc = 0;
+    if (str.len != 9 || memcmp(str.c_str, "ab\0cd\0\0ef", 10) != 0) {
+        fprintf(stderr, "embedded NULs lost: got %zu bytes, expected 9\n", str.len);
+        rc = 1;
+    }
+    if (sb.data || sb.len || sb.cap) {
+        fprintf(stderr, "builder wasn't reset\n");
+        rc = 1;
+    }
+    sf_str_free(str);
+
+    sf_str empty = sol_sbfinish(&sb);
+    if (empty.len != 0 || !empty.c_str || empty.c_str[0] != '\0') {
+        fprintf(stderr, "empty builder should finish as an empty str\n");
+        rc = 1;
+    }
+    sf_str_free(empty);
+    return rc;
+}